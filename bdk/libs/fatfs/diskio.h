@@ -43,6 +43,19 @@ DRESULT disk_write (BYTE pdrv, const BYTE* buff, DWORD sector, UINT count);
 DRESULT disk_ioctl (BYTE pdrv, BYTE cmd, void* buff);
 DRESULT disk_set_info (BYTE pdrv, BYTE cmd, void *buff);
 
+/* SD sector cache counters since the last mount */
+typedef struct _disk_sd_cache_stats_t {
+	u32 meta_hits;		/* FAT and directory sectors */
+	u32 meta_misses;
+	u32 data_hits;		/* File sectors read one at a time */
+	u32 data_misses;
+	u32 bypassed;		/* Sectors of multi sector reads, never cached */
+	u32 write_updates;	/* Cached sectors refreshed by writes */
+} disk_sd_cache_stats_t;
+
+void disk_sd_cache_enable (bool enable);
+void disk_sd_cache_get_stats (disk_sd_cache_stats_t *stats);
+
 
 /* Disk Status Bits (DSTATUS) */
 
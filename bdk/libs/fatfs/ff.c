@@ -4691,6 +4691,48 @@ FRESULT f_lseek (
 
 
 
+#if FF_USE_FASTSEEK
+/*-----------------------------------------------------------------------*/
+/* Create a Cluster Link Map Table Sized to the File                     */
+/*-----------------------------------------------------------------------*/
+
+FRESULT f_create_clmt (
+	FIL* fp			/* Pointer to the file object */
+)
+{
+	FRESULT res;
+	DWORD *tbl;
+	UINT tlen = 32;	/* Enough for 15 fragments, retried once at the required size */
+
+	f_free_clmt(fp);
+	for (;;) {
+		tbl = (DWORD *)ff_memalloc(tlen * sizeof(DWORD));
+		if (!tbl) return FR_NOT_ENOUGH_CORE;
+		tbl[0] = tlen;
+		fp->cltbl = tbl;
+		res = f_lseek(fp, CREATE_LINKMAP);
+		if (res == FR_OK) return FR_OK;
+
+		fp->cltbl = 0;		/* Back to walking the FAT chain */
+		tlen = tbl[0];		/* Required table size */
+		ff_memfree(tbl);
+		if (res != FR_NOT_ENOUGH_CORE) return res;
+	}
+}
+
+void f_free_clmt (
+	FIL* fp			/* Pointer to the file object */
+)
+{
+	if (fp->cltbl) {
+		ff_memfree(fp->cltbl);
+		fp->cltbl = 0;
+	}
+}
+#endif
+
+
+
 #if FF_FASTFS && FF_USE_FASTSEEK
 /*-----------------------------------------------------------------------*/
 /* Seek File Read/Write Pointer                                          */
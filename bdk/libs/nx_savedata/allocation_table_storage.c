@@ -34,8 +34,6 @@ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
 #include "allocation_table_storage.h"
 
-#include "allocation_table_iterator.h"
-
 #include <gfx_utils.h>
 
 bool save_allocation_table_storage_init(allocation_table_storage_ctx_t *ctx, substorage *data, allocation_table_ctx_t *table, uint32_t block_size, uint32_t initial_block) {
@@ -44,6 +42,7 @@ bool save_allocation_table_storage_init(allocation_table_storage_ctx_t *ctx, sub
     ctx->fat = table;
     ctx->initial_block = initial_block;
     ctx->_length = 0;
+    ctx->cursor_valid = false;
     if (initial_block != 0xFFFFFFFF) {
         uint32_t list_length = save_allocation_table_get_list_length(table, initial_block);
         if (list_length == 0) {
@@ -55,56 +54,75 @@ bool save_allocation_table_storage_init(allocation_table_storage_ctx_t *ctx, sub
     return true;
 }
 
-uint32_t save_allocation_table_storage_read(allocation_table_storage_ctx_t *ctx, void *buffer, uint64_t offset, uint64_t count) {
-    allocation_table_iterator_ctx_t iterator;
-    if (!save_allocation_table_iterator_begin(&iterator, ctx->fat, ctx->initial_block))
-        return 0;
+/* Moves the cursor to block_num. It only restarts from the head of the chain when seeking backwards. */
+static bool save_allocation_table_storage_seek(allocation_table_storage_ctx_t *ctx, uint32_t block_num) {
+    if (!ctx->cursor_valid || block_num < ctx->cursor.virtual_block) {
+        ctx->cursor_valid = save_allocation_table_iterator_begin(&ctx->cursor, ctx->fat, ctx->initial_block);
+        if (!ctx->cursor_valid)
+            return false;
+    }
+
+    if (!save_allocation_table_iterator_seek(&ctx->cursor, block_num)) {
+        ctx->cursor_valid = false;
+        return false;
+    }
+    return true;
+}
+
+uint32_t save_allocation_table_storage_map(allocation_table_storage_ctx_t *ctx, storage_extent_t *extents, uint32_t max_extents, uint64_t offset, uint64_t count) {
+    allocation_table_iterator_ctx_t *iterator = &ctx->cursor;
     uint64_t in_pos = offset;
-    uint32_t out_pos = 0;
     uint32_t remaining = count;
+    uint32_t extent_count = 0;
 
     while (remaining) {
         uint32_t block_num = (uint32_t)(in_pos / ctx->block_size);
-        if (!save_allocation_table_iterator_seek(&iterator, block_num)) {
+        if (!save_allocation_table_storage_seek(ctx, block_num)) {
             EPRINTFARGS("Invalid allocation table offset: %x", (uint32_t)offset);
             return 0;
         }
 
-        uint32_t segment_pos = (uint32_t)(in_pos - (uint64_t)iterator.virtual_block * ctx->block_size);
-        uint64_t physical_offset = iterator.physical_block * ctx->block_size + segment_pos;
+        uint32_t segment_pos = (uint32_t)(in_pos - (uint64_t)iterator->virtual_block * ctx->block_size);
+        uint64_t physical_offset = iterator->physical_block * ctx->block_size + segment_pos;
 
-        uint32_t remaining_in_segment = iterator.current_segment_size * ctx->block_size - segment_pos;
+        uint32_t remaining_in_segment = iterator->current_segment_size * ctx->block_size - segment_pos;
         uint32_t bytes_to_read = MIN(remaining, remaining_in_segment);
 
-        if (substorage_read(ctx->base_storage, (uint8_t *)buffer + out_pos, physical_offset, bytes_to_read) != bytes_to_read)
-            return 0;
+        if (!storage_extent_add(extents, &extent_count, max_extents, ctx->base_storage, physical_offset, bytes_to_read))
+            break;
 
-        out_pos += bytes_to_read;
         in_pos += bytes_to_read;
         remaining -= bytes_to_read;
     }
-    return out_pos;
+    return extent_count;
+}
+
+static uint32_t save_allocation_table_storage_map_wrapper(void *ctx, storage_extent_t *extents, uint32_t max_extents, uint64_t offset, uint64_t count) {
+    return save_allocation_table_storage_map((allocation_table_storage_ctx_t *)ctx, extents, max_extents, offset, count);
+}
+
+uint32_t save_allocation_table_storage_read(allocation_table_storage_ctx_t *ctx, void *buffer, uint64_t offset, uint64_t count) {
+    save_storage_stats.allocation_table_reads++;
+    return storage_read_mapped(save_allocation_table_storage_map_wrapper, ctx, buffer, offset, count);
 }
 
 uint32_t save_allocation_table_storage_write(allocation_table_storage_ctx_t *ctx, const void *buffer, uint64_t offset, uint64_t count) {
-    allocation_table_iterator_ctx_t iterator;
-    if (!save_allocation_table_iterator_begin(&iterator, ctx->fat, ctx->initial_block))
-        return 0;
+    allocation_table_iterator_ctx_t *iterator = &ctx->cursor;
     uint64_t in_pos = offset;
     uint32_t out_pos = 0;
     uint32_t remaining = count;
 
     while (remaining) {
         uint32_t block_num = (uint32_t)(in_pos / ctx->block_size);
-        if (!save_allocation_table_iterator_seek(&iterator, block_num)) {
+        if (!save_allocation_table_storage_seek(ctx, block_num)) {
             EPRINTFARGS("Invalid allocation table offset: %x", (uint32_t)offset);
             return 0;
         }
 
-        uint32_t segment_pos = (uint32_t)(in_pos - (uint64_t)iterator.virtual_block * ctx->block_size);
-        uint64_t physical_offset = iterator.physical_block * ctx->block_size + segment_pos;
+        uint32_t segment_pos = (uint32_t)(in_pos - (uint64_t)iterator->virtual_block * ctx->block_size);
+        uint64_t physical_offset = iterator->physical_block * ctx->block_size + segment_pos;
 
-        uint32_t remaining_in_segment = iterator.current_segment_size * ctx->block_size - segment_pos;
+        uint32_t remaining_in_segment = iterator->current_segment_size * ctx->block_size - segment_pos;
         uint32_t bytes_to_write = MIN(remaining, remaining_in_segment);
 
 
@@ -125,6 +143,9 @@ bool save_allocation_table_storage_set_size(allocation_table_storage_ctx_t *ctx,
     if (old_block_count == new_block_count)
         return true;
 
+    /* The chain is about to change. */
+    ctx->cursor_valid = false;
+
     if (old_block_count == 0) {
         ctx->initial_block = save_allocation_table_allocate(ctx->fat, new_block_count);
         if (ctx->initial_block == 0xFFFFFFFF) {
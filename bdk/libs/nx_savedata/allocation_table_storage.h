@@ -36,6 +36,7 @@ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #define _ALLOCATION_TABLE_STORAGE_H_
 
 #include "allocation_table.h"
+#include "allocation_table_iterator.h"
 #include "storage.h"
 
 #include <stdint.h>
@@ -46,6 +47,8 @@ typedef struct {
     uint32_t initial_block;
     allocation_table_ctx_t *fat;
     uint64_t _length;
+    allocation_table_iterator_ctx_t cursor; /* Position of the last access, sequential reads resume from it. */
+    bool cursor_valid;
 } allocation_table_storage_ctx_t;
 
 static ALWAYS_INLINE void save_allocation_table_storage_get_size(allocation_table_storage_ctx_t *ctx, uint64_t *out_size) {
@@ -53,6 +56,7 @@ static ALWAYS_INLINE void save_allocation_table_storage_get_size(allocation_tabl
 }
 
 bool save_allocation_table_storage_init(allocation_table_storage_ctx_t *ctx, substorage *data, allocation_table_ctx_t *table, uint32_t block_size, uint32_t initial_block);
+uint32_t save_allocation_table_storage_map(allocation_table_storage_ctx_t *ctx, storage_extent_t *extents, uint32_t max_extents, uint64_t offset, uint64_t count);
 uint32_t save_allocation_table_storage_read(allocation_table_storage_ctx_t *ctx, void *buffer, uint64_t offset, uint64_t count);
 uint32_t save_allocation_table_storage_write(allocation_table_storage_ctx_t *ctx, const void *buffer, uint64_t offset, uint64_t count);
 bool save_allocation_table_storage_set_size(allocation_table_storage_ctx_t *ctx, uint64_t size);
@@ -39,22 +39,31 @@ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
 #include <string.h>
 
-static ALWAYS_INLINE cache_block_t *cache_block_init(cached_storage_ctx_t *ctx) {
-    cache_block_t *block = calloc(1, sizeof(cache_block_t));
-    block->buffer = malloc(ctx->block_size);
-    block->index = -1;
-    return block;
+static ALWAYS_INLINE uint32_t cache_block_hash(cached_storage_ctx_t *ctx, uint64_t index) {
+    return (uint32_t)(index ^ (index >> 32)) & ctx->hash_mask;
 }
 
 void save_cached_storage_init(cached_storage_ctx_t *ctx, substorage *base_storage, uint32_t block_size, uint32_t cache_size) {
     memcpy(&ctx->base_storage, base_storage, sizeof(substorage));
     ctx->block_size = block_size;
     ctx->length = base_storage->length;
-    ctx->cache_size = cache_size;
+    ctx->cache_size = MAX(cache_size, 1);
+
+    // Keep the index at most half full.
+    uint32_t hash_size = 4;
+    while (hash_size < ctx->cache_size * 2)
+        hash_size <<= 1;
+    ctx->hash_mask = hash_size - 1;
+    ctx->hash_table = calloc(hash_size, sizeof(cache_block_t *));
+
+    ctx->block_slab = calloc(ctx->cache_size, sizeof(cache_block_t));
+    ctx->buffer_slab = malloc((uint64_t)ctx->cache_size * block_size);
 
     list_init(&ctx->blocks);
-    for (uint32_t i = 0; i < cache_size; i++) {
-        cache_block_t *block = cache_block_init(ctx);
+    for (uint32_t i = 0; i < ctx->cache_size; i++) {
+        cache_block_t *block = &ctx->block_slab[i];
+        block->buffer = ctx->buffer_slab + (uint64_t)i * block_size;
+        block->index = -1;
         list_append(&ctx->blocks, &block->link);
     }
 }
@@ -63,24 +72,22 @@ void save_cached_storage_init_from_sector_storage(cached_storage_ctx_t *ctx, sec
     save_cached_storage_init(ctx, &base_storage->base_storage, base_storage->sector_size, cache_size);
 }
 
-static void cache_block_finalize(cache_block_t **block) {
-    free((*block)->buffer);
-    free(*block);
-}
-
 void save_cached_storage_finalize(cached_storage_ctx_t *ctx) {
-    if (!ctx->blocks.next)
+    if (!ctx->block_slab)
         return;
-    LIST_FOREACH_SAFE(curr_block, &ctx->blocks) {
-        cache_block_t *block = CONTAINER_OF(curr_block, cache_block_t, link) ;
-        cache_block_finalize(&block);
-    }
+    free(ctx->buffer_slab);
+    free(ctx->block_slab);
+    free(ctx->hash_table);
+    ctx->buffer_slab = NULL;
+    ctx->block_slab = NULL;
+    ctx->hash_table = NULL;
+    list_init(&ctx->blocks);
 }
 
 static bool try_get_block_by_value(cached_storage_ctx_t *ctx, uint64_t index, cache_block_t **out_block) {
-    if (!ctx->blocks.next)
+    if (!ctx->hash_table)
         return false;
-    LIST_FOREACH_ENTRY(cache_block_t, block, &ctx->blocks, link) {
+    for (cache_block_t *block = ctx->hash_table[cache_block_hash(ctx, index)]; block; block = block->hash_next) {
         if (block->index == index) {
             *out_block = block;
             return true;
@@ -89,6 +96,25 @@ static bool try_get_block_by_value(cached_storage_ctx_t *ctx, uint64_t index, ca
     return false;
 }
 
+static void cache_block_hash_remove(cached_storage_ctx_t *ctx, cache_block_t *block) {
+    cache_block_t **pblock = &ctx->hash_table[cache_block_hash(ctx, block->index)];
+    while (*pblock) {
+        if (*pblock == block) {
+            *pblock = block->hash_next;
+            break;
+        }
+        pblock = &(*pblock)->hash_next;
+    }
+    block->hash_next = NULL;
+    block->index = -1;
+}
+
+static void cache_block_hash_insert(cached_storage_ctx_t *ctx, cache_block_t *block) {
+    uint32_t bucket = cache_block_hash(ctx, block->index);
+    block->hash_next = ctx->hash_table[bucket];
+    ctx->hash_table[bucket] = block;
+}
+
 static bool flush_block(cached_storage_ctx_t *ctx, cache_block_t *block) {
     if (!block->dirty)
         return true;
@@ -132,26 +158,23 @@ static cache_block_t *get_block(cached_storage_ctx_t *ctx, uint64_t block_index)
         return block;
     }
 
-    // Get a pointer either to the least recently used block or to a newly allocated block if storage is empty.
-    bool block_is_new = false;
-    if (ctx->blocks.prev != &ctx->blocks) {
-        block = CONTAINER_OF(ctx->blocks.prev, cache_block_t, link);
+    if (!ctx->block_slab)
+        return NULL;
+
+    // Reuse the least recently used block.
+    block = CONTAINER_OF(ctx->blocks.prev, cache_block_t, link);
+    if (block->index != (uint64_t)-1) {
         if (!flush_block(ctx, block))
             return NULL;
-
-        // Remove least recently used block from list.
-        list_remove(&block->link);
-    } else {
-        block = cache_block_init(ctx);
-        block_is_new = true;
+        cache_block_hash_remove(ctx, block);
     }
 
-    if (!read_block(ctx, block, block_index)) {
-        if (block_is_new)
-            cache_block_finalize(&block);
+    // On failure the block stays unused at the back of the list.
+    if (!read_block(ctx, block, block_index))
         return NULL;
-    }
 
+    cache_block_hash_insert(ctx, block);
+    list_remove(&block->link);
     list_prepend(&ctx->blocks, &block->link);
 
     return block;
@@ -170,7 +193,28 @@ uint32_t save_cached_storage_read(cached_storage_ctx_t *ctx, void *buffer, uint6
     while (remaining) {
         uint64_t block_index = in_offset / ctx->block_size;
         uint32_t block_pos = (uint32_t)(in_offset % ctx->block_size);
-        cache_block_t *block = get_block(ctx,block_index);
+        cache_block_t *block = NULL;
+
+        /* Runs of whole blocks that are not cached are read straight through in one call, so the base can batch them. */
+        uint32_t run_count = 0;
+        if (!block_pos) {
+            while ((uint64_t)(run_count + 1) * ctx->block_size <= remaining && !try_get_block_by_value(ctx, block_index + run_count, &block))
+                run_count++;
+        }
+        if (run_count > 1) {
+            uint32_t run_size = run_count * ctx->block_size;
+            if (substorage_read(&ctx->base_storage, (uint8_t *)buffer + out_offset, in_offset, run_size) != run_size) {
+                EPRINTFARGS("Cached storage read: Unable to read blocks\n at index %x", (uint32_t)block_index);
+                return 0;
+            }
+
+            out_offset += run_size;
+            in_offset += run_size;
+            remaining -= run_size;
+            continue;
+        }
+
+        block = get_block(ctx,block_index);
         if (!block) {
             EPRINTFARGS("Cached storage read: Unable to get block\n at index %x", (uint32_t)block_index);
             return 0;
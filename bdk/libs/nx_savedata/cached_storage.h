@@ -42,12 +42,13 @@ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
 #include <stdint.h>
 
-typedef struct {
+typedef struct cache_block_t {
     uint64_t index;
     uint8_t *buffer;
     uint32_t length;
     bool dirty;
-    link_t link;
+    link_t link; // LRU order, most recently used first.
+    struct cache_block_t *hash_next;
 } cache_block_t;
 
 typedef struct {
@@ -56,6 +57,10 @@ typedef struct {
     uint64_t length;
     uint32_t cache_size;
     link_t blocks;
+    cache_block_t *block_slab; // cache_size blocks, buffers in one allocation.
+    uint8_t *buffer_slab;
+    cache_block_t **hash_table; // Chained by block index, hash_mask + 1 buckets.
+    uint32_t hash_mask;
 } cached_storage_ctx_t;
 
 void save_cached_storage_init(cached_storage_ctx_t *ctx, substorage *base_storage, uint32_t block_size, uint32_t cache_size);
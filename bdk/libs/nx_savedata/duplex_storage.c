@@ -37,6 +37,28 @@ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include <gfx_utils.h>
 #include <mem/heap.h>
 
+static ALWAYS_INLINE uint32_t save_bitmap_reverse_bits(uint32_t val) {
+    val = ((val >> 1) & 0x55555555) | ((val & 0x55555555) << 1);
+    val = ((val >> 2) & 0x33333333) | ((val & 0x33333333) << 2);
+    val = ((val >> 4) & 0x0F0F0F0F) | ((val & 0x0F0F0F0F) << 4);
+    return __builtin_bswap32(val);
+}
+
+/* Returns the first bit in [start, end) that differs from bit start, or end. */
+static uint64_t save_bitmap_find_run_end(const uint8_t *bitmap, uint64_t start, uint64_t end) {
+    const uint32_t *words = (const uint32_t *)bitmap;
+    uint32_t fill = save_bitmap_check_bit(bitmap, start) ? 0xFFFFFFFF : 0;
+    uint64_t pos = start;
+
+    while (pos < end) {
+        uint32_t diff = (words[pos >> 5] ^ fill) >> (pos & 31);
+        if (diff)
+            return MIN(pos + __builtin_ctz(diff), end);
+        pos = (pos | 31) + 1;
+    }
+    return end;
+}
+
 void save_duplex_storage_init(duplex_storage_ctx_t *ctx, uint8_t *data_a, uint8_t *data_b, uint32_t block_size_power, void *bitmap, uint64_t bitmap_size) {
     substorage_init(&ctx->data_a, &memory_storage_vt, data_a, 0, ctx->_length);
     substorage_init(&ctx->data_b, &memory_storage_vt, data_b, 0, ctx->_length);
@@ -44,46 +66,52 @@ void save_duplex_storage_init(duplex_storage_ctx_t *ctx, uint8_t *data_a, uint8_
     ctx->block_size = 1 << block_size_power;
 
     ctx->bitmap.data = (uint8_t *)bitmap;
-    ctx->bitmap.bitmap = malloc(bitmap_size >> 3);
+    /* Whole words, run scanning reads the decoded bitmap 32 bits at a time. */
+    ctx->bitmap.bitmap = malloc(ALIGN(bitmap_size, 32) >> 3);
 
+    /* On disk each word is MSB first, decoded bitmaps are LSB first. */
     uint32_t bits_remaining = (uint32_t)bitmap_size;
-    uint32_t bitmap_pos = 0;
     uint32_t *buffer_pos = (uint32_t *)ctx->bitmap.data;
+    uint32_t *decoded = (uint32_t *)ctx->bitmap.bitmap;
     while (bits_remaining) {
         uint32_t bits_to_read = MIN(bits_remaining, 0x20);
-        uint32_t val = *buffer_pos;
-        for (uint32_t i = 0; i < bits_to_read; i++) {
-            if (val & 0x80000000)
-                save_bitmap_set_bit(ctx->bitmap.bitmap, bitmap_pos);
-            else
-                save_bitmap_clear_bit(ctx->bitmap.bitmap, bitmap_pos);
-            bitmap_pos++;
-            bits_remaining--;
-            val <<= 1;
-        }
-        buffer_pos++;
+        uint32_t val = save_bitmap_reverse_bits(*buffer_pos++);
+        if (bits_to_read < 0x20)
+            val &= (1u << bits_to_read) - 1;
+        *decoded++ = val;
+        bits_remaining -= bits_to_read;
     }
 }
 
-uint32_t save_duplex_storage_read(duplex_storage_ctx_t *ctx, void *buffer, uint64_t offset, uint64_t count) {
+uint32_t save_duplex_storage_map(duplex_storage_ctx_t *ctx, storage_extent_t *extents, uint32_t max_extents, uint64_t offset, uint64_t count) {
     uint64_t in_pos = offset;
-    uint32_t out_pos = 0;
     uint32_t remaining = count;
+    uint32_t extent_count = 0;
 
     while (remaining) {
+        /* Blocks up to the next bit flip all come from the same layer. */
         uint32_t block_num = (uint32_t)(in_pos / ctx->block_size);
-        uint32_t block_pos = (uint32_t)(in_pos % ctx->block_size);
-        uint32_t bytes_to_read = MIN(ctx->block_size - block_pos, remaining);
+        uint64_t end_block = DIV_ROUND_UP(in_pos + remaining, ctx->block_size);
+        uint64_t run_end = save_bitmap_find_run_end(ctx->bitmap.bitmap, block_num, end_block);
+        uint32_t bytes_to_read = (uint32_t)MIN(run_end * ctx->block_size - in_pos, remaining);
 
         substorage *data = save_bitmap_check_bit(ctx->bitmap.bitmap, block_num) ? &ctx->data_b : &ctx->data_a;
-        if (substorage_read(data, (uint8_t *)buffer + out_pos, in_pos, bytes_to_read) != bytes_to_read)
-            return 0;
+        if (!storage_extent_add(extents, &extent_count, max_extents, data, in_pos, bytes_to_read))
+            break;
 
-        out_pos += bytes_to_read;
         in_pos += bytes_to_read;
         remaining -= bytes_to_read;
     }
-    return out_pos;
+    return extent_count;
+}
+
+static uint32_t save_duplex_storage_map_wrapper(void *ctx, storage_extent_t *extents, uint32_t max_extents, uint64_t offset, uint64_t count) {
+    return save_duplex_storage_map((duplex_storage_ctx_t *)ctx, extents, max_extents, offset, count);
+}
+
+uint32_t save_duplex_storage_read(duplex_storage_ctx_t *ctx, void *buffer, uint64_t offset, uint64_t count) {
+    save_storage_stats.duplex_reads++;
+    return storage_read_mapped(save_duplex_storage_map_wrapper, ctx, buffer, offset, count);
 }
 
 uint32_t save_duplex_storage_write(duplex_storage_ctx_t *ctx, const void *buffer, uint64_t offset, uint64_t count) {
@@ -70,6 +70,7 @@ static ALWAYS_INLINE uint8_t save_bitmap_check_bit(const void *buffer, uint64_t
 }
 
 void save_duplex_storage_init(duplex_storage_ctx_t *ctx, uint8_t *data_a, uint8_t *data_b, uint32_t block_size_power, void *bitmap, uint64_t bitmap_size);
+uint32_t save_duplex_storage_map(duplex_storage_ctx_t *ctx, storage_extent_t *extents, uint32_t max_extents, uint64_t offset, uint64_t count);
 uint32_t save_duplex_storage_read(duplex_storage_ctx_t *ctx, void *buffer, uint64_t offset, uint64_t count);
 uint32_t save_duplex_storage_write(duplex_storage_ctx_t *ctx, const void *buffer, uint64_t offset, uint64_t count);
 
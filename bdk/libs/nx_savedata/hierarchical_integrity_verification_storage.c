@@ -75,7 +75,8 @@ void save_hierarchical_integrity_verification_storage_init(hierarchical_integrit
         save_ivfc_storage_init(level_data, &level_info[i], &ctx->levels[i - 1].base_storage, integrity_check_level);
 
         uint64_t level_size = level_data->base_storage.length;
-        uint32_t cache_count = MIN((uint32_t)(DIV_ROUND_UP(level_size, level_info[i].block_size)), 4);
+        uint32_t cache_blocks = ctx->cache_blocks[i] ? ctx->cache_blocks[i] : IVFC_CACHE_BLOCKS_DEFAULT;
+        uint32_t cache_count = MIN((uint32_t)(DIV_ROUND_UP(level_size, level_info[i].block_size)), cache_blocks);
         save_cached_storage_init_from_sector_storage(&ctx->levels[i], &level_data->base_storage, cache_count);
         substorage_init(&ctx->levels[i].base_storage, &ivfc_storage_vt, level_data, 0, level_info[i].data.length);
 
@@ -133,25 +134,23 @@ void save_hierarchical_integrity_verification_storage_init_for_fat(hierarchical_
 
 validity_t save_hierarchical_integrity_verification_storage_validate(hierarchical_integrity_verification_storage_ctx_t *ctx) {
     validity_t result = VALIDITY_VALID;
-    integrity_verification_storage_ctx_t *storage = &ctx->integrity_storages[3];
-
-    uint32_t block_size = storage->base_storage.sector_size;
-    uint32_t block_count = (uint32_t)(DIV_ROUND_UP(ctx->length, block_size));
-
-    uint8_t *buffer = malloc(block_size);
+    integrity_verification_storage_ctx_t *storage = &ctx->integrity_storages[ctx->data_level - ctx->levels - 1];
+    validity_t *validities = storage->block_validities;
+    uint32_t block_count = storage->base_storage.sector_count;
 
     for (unsigned int i = 0; i < block_count; i++) {
-        if (ctx->level_validities[3][i] == VALIDITY_UNCHECKED) {
-            uint64_t storage_size = storage->base_storage.length;
-            uint32_t to_read = MIN((uint32_t)(storage_size - block_size * i), block_size);
-            substorage_read(&ctx->data_level->base_storage, buffer, block_size * i, to_read);
+        /* Each run of unchecked blocks is read and hashed in batches. */
+        if (validities[i] == VALIDITY_UNCHECKED) {
+            uint32_t run_count = 1;
+            while (i + run_count < block_count && validities[i + run_count] == VALIDITY_UNCHECKED)
+                run_count++;
+            save_ivfc_storage_verify(storage, i, run_count);
         }
-        if (ctx->level_validities[3][i] == VALIDITY_INVALID) {
+        if (validities[i] == VALIDITY_INVALID) {
             result = VALIDITY_INVALID;
             break;
         }
     }
-    free(buffer);
 
     return result;
 }
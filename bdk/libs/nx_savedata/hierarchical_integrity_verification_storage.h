@@ -47,6 +47,9 @@ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
 #define IVFC_MAX_LEVEL 6
 
+// Cached blocks per level when the context does not request a count.
+#define IVFC_CACHE_BLOCKS_DEFAULT 4
+
 typedef struct {
     fs_int64_t logical_offset;
     fs_int64_t hash_data_size;
@@ -89,6 +92,7 @@ typedef struct {
 } ivfc_storage_control_input_param_t;
 
 typedef struct {
+    uint32_t cache_blocks[IVFC_MAX_LEVEL - 1]; // Per level cache size, set before init. 0 uses the default.
     cached_storage_ctx_t levels[IVFC_MAX_LEVEL - 1];
     cached_storage_ctx_t *data_level;
     int integrity_check_level;
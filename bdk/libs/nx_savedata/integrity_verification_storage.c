@@ -47,6 +47,19 @@ void save_ivfc_storage_init(integrity_verification_storage_ctx_t *ctx, integrity
     ctx->integrity_check_level = integrity_check_level;
     memcpy(ctx->salt, info->salt, sizeof(ctx->salt));
     ctx->block_validities = calloc(1, sizeof(validity_t) * ctx->base_storage.sector_count);
+    ctx->batch_blocks = MAX(MIN(IVFC_BATCH_SIZE / ctx->base_storage.sector_size, ctx->base_storage.sector_count), 1);
+    ctx->scratch = malloc(0x20 + (uint64_t)ctx->batch_blocks * (ctx->base_storage.sector_size + 0x20));
+    ctx->hash_scratch = ctx->scratch + 0x20 + (uint64_t)ctx->batch_blocks * ctx->base_storage.sector_size;
+}
+
+void save_ivfc_storage_finalize(integrity_verification_storage_ctx_t *ctx) {
+    if (ctx->block_validities)
+        free(ctx->block_validities);
+    if (ctx->scratch)
+        free(ctx->scratch);
+    ctx->block_validities = NULL;
+    ctx->scratch = NULL;
+    ctx->hash_scratch = NULL;
 }
 
 /* buffer must have size count + 0x20 for salt to by copied in at offset 0. */
@@ -68,55 +81,102 @@ static ALWAYS_INLINE bool is_empty(const void *buffer, uint64_t count) {
     return empty;
 }
 
-bool save_ivfc_storage_read(integrity_verification_storage_ctx_t *ctx, void *buffer, uint64_t offset, uint64_t count) {
-    if (count > ctx->base_storage.sector_size) {
-        EPRINTF("IVFC read exceeds sector size!");
+/* Reads a run of blocks into scratch with one hash read and one data read, then hashes the unchecked ones back to back. */
+static bool save_ivfc_storage_read_blocks(integrity_verification_storage_ctx_t *ctx, uint64_t block_index, uint32_t block_count) {
+    uint32_t sector_size = ctx->base_storage.sector_size;
+    uint8_t *data_buffer = ctx->scratch + 0x20;
+    uint32_t hashes_size = block_count * 0x20;
+    uint32_t data_size = block_count * sector_size;
+
+    if (block_index + block_count > ctx->base_storage.sector_count) {
+        EPRINTF("IVFC read out of range!");
         return false;
     }
 
-    uint64_t block_index = offset / ctx->base_storage.sector_size;
+    if (ctx->integrity_check_level) {
+        for (uint32_t i = 0; i < block_count; i++) {
+            if (ctx->block_validities[block_index + i] == VALIDITY_INVALID) {
+                EPRINTF("IVFC hash error!");
+                return false;
+            }
+        }
+    }
 
-    if (ctx->block_validities[block_index] == VALIDITY_INVALID && ctx->integrity_check_level) {
-        EPRINTF("IVFC hash error!");
+    if (substorage_read(&ctx->hash_storage, ctx->hash_scratch, block_index * 0x20, hashes_size) != hashes_size)
+        return false;
+    if (substorage_read(&ctx->base_storage.base_storage, data_buffer, block_index * sector_size, data_size) != data_size)
         return false;
-    }
 
-    uint8_t hash_buffer[0x20] __attribute__((aligned(4))) = {0};
-    uint64_t hash_pos = block_index * sizeof(hash_buffer);
+    for (uint32_t i = 0; i < block_count; i++) {
+        uint8_t *stored_hash = ctx->hash_scratch + i * 0x20;
+        uint8_t *block = data_buffer + i * sector_size;
+        validity_t *validity = &ctx->block_validities[block_index + i];
 
-    if (substorage_read(&ctx->hash_storage, hash_buffer, hash_pos, sizeof(hash_buffer)) != sizeof(hash_buffer))
-        return false;
+        if (is_empty(stored_hash, 0x20)) {
+            memset(block, 0, sector_size);
+            *validity = VALIDITY_VALID;
+            continue;
+        }
 
-    if (is_empty(hash_buffer, sizeof(hash_buffer))) {
-        memset(buffer, 0, count);
-        ctx->block_validities[block_index] = VALIDITY_VALID;
-        return true;
+        /* The block is unchanged on disk until it is written, which resets this. */
+        if (*validity != VALIDITY_UNCHECKED)
+            continue;
+
+        /* The salt goes right before the block, over the tail of the previous one, which is put back after. */
+        uint8_t tail[0x20] __attribute__((aligned(4)));
+        uint8_t hash[0x20] __attribute__((aligned(4)));
+        memcpy(tail, block - sizeof(tail), sizeof(tail));
+        save_ivfc_storage_do_hash(ctx, hash, block - sizeof(tail), sector_size);
+        memcpy(block - sizeof(tail), tail, sizeof(tail));
+
+        if (memcmp(stored_hash, hash, sizeof(hash)) == 0) {
+            *validity = VALIDITY_VALID;
+        } else {
+            *validity = VALIDITY_INVALID;
+            if (ctx->integrity_check_level) {
+                EPRINTF("IVFC hash error!");
+                return false;
+            }
+        }
     }
 
-    uint8_t *data_buffer = calloc(1, ctx->base_storage.sector_size + 0x20);
-    if (substorage_read(&ctx->base_storage.base_storage, data_buffer + 0x20, offset - (offset % ctx->base_storage.sector_size), ctx->base_storage.sector_size) != ctx->base_storage.sector_size) {
-        free(data_buffer);
-        return false;
-    }
+    return true;
+}
 
-    memcpy(buffer, data_buffer + 0x20 + (offset % ctx->base_storage.sector_size), count);
+bool save_ivfc_storage_read(integrity_verification_storage_ctx_t *ctx, void *buffer, uint64_t offset, uint64_t count) {
+    uint32_t sector_size = ctx->base_storage.sector_size;
+    uint64_t remaining = count;
+    uint64_t in_offset = offset;
+    uint64_t out_offset = 0;
+
+    /* Only the blocks overlapping the request are checked. */
+    while (remaining) {
+        uint64_t block_index = in_offset / sector_size;
+        uint32_t block_pos = (uint32_t)(in_offset % sector_size);
+        uint32_t block_count = (uint32_t)MIN(DIV_ROUND_UP(block_pos + remaining, sector_size), ctx->batch_blocks);
+
+        if (!save_ivfc_storage_read_blocks(ctx, block_index, block_count))
+            return false;
 
-    if (ctx->integrity_check_level && ctx->block_validities[block_index] != VALIDITY_UNCHECKED) {
-        free(data_buffer);
-        return true;
+        uint32_t bytes_to_read = (uint32_t)MIN(remaining, (uint64_t)block_count * sector_size - block_pos);
+        memcpy((uint8_t *)buffer + out_offset, ctx->scratch + 0x20 + block_pos, bytes_to_read);
+
+        out_offset += bytes_to_read;
+        in_offset += bytes_to_read;
+        remaining -= bytes_to_read;
     }
 
-    uint8_t hash[0x20] __attribute__((aligned(4))) = {0};
-    save_ivfc_storage_do_hash(ctx, hash, data_buffer, ctx->base_storage.sector_size);
-    free(data_buffer);
-    if (memcmp(hash_buffer, hash, sizeof(hash_buffer)) == 0) {
-        ctx->block_validities[block_index] = VALIDITY_VALID;
-    } else {
-        ctx->block_validities[block_index] = VALIDITY_INVALID;
-        if (ctx->integrity_check_level) {
-            EPRINTF("IVFC hash error!");
+    return true;
+}
+
+bool save_ivfc_storage_verify(integrity_verification_storage_ctx_t *ctx, uint64_t block_index, uint64_t block_count) {
+    while (block_count) {
+        uint32_t batch_count = (uint32_t)MIN(block_count, ctx->batch_blocks);
+        if (!save_ivfc_storage_read_blocks(ctx, block_index, batch_count))
             return false;
-        }
+
+        block_index += batch_count;
+        block_count -= batch_count;
     }
 
     return true;
@@ -127,12 +187,10 @@ bool save_ivfc_storage_write(integrity_verification_storage_ctx_t *ctx, const vo
     uint64_t hash_pos = block_index * 0x20;
 
     uint8_t hash[0x20] __attribute__((aligned(4))) = {0};
-    uint8_t *data_buffer = calloc(1, ctx->base_storage.sector_size + 0x20);
+    uint8_t *data_buffer = ctx->scratch;
     if (count < ctx->base_storage.sector_size) {
-        if (substorage_read(&ctx->base_storage.base_storage, data_buffer + 0x20, offset - (offset % ctx->base_storage.sector_size), ctx->base_storage.sector_size) != ctx->base_storage.sector_size) {
-            free(data_buffer);
+        if (substorage_read(&ctx->base_storage.base_storage, data_buffer + 0x20, offset - (offset % ctx->base_storage.sector_size), ctx->base_storage.sector_size) != ctx->base_storage.sector_size)
             return false;
-        }
     }
     memcpy(data_buffer + 0x20 + (offset % ctx->base_storage.sector_size), buffer, count);
 
@@ -140,11 +198,8 @@ bool save_ivfc_storage_write(integrity_verification_storage_ctx_t *ctx, const vo
         save_ivfc_storage_do_hash(ctx, hash, data_buffer, ctx->base_storage.sector_size);
     }
 
-    if (substorage_write(&ctx->base_storage.base_storage, data_buffer + 0x20, offset - (offset % ctx->base_storage.sector_size), ctx->base_storage.sector_size) != ctx->base_storage.sector_size) {
-        free(data_buffer);
+    if (substorage_write(&ctx->base_storage.base_storage, data_buffer + 0x20, offset - (offset % ctx->base_storage.sector_size), ctx->base_storage.sector_size) != ctx->base_storage.sector_size)
         return false;
-    }
-    free(data_buffer);
     if (substorage_write(&ctx->hash_storage, hash, hash_pos, sizeof(hash)) != sizeof(hash))
         return false;
 
@@ -39,12 +39,18 @@ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
 #include <stdint.h>
 
+/* Bytes of data blocks read and hashed per batch. */
+#define IVFC_BATCH_SIZE 0x20000
+
 typedef struct {
     substorage hash_storage;
     int integrity_check_level;
     validity_t *block_validities;
     uint8_t salt[0x20];
     sector_storage base_storage;
+    uint8_t *scratch; // Salt followed by batch_blocks blocks, reused by every read and write.
+    uint8_t *hash_scratch; // Stored hashes of one batch.
+    uint32_t batch_blocks;
 } integrity_verification_storage_ctx_t;
 
 typedef struct {
@@ -55,6 +61,8 @@ typedef struct {
 
 void save_ivfc_storage_init(integrity_verification_storage_ctx_t *ctx, integrity_verification_info_ctx_t *info, substorage *hash_storage, int integrity_check_level);
 bool save_ivfc_storage_read(integrity_verification_storage_ctx_t *ctx, void *buffer, uint64_t offset, uint64_t count);
+bool save_ivfc_storage_verify(integrity_verification_storage_ctx_t *ctx, uint64_t block_index, uint64_t block_count);
 bool save_ivfc_storage_write(integrity_verification_storage_ctx_t *ctx, const void *buffer, uint64_t offset, uint64_t count);
+void save_ivfc_storage_finalize(integrity_verification_storage_ctx_t *ctx);
 
 #endif
@@ -53,6 +53,27 @@ static journal_map_entry_t *read_map_entries(uint8_t *map_table, uint32_t count)
     return map;
 }
 
+static journal_map_run_t *build_map_runs(journal_map_entry_t *map, uint32_t count, uint32_t *out_run_count) {
+    uint32_t run_count = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!i || map[i].physical_index != map[i - 1].physical_index + 1)
+            run_count++;
+    }
+
+    journal_map_run_t *runs = malloc(MAX(run_count, 1) * sizeof(journal_map_run_t));
+    journal_map_run_t *run = runs;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!i || map[i].physical_index != map[i - 1].physical_index + 1) {
+            run->virtual_index = i;
+            run->physical_index = map[i].physical_index;
+            run++;
+        }
+    }
+
+    *out_run_count = run_count;
+    return runs;
+}
+
 void save_journal_map_init(journal_map_ctx_t *ctx, journal_map_header_t *header, journal_map_params_t *map_info) {
     ctx->header = header;
     ctx->map_storage = map_info->map_storage;
@@ -60,4 +81,36 @@ void save_journal_map_init(journal_map_ctx_t *ctx, journal_map_header_t *header,
     ctx->modified_virtual_blocks = map_info->virtual_block_bitmap;
     ctx->free_blocks = map_info->free_block_bitmap;
     ctx->entries = read_map_entries(ctx->map_storage, header->main_data_block_count);
+    ctx->runs = build_map_runs(ctx->entries, header->main_data_block_count, &ctx->run_count);
+    ctx->last_run = 0;
+}
+
+/* Returns the number of blocks left in the run holding virtual_index, 0 if out of range. */
+uint32_t save_journal_map_get_run(journal_map_ctx_t *ctx, uint32_t virtual_index, uint32_t *out_physical_index) {
+    uint32_t block_count = ctx->header->main_data_block_count;
+    if (virtual_index >= block_count)
+        return 0;
+
+    /* Reads are mostly sequential, try the last run and its successor first. */
+    uint32_t idx = ctx->last_run;
+    if (idx + 1 < ctx->run_count && virtual_index >= ctx->runs[idx + 1].virtual_index)
+        idx++;
+    if (virtual_index < ctx->runs[idx].virtual_index || (idx + 1 < ctx->run_count && virtual_index >= ctx->runs[idx + 1].virtual_index)) {
+        /* Last run starting at or before virtual_index. */
+        uint32_t lo = 0, hi = ctx->run_count - 1;
+        while (lo < hi) {
+            uint32_t mid = hi - (hi - lo) / 2;
+            if (ctx->runs[mid].virtual_index <= virtual_index)
+                lo = mid;
+            else
+                hi = mid - 1;
+        }
+        idx = lo;
+    }
+    ctx->last_run = idx;
+
+    journal_map_run_t *run = &ctx->runs[idx];
+    uint32_t run_end = idx + 1 < ctx->run_count ? ctx->runs[idx + 1].virtual_index : block_count;
+    *out_physical_index = run->physical_index + (virtual_index - run->virtual_index);
+    return run_end - virtual_index;
 }
@@ -62,9 +62,18 @@ typedef struct {
     uint32_t virtual_index;
 } journal_map_entry_t;
 
+/* A run of virtual blocks mapped to consecutive physical blocks, up to the next run. */
+typedef struct {
+    uint32_t virtual_index;
+    uint32_t physical_index;
+} journal_map_run_t;
+
 typedef struct {
     journal_map_header_t *header;
     journal_map_entry_t *entries;
+    journal_map_run_t *runs;
+    uint32_t run_count;
+    uint32_t last_run;
     uint8_t *map_storage;
     uint8_t *modified_physical_blocks;
     uint8_t *modified_virtual_blocks;
@@ -80,5 +89,6 @@ static ALWAYS_INLINE uint32_t save_journal_map_entry_get_physical_index(uint32_t
 }
 
 void save_journal_map_init(journal_map_ctx_t *ctx, journal_map_header_t *header, journal_map_params_t *map_info);
+uint32_t save_journal_map_get_run(journal_map_ctx_t *ctx, uint32_t virtual_index, uint32_t *out_physical_index);
 
 #endif
@@ -49,25 +49,37 @@ void save_journal_storage_init(journal_storage_ctx_t *ctx, substorage *base_stor
     ctx->length = header->total_size - header->journal_size;
 }
 
-uint32_t save_journal_storage_read(journal_storage_ctx_t *ctx, void *buffer, uint64_t offset, uint64_t count) {
+uint32_t save_journal_storage_map(journal_storage_ctx_t *ctx, storage_extent_t *extents, uint32_t max_extents, uint64_t offset, uint64_t count) {
     uint64_t in_pos = offset;
-    uint32_t out_pos = 0;
     uint32_t remaining = count;
+    uint32_t extent_count = 0;
 
     while (remaining) {
         uint32_t block_num = (uint32_t)(in_pos / ctx->block_size);
         uint32_t block_pos = (uint32_t)(in_pos % ctx->block_size);
-        uint64_t physical_offset = ctx->map.entries[block_num].physical_index * ctx->block_size + block_pos;
-        uint32_t bytes_to_read = MIN(ctx->block_size - block_pos, remaining);
-
-        if (substorage_read(&ctx->base_storage, (uint8_t *)buffer + out_pos, physical_offset, bytes_to_read) != bytes_to_read)
+        uint32_t physical_index;
+        uint32_t run_blocks = save_journal_map_get_run(&ctx->map, block_num, &physical_index);
+        if (!run_blocks) {
+            EPRINTFARGS("Journal offset %x out of range!", (uint32_t)in_pos);
             return 0;
+        }
+
+        /* The whole run is physically contiguous. */
+        uint64_t physical_offset = (uint64_t)physical_index * ctx->block_size + block_pos;
+        uint32_t bytes_to_read = (uint32_t)MIN((uint64_t)run_blocks * ctx->block_size - block_pos, remaining);
+
+        if (!storage_extent_add(extents, &extent_count, max_extents, &ctx->base_storage, physical_offset, bytes_to_read))
+            break;
 
-        out_pos += bytes_to_read;
         in_pos += bytes_to_read;
         remaining -= bytes_to_read;
     }
-    return out_pos;
+    return extent_count;
+}
+
+uint32_t save_journal_storage_read(journal_storage_ctx_t *ctx, void *buffer, uint64_t offset, uint64_t count) {
+    save_storage_stats.journal_reads++;
+    return storage_read_mapped(save_journal_storage_map_wrapper, ctx, buffer, offset, count);
 }
 
 uint32_t save_journal_storage_write(journal_storage_ctx_t *ctx, const void *buffer, uint64_t offset, uint64_t count) {
@@ -49,51 +49,79 @@ remap_segment_ctx_t *save_remap_storage_init_segments(remap_storage_ctx_t *ctx)
     remap_segment_ctx_t *segments = calloc(1, sizeof(remap_segment_ctx_t) * header->map_segment_count);
     unsigned int entry_idx = 0;
 
+    ctx->last_entry = NULL;
+
     for (unsigned int i = 0; i < header->map_segment_count; i++) {
+        if (entry_idx >= header->map_entry_count) {
+            EPRINTF("Remap storage has fewer entries than segments!");
+            return NULL;
+        }
+
+        /* A segment is a run of virtually contiguous entries. Size it before filling it in. */
+        unsigned int first_idx = entry_idx++;
+        while (entry_idx < header->map_entry_count && map_entries[entry_idx - 1].ends.virtual_offset_end == map_entries[entry_idx].entry.virtual_offset)
+            entry_idx++;
+
         remap_segment_ctx_t *seg = &segments[i];
-        seg->entry_count = 0;
-        remap_entry_ctx_t **ptr = malloc(sizeof(remap_entry_ctx_t *) * (seg->entry_count + 1));
-        if (!ptr) {
+        seg->entry_count = entry_idx - first_idx;
+        seg->entries = malloc(sizeof(remap_entry_ctx_t *) * seg->entry_count);
+        if (!seg->entries) {
             EPRINTF("Failed to allocate entries in remap storage!");
             return NULL;
         }
-        seg->entries = ptr;
-        seg->entries[seg->entry_count++] = &map_entries[entry_idx];
-        seg->offset = map_entries[entry_idx].entry.virtual_offset;
-        map_entries[entry_idx++].segment = seg;
-
-        while (entry_idx < header->map_entry_count && map_entries[entry_idx - 1].ends.virtual_offset_end == map_entries[entry_idx].entry.virtual_offset) {
-            map_entries[entry_idx].segment = seg;
-            map_entries[entry_idx - 1].next = &map_entries[entry_idx];
-            remap_entry_ctx_t **ptr = calloc(1, sizeof(remap_entry_ctx_t *) * (seg->entry_count + 1));
-            if (!ptr) {
-                EPRINTF("Failed to allocate entries in remap storage!");
-                return NULL;
-            }
-            memcpy(ptr, seg->entries, sizeof(remap_entry_ctx_t *) * (seg->entry_count));
-            free(seg->entries);
-            seg->entries = ptr;
-            seg->entries[seg->entry_count++] = &map_entries[entry_idx++];
+
+        for (unsigned int j = 0; j < seg->entry_count; j++) {
+            remap_entry_ctx_t *entry = &map_entries[first_idx + j];
+            entry->segment = seg;
+            if (j)
+                seg->entries[j - 1]->next = entry;
+            seg->entries[j] = entry;
         }
-        seg->length = seg->entries[seg->entry_count - 1]->ends.virtual_offset_end - seg->entries[0]->entry.virtual_offset;
+        seg->offset = seg->entries[0]->entry.virtual_offset;
+        seg->length = seg->entries[seg->entry_count - 1]->ends.virtual_offset_end - seg->offset;
     }
     return segments;
 }
 
-static ALWAYS_INLINE remap_entry_ctx_t *save_remap_storage_get_map_entry(remap_storage_ctx_t *ctx, uint64_t offset) {
+static ALWAYS_INLINE bool save_remap_entry_contains(remap_entry_ctx_t *entry, uint64_t offset) {
+    return offset >= entry->entry.virtual_offset && offset < entry->ends.virtual_offset_end;
+}
+
+static remap_entry_ctx_t *save_remap_storage_get_map_entry(remap_storage_ctx_t *ctx, uint64_t offset) {
+    /* Reads are mostly sequential, try the last entry and its successor first. */
+    remap_entry_ctx_t *entry = ctx->last_entry;
+    if (entry) {
+        if (save_remap_entry_contains(entry, offset))
+            return entry;
+        if (entry->next && save_remap_entry_contains(entry->next, offset)) {
+            ctx->last_entry = entry->next;
+            return entry->next;
+        }
+    }
+
     uint32_t segment_idx = save_remap_get_segment_from_virtual_offset(ctx->header, offset);
     if (segment_idx < ctx->header->map_segment_count) {
-        for (unsigned int i = 0; i < ctx->segments[segment_idx].entry_count; i++) {
-            if (ctx->segments[segment_idx].entries[i]->ends.virtual_offset_end > offset) {
-                return ctx->segments[segment_idx].entries[i];
-            }
+        remap_segment_ctx_t *seg = &ctx->segments[segment_idx];
+
+        /* First entry ending past the offset. */
+        uint64_t lo = 0, hi = seg->entry_count;
+        while (lo < hi) {
+            uint64_t mid = lo + (hi - lo) / 2;
+            if (seg->entries[mid]->ends.virtual_offset_end > offset)
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+        if (lo < seg->entry_count) {
+            ctx->last_entry = seg->entries[lo];
+            return seg->entries[lo];
         }
     }
     EPRINTFARGS("Remap offset %08x%08x out of range!", (uint32_t)(offset >> 32), (uint32_t)(offset & 0xFFFFFFFF));
     return NULL;
 }
 
-uint32_t save_remap_storage_read(remap_storage_ctx_t *ctx, void *buffer, uint64_t offset, uint64_t count) {
+uint32_t save_remap_storage_map(remap_storage_ctx_t *ctx, storage_extent_t *extents, uint32_t max_extents, uint64_t offset, uint64_t count) {
     remap_entry_ctx_t *entry = NULL;
     entry = save_remap_storage_get_map_entry(ctx, offset);
     if (!entry) {
@@ -101,17 +129,16 @@ uint32_t save_remap_storage_read(remap_storage_ctx_t *ctx, void *buffer, uint64_
         return 0;
     }
     uint64_t in_pos = offset;
-    uint32_t out_pos = 0;
     uint32_t remaining = (u32)count;
+    uint32_t extent_count = 0;
 
     while (remaining) {
         uint64_t entry_pos = in_pos - entry->entry.virtual_offset;
         uint32_t bytes_to_read = MIN((uint32_t)(entry->ends.virtual_offset_end - in_pos), remaining);
 
-        if (substorage_read(&ctx->base_storage, (uint8_t *)buffer + out_pos, entry->entry.physical_offset + entry_pos, bytes_to_read) != bytes_to_read)
-            return 0;
+        if (!storage_extent_add(extents, &extent_count, max_extents, &ctx->base_storage, entry->entry.physical_offset + entry_pos, bytes_to_read))
+            break;
 
-        out_pos += bytes_to_read;
         in_pos += bytes_to_read;
         remaining -= bytes_to_read;
 
@@ -123,7 +150,12 @@ uint32_t save_remap_storage_read(remap_storage_ctx_t *ctx, void *buffer, uint64_
             entry = entry->next;
         }
     }
-    return out_pos;
+    return extent_count;
+}
+
+uint32_t save_remap_storage_read(remap_storage_ctx_t *ctx, void *buffer, uint64_t offset, uint64_t count) {
+    save_storage_stats.remap_reads++;
+    return storage_read_mapped(save_remap_storage_map_wrapper, ctx, buffer, offset, count);
 }
 
 uint32_t save_remap_storage_write(remap_storage_ctx_t *ctx, const void *buffer, uint64_t offset, uint64_t count) {
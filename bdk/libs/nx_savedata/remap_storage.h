@@ -86,6 +86,7 @@ typedef struct {
     remap_header_t *header;
     remap_entry_ctx_t *map_entries;
     remap_segment_ctx_t *segments;
+    remap_entry_ctx_t *last_entry; /* Last looked up entry, for sequential reads. */
     substorage base_storage;
 } remap_storage_ctx_t;
 
@@ -98,6 +99,7 @@ static ALWAYS_INLINE uint64_t save_remap_get_virtual_offset(remap_header_t *head
 }
 
 remap_segment_ctx_t *save_remap_storage_init_segments(remap_storage_ctx_t *ctx);
+uint32_t save_remap_storage_map(remap_storage_ctx_t *ctx, storage_extent_t *extents, uint32_t max_extents, uint64_t offset, uint64_t count);
 uint32_t save_remap_storage_read(remap_storage_ctx_t *ctx, void *buffer, uint64_t offset, uint64_t count);
 uint32_t save_remap_storage_write(remap_storage_ctx_t *ctx, const void *buffer, uint64_t offset, uint64_t count);
 
@@ -120,6 +120,10 @@ void save_init(save_ctx_t *ctx, FIL *file, const uint8_t *save_mac_key, uint32_t
     ctx->file = file;
     ctx->action = action;
     memcpy(ctx->save_mac_key, save_mac_key, sizeof(ctx->save_mac_key));
+
+    /* On failure reads fall back to walking the FAT chain. */
+    if (action & ACTION_FAST_SEEK)
+        f_create_clmt(file);
 }
 
 bool save_process(save_ctx_t *ctx) {
@@ -216,14 +220,15 @@ bool save_process(save_ctx_t *ctx) {
     save_journal_storage_init(&ctx->journal_storage, &journal_data, &ctx->header.journal_header, &journal_map_info);
 
     /* Initialize core IVFC storage. */
-    save_init_journal_ivfc_storage(ctx, &ctx->core_data_ivfc_storage, ctx->action & ACTION_VERIFY);
+    int integrity_check_level = ctx->action & (ACTION_VERIFY | ACTION_VERIFY_LAZY);
+    save_init_journal_ivfc_storage(ctx, &ctx->core_data_ivfc_storage, integrity_check_level);
 
     /* Initialize FAT storage. */
     if (ctx->header.layout.version < VERSION_DISF_5) {
         ctx->fat_storage = malloc(ctx->header.layout.fat_size);
         save_remap_storage_read(&ctx->meta_remap_storage, ctx->fat_storage, ctx->header.layout.fat_offset, ctx->header.layout.fat_size);
     } else {
-        save_init_fat_ivfc_storage(ctx, &ctx->fat_ivfc_storage, ctx->action & ACTION_VERIFY);
+        save_init_fat_ivfc_storage(ctx, &ctx->fat_ivfc_storage, integrity_check_level);
         ctx->fat_storage = malloc(ctx->fat_ivfc_storage.length);
         save_remap_storage_read(&ctx->meta_remap_storage, ctx->fat_storage, fs_int64_get(&ctx->header.version_5.fat_ivfc_header.level_hash_info.level_headers[2].logical_offset), ctx->fat_ivfc_storage.length);
     }
@@ -275,10 +280,11 @@ void save_free_contexts(save_ctx_t *ctx) {
         free(ctx->journal_storage.map.map_storage);
     if (ctx->journal_storage.map.entries)
         free(ctx->journal_storage.map.entries);
+    if (ctx->journal_storage.map.runs)
+        free(ctx->journal_storage.map.runs);
 
     for (unsigned int i = 0; i < 4; i++) {
-        if (ctx->core_data_ivfc_storage.integrity_storages[i].block_validities)
-            free(ctx->core_data_ivfc_storage.integrity_storages[i].block_validities);
+        save_ivfc_storage_finalize(&ctx->core_data_ivfc_storage.integrity_storages[i]);
         save_cached_storage_finalize(&ctx->core_data_ivfc_storage.levels[i + 1]);
     }
     if (ctx->core_data_ivfc_storage.level_validities)
@@ -286,8 +292,7 @@ void save_free_contexts(save_ctx_t *ctx) {
 
     if (ctx->header.layout.version >= VERSION_DISF_5) {
         for (unsigned int i = 0; i < 3; i++) {
-            if (ctx->fat_ivfc_storage.integrity_storages[i].block_validities)
-                free(ctx->fat_ivfc_storage.integrity_storages[i].block_validities);
+            save_ivfc_storage_finalize(&ctx->fat_ivfc_storage.integrity_storages[i]);
             save_cached_storage_finalize(&ctx->fat_ivfc_storage.levels[i + 1]);
         }
     }
@@ -296,6 +301,12 @@ void save_free_contexts(save_ctx_t *ctx) {
 
     if (ctx->fat_storage)
         free(ctx->fat_storage);
+
+    save_fs_list_finalize(&ctx->save_filesystem_core.file_table.directory_table);
+    save_fs_list_finalize(&ctx->save_filesystem_core.file_table.file_table);
+
+    if (ctx->action & ACTION_FAST_SEEK)
+        f_free_clmt(ctx->file);
 }
 
 static ALWAYS_INLINE bool save_flush(save_ctx_t *ctx) {
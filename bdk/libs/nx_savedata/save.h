@@ -51,6 +51,12 @@ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include <stdint.h>
 
 #define ACTION_VERIFY (1<<2)
+// Map the save file's cluster chain once so substorage reads seek without walking the FAT.
+// The file cannot grow while mapped. The map is freed by save_free_contexts.
+#define ACTION_FAST_SEEK (1<<3)
+// Check hashes only for the blocks that are read, when they are first read, instead of
+// every block at open. A read touching a block that fails its check fails.
+#define ACTION_VERIFY_LAZY (1<<4)
 
 typedef struct {
     save_header_t header;
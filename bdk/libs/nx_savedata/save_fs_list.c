@@ -35,41 +35,163 @@ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include "save_fs_list.h"
 
 #include <gfx_utils.h>
+#include <mem/heap.h>
 
 #include <string.h>
 
 void save_fs_list_init(save_filesystem_list_ctx_t *ctx) {
     ctx->free_list_head_index = 0;
     ctx->used_list_head_index = 1;
+    ctx->index_buckets = NULL;
+    ctx->index_entries = NULL;
+    ctx->header_cached = false;
+}
+
+static void save_fs_list_drop_index(save_filesystem_list_ctx_t *ctx) {
+    if (ctx->index_buckets)
+        free(ctx->index_buckets);
+    if (ctx->index_entries)
+        free(ctx->index_entries);
+    ctx->index_buckets = NULL;
+    ctx->index_entries = NULL;
+}
+
+void save_fs_list_finalize(save_filesystem_list_ctx_t *ctx) {
+    save_fs_list_drop_index(ctx);
+}
+
+static bool save_fs_list_read_header(save_filesystem_list_ctx_t *ctx) {
+    if (ctx->header_cached)
+        return true;
+
+    uint32_t header[2];
+    if (save_allocation_table_storage_read(&ctx->storage, header, 0, sizeof(header)) != sizeof(header))
+        return false;
+    ctx->length = header[0];
+    ctx->capacity = header[1];
+    ctx->header_cached = true;
+    return true;
 }
 
 static ALWAYS_INLINE uint32_t save_fs_list_get_capacity(save_filesystem_list_ctx_t *ctx) {
-    uint32_t capacity;
-    if (save_allocation_table_storage_read(&ctx->storage, &capacity, 4, 4) != 4) {
+    if (!save_fs_list_read_header(ctx)) {
         EPRINTF("Failed to read FS list capacity!");
         return 0;
     }
-    return capacity;
+    return ctx->capacity;
 }
 
 static ALWAYS_INLINE uint32_t save_fs_list_get_length(save_filesystem_list_ctx_t *ctx) {
-    uint32_t length;
-    if (save_allocation_table_storage_read(&ctx->storage, &length, 0, 4) != 4) {
+    if (!save_fs_list_read_header(ctx)) {
         EPRINTF("Failed to read FS list length!");
         return 0;
     }
-    return length;
+    return ctx->length;
 }
 
 static ALWAYS_INLINE bool save_fs_list_set_capacity(save_filesystem_list_ctx_t *ctx, uint32_t capacity) {
-    return save_allocation_table_storage_write(&ctx->storage, &capacity, 4, 4) == 4;
+    if (save_allocation_table_storage_write(&ctx->storage, &capacity, 4, 4) != 4) {
+        ctx->header_cached = false;
+        return false;
+    }
+    ctx->capacity = capacity;
+    return true;
 }
 
 static ALWAYS_INLINE bool save_fs_list_set_length(save_filesystem_list_ctx_t *ctx, uint32_t length) {
-    return save_allocation_table_storage_write(&ctx->storage, &length, 0, 4) == 4;
+    if (save_allocation_table_storage_write(&ctx->storage, &length, 0, 4) != 4) {
+        ctx->header_cached = false;
+        return false;
+    }
+    ctx->length = length;
+    return true;
+}
+
+static uint32_t save_fs_list_hash_key(uint32_t parent, const char *name) {
+    /* FNV-1a over the name, seeded with the parent. */
+    uint32_t hash = 0x811C9DC5 ^ parent;
+    for (uint32_t i = 0; i < SAVE_FS_LIST_MAX_NAME_LENGTH && name[i]; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= 0x01000193;
+    }
+    return hash;
+}
+
+/* Reads the whole list once and indexes the used entries by key. */
+static bool save_fs_list_build_index(save_filesystem_list_ctx_t *ctx) {
+    if (ctx->index_buckets)
+        return true;
+
+    uint32_t length = save_fs_list_get_length(ctx);
+    if (length <= ctx->used_list_head_index || length > save_fs_list_get_capacity(ctx))
+        return false;
+
+    save_fs_list_entry_t *entries = malloc(length * SAVE_FS_LIST_ENTRY_SIZE);
+    uint32_t *order = malloc(length * sizeof(uint32_t));
+    if (save_allocation_table_storage_read(&ctx->storage, entries, 0, length * SAVE_FS_LIST_ENTRY_SIZE) != length * SAVE_FS_LIST_ENTRY_SIZE) {
+        free(order);
+        free(entries);
+        return false;
+    }
+
+    /* Walk the used list, bailing out to the on-disk walk if it looks corrupt. */
+    uint32_t count = 0;
+    for (uint32_t index = entries[ctx->used_list_head_index].next; index; index = entries[index].next) {
+        if (index >= length || count == length) {
+            free(order);
+            free(entries);
+            return false;
+        }
+        order[count++] = index;
+    }
+
+    /* Keep the index at most half full. */
+    uint32_t bucket_count = 4;
+    while (bucket_count < count * 2)
+        bucket_count <<= 1;
+    ctx->index_buckets = calloc(bucket_count, sizeof(uint32_t));
+    ctx->index_entries = malloc(length * sizeof(save_fs_list_index_entry_t));
+    ctx->index_mask = bucket_count - 1;
+    ctx->index_size = length;
+
+    /* Inserted back to front, so the first match in list order is found first. */
+    while (count--) {
+        uint32_t index = order[count];
+        save_fs_list_index_entry_t *index_entry = &ctx->index_entries[index];
+        index_entry->parent = entries[index].parent;
+        index_entry->name_hash = save_fs_list_hash_key(entries[index].parent, entries[index].name);
+
+        uint32_t *bucket = &ctx->index_buckets[index_entry->name_hash & ctx->index_mask];
+        index_entry->next = *bucket;
+        *bucket = index;
+    }
+
+    free(order);
+    free(entries);
+    return true;
+}
+
+static uint32_t save_fs_list_find_indexed(save_filesystem_list_ctx_t *ctx, const save_entry_key_t *key) {
+    uint32_t hash = save_fs_list_hash_key(key->parent, key->name);
+    save_fs_list_entry_t entry;
+
+    for (uint32_t index = ctx->index_buckets[hash & ctx->index_mask]; index; index = ctx->index_entries[index].next) {
+        save_fs_list_index_entry_t *index_entry = &ctx->index_entries[index];
+        if (index_entry->name_hash != hash || index_entry->parent != key->parent)
+            continue;
+        if (save_fs_list_read_entry(ctx, index, &entry) != SAVE_FS_LIST_ENTRY_SIZE)
+            return 0xFFFFFFFF;
+        if (!strcmp(entry.name, key->name))
+            return index;
+    }
+    return 0xFFFFFFFF;
 }
 
 uint32_t save_fs_list_get_index_from_key(save_filesystem_list_ctx_t *ctx, const save_entry_key_t *key, uint32_t *prev_index) {
+    /* Callers that unlink the entry need its predecessor, only the list walk has it. */
+    if (!prev_index && save_fs_list_build_index(ctx))
+        return save_fs_list_find_indexed(ctx, key);
+
     save_fs_list_entry_t entry;
     uint32_t capacity = save_fs_list_get_capacity(ctx);
     if (save_fs_list_read_entry(ctx, ctx->used_list_head_index, &entry) != SAVE_FS_LIST_ENTRY_SIZE) {
@@ -186,6 +308,8 @@ bool save_fs_list_remove(save_filesystem_list_ctx_t *ctx, const save_entry_key_t
     if (save_fs_list_read_entry(ctx, index, &entry_to_del) != SAVE_FS_LIST_ENTRY_SIZE)
         return false;
 
+    save_fs_list_drop_index(ctx);
+
     prev_entry.next = entry_to_del.next;
     if (save_fs_list_write_entry(ctx, previous_index, &prev_entry) != SAVE_FS_LIST_ENTRY_SIZE)
         return false;
@@ -210,6 +334,8 @@ bool save_fs_list_change_key(save_filesystem_list_ctx_t *ctx, save_entry_key_t *
     if (save_fs_list_read_entry(ctx, index, &entry) != SAVE_FS_LIST_ENTRY_SIZE)
         return false;
 
+    save_fs_list_drop_index(ctx);
+
     entry.parent = new_key->parent;
     memcpy(entry.name, new_key->name, SAVE_FS_LIST_MAX_NAME_LENGTH);
 
@@ -283,6 +409,8 @@ uint32_t save_fs_list_add(save_filesystem_list_ctx_t *ctx, const save_entry_key_
         return index;
     }
 
+    save_fs_list_drop_index(ctx);
+
     index = save_fs_list_allocate_entry(ctx);
     if (index == 0) {
         EPRINTF("Failed to allocate FS list entry!");
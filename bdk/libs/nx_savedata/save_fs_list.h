@@ -44,10 +44,25 @@ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #define SAVE_FS_LIST_ENTRY_SIZE 0x60
 #define SAVE_FS_LIST_MAX_NAME_LENGTH 0x40
 
+typedef struct {
+    uint32_t parent;
+    uint32_t name_hash;
+    uint32_t next; /* Next entry index in the bucket, 0 ends the chain. */
+} save_fs_list_index_entry_t;
+
 typedef struct {
     uint32_t free_list_head_index;
     uint32_t used_list_head_index;
     allocation_table_storage_ctx_t storage;
+    /* Key index over the used list, built on the first lookup and dropped when keys change. */
+    uint32_t *index_buckets;
+    save_fs_list_index_entry_t *index_entries;
+    uint32_t index_mask;
+    uint32_t index_size;
+    /* List header, read once. */
+    uint32_t length;
+    uint32_t capacity;
+    bool header_cached;
 } save_filesystem_list_ctx_t;
 
 typedef struct {
@@ -85,6 +100,7 @@ static ALWAYS_INLINE uint32_t save_fs_list_write_entry(save_filesystem_list_ctx_
 }
 
 void save_fs_list_init(save_filesystem_list_ctx_t *ctx);
+void save_fs_list_finalize(save_filesystem_list_ctx_t *ctx);
 uint32_t save_fs_list_get_index_from_key(save_filesystem_list_ctx_t *ctx, const save_entry_key_t *key, uint32_t *prev_index);
 bool save_fs_list_get_value_by_index(save_filesystem_list_ctx_t *ctx, uint32_t index, save_table_entry_t *value);
 bool save_fs_list_get_value_and_name(save_filesystem_list_ctx_t *ctx, uint32_t index, save_table_entry_t *value, char *name);
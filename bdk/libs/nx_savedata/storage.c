@@ -45,6 +45,8 @@ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
 #include <string.h>
 
+save_storage_stats_t save_storage_stats;
+
 void substorage_init(substorage *this, const storage_vt *vt, void *ctx, uint64_t offset, uint64_t length) {
     storage_init(&this->base_storage, vt, ctx);
     this->offset = offset;
@@ -68,24 +70,66 @@ void sector_storage_init(sector_storage *ctx, substorage *base_storage, uint32_t
     ctx->sector_count = (uint32_t)(DIV_ROUND_UP(ctx->length, ctx->sector_size));
 }
 
-uint32_t sector_storage_read(sector_storage *ctx, void *buffer, uint64_t offset, uint64_t count) {
-    uint64_t remaining = count;
-    uint64_t in_offset = offset;
-    uint32_t out_offset = 0;
-    uint32_t sector_size = ctx->sector_size;
-
-    while (remaining) {
-        uint32_t sector_pos = (uint32_t)(in_offset % sector_size);
-        uint32_t bytes_to_read = MIN((uint32_t)remaining, (uint32_t)(sector_size - sector_pos));
-
-        substorage_read(&ctx->base_storage, (uint8_t *)buffer + out_offset, in_offset, bytes_to_read);
-
-        out_offset += bytes_to_read;
-        in_offset += bytes_to_read;
-        remaining -= bytes_to_read;
+/* Appends the extents of the bottom layer backing an extent, following the map of every layer that has one.
+   Contiguous bottom ranges merge, even when they come from different extents of the layers above.
+   Returns the bytes covered, short when out_extents fills up or a map fails. */
+static uint32_t storage_extent_resolve(const storage_extent_t *extent, storage_extent_t *out_extents, uint32_t *out_count) {
+    substorage *base = extent->base;
+    storage_map_fn_t map = base->base_storage.vt->map;
+    if (!map)
+        return storage_extent_add(out_extents, out_count, STORAGE_MAX_EXTENTS, base, extent->offset, extent->length) ? extent->length : 0;
+
+    storage_extent_t extents[STORAGE_MAX_EXTENTS];
+    uint32_t done = 0;
+    while (done < extent->length) {
+        uint32_t extent_count = map(base->base_storage.ctx, extents, STORAGE_MAX_EXTENTS, base->offset + extent->offset + done, extent->length - done);
+        if (!extent_count)
+            return done;
+
+        for (uint32_t i = 0; i < extent_count; i++) {
+            uint32_t resolved = storage_extent_resolve(&extents[i], out_extents, out_count);
+            done += resolved;
+            if (resolved != extents[i].length)
+                return done;
+        }
     }
+    return done;
+}
+
+uint32_t storage_read_mapped(storage_map_fn_t map, void *ctx, void *buffer, uint64_t offset, uint64_t count) {
+    storage_extent_t extents[STORAGE_MAX_EXTENTS];
+    storage_extent_t bottom[STORAGE_MAX_EXTENTS];
+    uint32_t out_pos = 0;
+
+    while (out_pos < count) {
+        uint32_t extent_count = map(ctx, extents, STORAGE_MAX_EXTENTS, offset + out_pos, count - out_pos);
+        if (!extent_count)
+            return 0;
+
+        /* Resolve as much as fits in one batch of bottom extents, then read it. */
+        uint32_t bottom_count = 0;
+        uint32_t mapped = 0;
+        for (uint32_t i = 0; i < extent_count; i++) {
+            uint32_t resolved = storage_extent_resolve(&extents[i], bottom, &bottom_count);
+            mapped += resolved;
+            if (resolved != extents[i].length)
+                break;
+        }
+        if (!mapped)
+            return 0;
+
+        for (uint32_t i = 0; i < bottom_count; i++) {
+            if (substorage_read(bottom[i].base, (uint8_t *)buffer + out_pos, bottom[i].offset, bottom[i].length) != bottom[i].length)
+                return 0;
+            out_pos += bottom[i].length;
+        }
+    }
+    return out_pos;
+}
 
-    return out_offset;
+uint32_t sector_storage_read(sector_storage *ctx, void *buffer, uint64_t offset, uint64_t count) {
+    /* Sectors map one to one onto the base storage, so there is nothing to split. */
+    return substorage_read(&ctx->base_storage, buffer, offset, count);
 }
 
 uint32_t sector_storage_write(sector_storage *ctx, const void *buffer, uint64_t offset, uint64_t count) {
@@ -124,6 +168,7 @@ void save_hierarchical_integrity_verification_storage_get_size_wrapper(void *ctx
 }
 
 uint32_t memory_storage_read(uint8_t *storage, void *buffer, uint64_t offset, uint64_t count) {
+    save_storage_stats.memory_reads++;
     memcpy(buffer, storage + offset, count);
     return count;
 }
@@ -144,6 +189,7 @@ uint32_t memory_storage_write_wrapper(void *ctx, const void *buffer, uint64_t of
 uint32_t save_file_read(FIL *fp, void *buffer, uint64_t offset, uint64_t count) {
     UINT bytes_read = 0;
 
+    save_storage_stats.file_reads++;
     if (f_lseek(fp, offset) || f_read(fp, buffer, count, &bytes_read) || bytes_read != count) {
         EPRINTFARGS("Failed to read file at offset %x!\nRead %x bytes. Req %x bytes.", (uint32_t)offset, bytes_read, (uint32_t)count);
         return 0;
@@ -188,6 +234,10 @@ void save_remap_storage_get_size_wrapper(__attribute__((unused)) void *ctx, uint
     *out_size = -1;
 }
 
+uint32_t save_remap_storage_map_wrapper(void *ctx, storage_extent_t *extents, uint32_t max_extents, uint64_t offset, uint64_t count) {
+    return save_remap_storage_map((remap_storage_ctx_t *)ctx, extents, max_extents, offset, count);
+}
+
 uint32_t save_journal_storage_read_wrapper(void *ctx, void *buffer, uint64_t offset, uint64_t count) {
     return save_journal_storage_read((journal_storage_ctx_t *)ctx, buffer, offset, count);
 }
@@ -201,7 +251,12 @@ void save_journal_storage_get_size_wrapper(void *ctx, uint64_t *out_size) {
     *out_size = journal->length;
 }
 
+uint32_t save_journal_storage_map_wrapper(void *ctx, storage_extent_t *extents, uint32_t max_extents, uint64_t offset, uint64_t count) {
+    return save_journal_storage_map((journal_storage_ctx_t *)ctx, extents, max_extents, offset, count);
+}
+
 uint32_t save_ivfc_storage_read_wrapper(void *ctx, void *buffer, uint64_t offset, uint64_t count) {
+    save_storage_stats.ivfc_reads++;
     return save_ivfc_storage_read((integrity_verification_storage_ctx_t *)ctx, buffer, offset, count) ? count : 0;
 }
 
@@ -234,3 +289,8 @@ void save_hierarchical_duplex_storage_get_size_wrapper(void *ctx, uint64_t *out_
     hierarchical_duplex_storage_ctx_t *duplex = (hierarchical_duplex_storage_ctx_t *)ctx;
     *out_size = duplex->_length;
 }
+
+uint32_t save_hierarchical_duplex_storage_map_wrapper(void *ctx, storage_extent_t *extents, uint32_t max_extents, uint64_t offset, uint64_t count) {
+    hierarchical_duplex_storage_ctx_t *duplex = (hierarchical_duplex_storage_ctx_t *)ctx;
+    return save_duplex_storage_map(duplex->data_layer, extents, max_extents, offset, count);
+}
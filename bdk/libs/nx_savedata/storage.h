@@ -39,11 +39,19 @@ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
 #include <utils/types.h>
 
+#define STORAGE_MAX_EXTENTS 16
+
+typedef struct storage_extent_t storage_extent_t;
+
+/* Fills up to max_extents extents covering the start of the range. Returns the extent count, 0 on error. */
+typedef uint32_t (*storage_map_fn_t)(void *ctx, storage_extent_t *extents, uint32_t max_extents, uint64_t offset, uint64_t count);
+
 typedef struct {
     uint32_t (*read)(void *ctx, void *buffer, uint64_t offset, uint64_t count);
     uint32_t (*write)(void *ctx, const void *buffer, uint64_t offset, uint64_t count);
     void (*set_size)(void *ctx, uint64_t size);
     void (*get_size)(void *ctx, uint64_t *out_size);
+    storage_map_fn_t map; /* Optional, for layers that only translate offsets. */
 } storage_vt;
 
 typedef struct {
@@ -77,6 +85,48 @@ static ALWAYS_INLINE void substorage_get_size(substorage *ctx, uint64_t *out_siz
     ctx->base_storage.vt->get_size(ctx->base_storage.ctx, out_size);
 }
 
+/* A contiguous range of a base storage, offset is relative to the substorage. */
+struct storage_extent_t {
+    substorage *base;
+    uint64_t offset;
+    uint32_t length;
+};
+
+/* Appends a range, merging it into the last extent when they are contiguous. Returns false when full. */
+static ALWAYS_INLINE bool storage_extent_add(storage_extent_t *extents, uint32_t *extent_count, uint32_t max_extents, substorage *base, uint64_t offset, uint32_t length) {
+    if (*extent_count) {
+        storage_extent_t *last = &extents[*extent_count - 1];
+        if (last->base == base && last->offset + last->length == offset) {
+            last->length += length;
+            return true;
+        }
+    }
+    if (*extent_count == max_extents)
+        return false;
+
+    storage_extent_t *extent = &extents[(*extent_count)++];
+    extent->base = base;
+    extent->offset = offset;
+    extent->length = length;
+    return true;
+}
+
+/* Reads a range through a map function, with one base read per extent. */
+uint32_t storage_read_mapped(storage_map_fn_t map, void *ctx, void *buffer, uint64_t offset, uint64_t count);
+
+/* Reads issued to each layer, for profiling. */
+typedef struct {
+    uint32_t file_reads;
+    uint32_t memory_reads;
+    uint32_t remap_reads;
+    uint32_t duplex_reads;
+    uint32_t journal_reads;
+    uint32_t ivfc_reads;
+    uint32_t allocation_table_reads;
+} save_storage_stats_t;
+
+extern save_storage_stats_t save_storage_stats;
+
 typedef struct {
     substorage base_storage;
     uint32_t sector_size;
@@ -94,7 +144,8 @@ static const storage_vt hierarchical_integrity_verification_storage_vt = {
     save_hierarchical_integrity_verification_storage_read_wrapper,
     save_hierarchical_integrity_verification_storage_write_wrapper,
     NULL,
-    save_hierarchical_integrity_verification_storage_get_size_wrapper
+    save_hierarchical_integrity_verification_storage_get_size_wrapper,
+    NULL
 };
 
 uint32_t memory_storage_read_wrapper(void *ctx, void *buffer, uint64_t offset, uint64_t count);
@@ -104,6 +155,7 @@ static const storage_vt memory_storage_vt = {
     memory_storage_read_wrapper,
     memory_storage_write_wrapper,
     NULL,
+    NULL,
     NULL
 };
 
@@ -115,29 +167,34 @@ static const storage_vt file_storage_vt = {
     save_file_read_wrapper,
     save_file_write_wrapper,
     NULL,
-    save_file_get_size_wrapper
+    save_file_get_size_wrapper,
+    NULL
 };
 
 uint32_t save_remap_storage_read_wrapper(void *ctx, void *buffer, uint64_t offset, uint64_t count);
 uint32_t save_remap_storage_write_wrapper(void *ctx, const void *buffer, uint64_t offset, uint64_t count);
 void save_remap_storage_get_size_wrapper(void *ctx, uint64_t *out_size);
+uint32_t save_remap_storage_map_wrapper(void *ctx, storage_extent_t *extents, uint32_t max_extents, uint64_t offset, uint64_t count);
 
 static const storage_vt remap_storage_vt = {
     save_remap_storage_read_wrapper,
     save_remap_storage_write_wrapper,
     NULL,
-    save_remap_storage_get_size_wrapper
+    save_remap_storage_get_size_wrapper,
+    save_remap_storage_map_wrapper
 };
 
 uint32_t save_journal_storage_read_wrapper(void *ctx, void *buffer, uint64_t offset, uint64_t count);
 uint32_t save_journal_storage_write_wrapper(void *ctx, const void *buffer, uint64_t offset, uint64_t count);
 void save_journal_storage_get_size_wrapper(void *ctx, uint64_t *out_size);
+uint32_t save_journal_storage_map_wrapper(void *ctx, storage_extent_t *extents, uint32_t max_extents, uint64_t offset, uint64_t count);
 
 static const storage_vt journal_storage_vt = {
     save_journal_storage_read_wrapper,
     save_journal_storage_write_wrapper,
     NULL,
-    save_journal_storage_get_size_wrapper
+    save_journal_storage_get_size_wrapper,
+    save_journal_storage_map_wrapper
 };
 
 uint32_t save_ivfc_storage_read_wrapper(void *ctx, void *buffer, uint64_t offset, uint64_t count);
@@ -148,18 +205,21 @@ static const storage_vt ivfc_storage_vt = {
     save_ivfc_storage_read_wrapper,
     save_ivfc_storage_write_wrapper,
     NULL,
-    save_ivfc_storage_get_size_wrapper
+    save_ivfc_storage_get_size_wrapper,
+    NULL
 };
 
 uint32_t save_hierarchical_duplex_storage_read_wrapper(void *ctx, void *buffer, uint64_t offset, uint64_t count);
 uint32_t save_hierarchical_duplex_storage_write_wrapper(void *ctx, const void *buffer, uint64_t offset, uint64_t count);
 void save_hierarchical_duplex_storage_get_size_wrapper(void *ctx, uint64_t *out_size);
+uint32_t save_hierarchical_duplex_storage_map_wrapper(void *ctx, storage_extent_t *extents, uint32_t max_extents, uint64_t offset, uint64_t count);
 
 static const storage_vt hierarchical_duplex_storage_vt = {
     save_hierarchical_duplex_storage_read_wrapper,
     save_hierarchical_duplex_storage_write_wrapper,
     NULL,
-    save_hierarchical_duplex_storage_get_size_wrapper
+    save_hierarchical_duplex_storage_get_size_wrapper,
+    save_hierarchical_duplex_storage_map_wrapper
 };
 
 static ALWAYS_INLINE bool is_range_valid(uint64_t offset, uint64_t size, uint64_t total_size) {
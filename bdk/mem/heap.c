@@ -120,6 +120,7 @@ static void _heap_free(heap_t *heap, u32 addr)
 }
 
 heap_t _heap;
+static u32 _heap_allocs = 0; // Running count of malloc/calloc calls.
 
 void heap_init(u32 base)
 {
@@ -133,11 +134,13 @@ void heap_copy(heap_t *heap)
 
 void *malloc(u32 size)
 {
+	_heap_allocs++;
 	return (void *)_heap_alloc(&_heap, size);
 }
 
 void *calloc(u32 num, u32 size)
 {
+	_heap_allocs++;
 	void *res = (void *)_heap_alloc(&_heap, num * size);
 	memset(res, 0, ALIGN(num * size, sizeof(hnode_t))); // Clear the aligned size.
 	return res;
@@ -175,3 +178,8 @@ void heap_monitor(heap_monitor_t *mon, bool print_node_stats)
 	}
 	mon->total += mon->used;
 }
+
+u32 heap_alloc_count()
+{
+	return _heap_allocs;
+}
@@ -47,5 +47,6 @@ void *malloc(u32 size);
 void *calloc(u32 num, u32 size);
 void free(void *buf);
 void heap_monitor(heap_monitor_t *mon, bool print_node_stats);
+u32  heap_alloc_count();
 
 #endif
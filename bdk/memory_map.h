@@ -53,10 +53,9 @@
 #define  RAM_DISK2_SZ 0x21000000 //  528MB.
 
 // NX BIS driver sector cache.
-#define NX_BIS_CACHE_ADDR  0xC5000000
-#define  NX_BIS_CACHE_SZ   0x10020000 // 256MB.
-#define NX_BIS_LOOKUP_ADDR 0xD6000000
-#define  NX_BIS_LOOKUP_SZ   0xF000000 // 240MB.
+#define NX_BIS_CACHE_ADDR    0xC5000000
+#define  NX_BIS_CACHE_SZ     0x20000000 // 512MB.
+#define  NX_BIS_CACHE_LOW_SZ 0x10020000 // 256MB. The rest may be protected by old hwinit.
 
 // L4T Kernel Panic Storage (PSTORE).
 #define PSTORE_ADDR   0xB0000000
@@ -473,11 +473,10 @@ int se_generate_random_key(u32 ks_dst, u32 ks_src)
 
 int se_aes_xts_crypt_sec(u32 tweak_ks, u32 crypt_ks, u32 enc, u64 sec, void *dst, const void *src, u32 sec_size)
 {
-	u8 tweak[0x10];
-	u8 orig_tweak[0x10];
+	u8 tweak[0x10] __attribute__((aligned(4)));
+	u8 orig_tweak[0x10] __attribute__((aligned(4)));
 	u32 *pdst = (u32 *)dst;
 	u32 *psrc = (u32 *)src;
-	u32 *ptweak = (u32 *)tweak;
 
 	//Generate tweak.
 	for (int i = 0xF; i >= 0; i--)
@@ -490,29 +489,25 @@ int se_aes_xts_crypt_sec(u32 tweak_ks, u32 crypt_ks, u32 enc, u64 sec, void *dst
 
 	memcpy(orig_tweak, tweak, 0x10);
 
+	// Both whitening passes step the tweak as they XOR, so no tweak stream is stored.
 	// We are assuming a 0x10-aligned sector size in this implementation.
-	for (u32 i = 0; i < sec_size / 0x10; i++)
+	u32 *ptweak = (u32 *)tweak;
+	for (u32 i = 0; i < sec_size / 4; i += 4)
 	{
 		for (u32 j = 0; j < 4; j++)
-			pdst[j] = psrc[j] ^ ptweak[j];
-
+			pdst[i + j] = psrc[i + j] ^ ptweak[j];
 		_gf256_mul_x_le(tweak);
-		psrc += 4;
-		pdst += 4;
 	}
 
 	if (!se_aes_crypt_ecb(crypt_ks, enc, dst, sec_size, dst, sec_size))
 		return 0;
 
-	pdst = (u32 *)dst;
 	ptweak = (u32 *)orig_tweak;
-	for (u32 i = 0; i < sec_size / 0x10; i++)
+	for (u32 i = 0; i < sec_size / 4; i += 4)
 	{
 		for (u32 j = 0; j < 4; j++)
-			pdst[j] = pdst[j] ^ ptweak[j];
-
+			pdst[i + j] ^= ptweak[j];
 		_gf256_mul_x_le(orig_tweak);
-		pdst += 4;
 	}
 
 	return 1;
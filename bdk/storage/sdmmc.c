@@ -326,6 +326,78 @@ int sdmmc_storage_read(sdmmc_storage_t *storage, u32 sector, u32 num_sectors, vo
 	return 0;
 }
 
+/*
+ * Starts a read that completes in the background, so the caller can work on other
+ * data until sdmmc_storage_read_finish. Only one read can be in flight per storage and
+ * no other command may be sent in between. Requests that can't be DMAed straight into
+ * buf are read synchronously here instead.
+ */
+int sdmmc_storage_read_start(sdmmc_storage_t *storage, u32 sector, u32 num_sectors, void *buf)
+{
+	sdmmc_async_read_t *async = &storage->async_read;
+
+	async->sector = sector;
+	async->num_sectors = num_sectors;
+	async->buf = buf;
+
+	if (!storage->initialized || ((u32)buf < DRAM_START) || ((u32)buf % 8) || num_sectors >= 0xFFFF)
+	{
+		async->result = sdmmc_storage_read(storage, sector, num_sectors, buf);
+		async->pending = 2;
+		return async->result;
+	}
+
+	// If SDSC convert block address to byte address.
+	if (!storage->has_sector_access)
+		sector <<= 9;
+
+	sdmmc_init_cmd(&async->cmd, MMC_READ_MULTIPLE_BLOCK, sector, SDMMC_RSP_TYPE_1, 0);
+
+	async->req.buf = buf;
+	async->req.num_sectors = num_sectors;
+	async->req.blksize = 512;
+	async->req.is_write = 0;
+	async->req.is_multi_block = 1;
+	async->req.is_auto_stop_trn = 1;
+
+	if (!sdmmc_execute_cmd_start(storage->sdmmc, &async->cmd, &async->req, NULL))
+	{
+		u32 tmp = 0;
+		sdmmc_stop_transmission(storage->sdmmc, &tmp);
+		_sdmmc_storage_get_status(storage, &tmp, 0);
+
+		// Fall back to the retrying path.
+		async->result = _sdmmc_storage_readwrite(storage, async->sector, num_sectors, buf, 0);
+		async->pending = 2;
+		return async->result;
+	}
+
+	async->pending = 1;
+
+	return 1;
+}
+
+int sdmmc_storage_read_finish(sdmmc_storage_t *storage)
+{
+	sdmmc_async_read_t *async = &storage->async_read;
+
+	int pending = async->pending;
+	async->pending = 0;
+
+	if (pending != 1)
+		return pending ? async->result : 0;
+
+	if (sdmmc_execute_cmd_finish(storage->sdmmc, &async->cmd, &async->req))
+		return 1;
+
+	u32 tmp = 0;
+	sdmmc_stop_transmission(storage->sdmmc, &tmp);
+	_sdmmc_storage_get_status(storage, &tmp, 0);
+
+	// Retry the whole request synchronously.
+	return _sdmmc_storage_readwrite(storage, async->sector, async->num_sectors, async->buf, 0);
+}
+
 int sdmmc_storage_write(sdmmc_storage_t *storage, u32 sector, u32 num_sectors, void *buf)
 {
 	// Ensure that buffer resides in DRAM and it's DMA aligned.
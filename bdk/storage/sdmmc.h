@@ -176,6 +176,18 @@ typedef struct _sd_ssr
 	u32 protected_size;
 } sd_ssr_t;
 
+/*! Read started by sdmmc_storage_read_start. */
+typedef struct _sdmmc_async_read_t
+{
+	sdmmc_cmd_t cmd;
+	sdmmc_req_t req;
+	u32 sector;
+	u32 num_sectors;
+	void *buf;
+	int pending; // 1: transfer in flight, 2: already completed synchronously.
+	int result;
+} sdmmc_async_read_t;
+
 /*! SDMMC storage context. */
 typedef struct _sdmmc_storage_t
 {
@@ -195,11 +207,14 @@ typedef struct _sdmmc_storage_t
 	mmc_ext_csd_t ext_csd;
 	sd_scr_t      scr;
 	sd_ssr_t      ssr;
+	sdmmc_async_read_t async_read;
 } sdmmc_storage_t;
 
 int  sdmmc_storage_end(sdmmc_storage_t *storage);
 int  sdmmc_storage_read(sdmmc_storage_t *storage, u32 sector, u32 num_sectors, void *buf);
 int  sdmmc_storage_write(sdmmc_storage_t *storage, u32 sector, u32 num_sectors, void *buf);
+int  sdmmc_storage_read_start(sdmmc_storage_t *storage, u32 sector, u32 num_sectors, void *buf);
+int  sdmmc_storage_read_finish(sdmmc_storage_t *storage);
 int  sdmmc_storage_init_mmc(sdmmc_storage_t *storage, sdmmc_t *sdmmc, u32 bus_width, u32 type);
 int  sdmmc_storage_set_mmc_partition(sdmmc_storage_t *storage, u32 partition);
 void sdmmc_storage_init_wait_sd();
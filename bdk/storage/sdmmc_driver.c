@@ -998,17 +998,17 @@ static int _sdmmc_update_dma(sdmmc_t *sdmmc)
 	return 0;
 }
 
-static int _sdmmc_execute_cmd_inner(sdmmc_t *sdmmc, sdmmc_cmd_t *cmd, sdmmc_req_t *req, u32 *blkcnt_out)
+// Sends the command and configures the data transfer, which then runs in the background.
+static int _sdmmc_execute_cmd_start_inner(sdmmc_t *sdmmc, sdmmc_cmd_t *cmd, sdmmc_req_t *req, u32 *blkcnt_out)
 {
 	int has_req_or_check_busy = req || cmd->check_busy;
 	if (!_sdmmc_wait_cmd_data_inhibit(sdmmc, has_req_or_check_busy))
 		return 0;
 
-	u32 blkcnt = 0;
 	bool is_data_present = false;
 	if (req)
 	{
-		if (!_sdmmc_config_dma(sdmmc, &blkcnt, req))
+		if (!_sdmmc_config_dma(sdmmc, blkcnt_out, req))
 		{
 #ifdef ERROR_EXTRA_PRINTING
 			EPRINTF("SDMMC: DMA Wrong cfg!");
@@ -1050,14 +1050,25 @@ DPRINTF("rsp(%d): %08X, %08X, %08X, %08X\n", result,
 				EPRINTF("SDMMC: Unknown response type!");
 #endif
 		}
-		if (req && result)
-		{
-			result = _sdmmc_update_dma(sdmmc);
+	}
+
+	if (!result)
+		_sdmmc_mask_interrupts(sdmmc);
+
+	return result;
+}
+
+// Waits for the data transfer started by _sdmmc_execute_cmd_start_inner and the card.
+static int _sdmmc_execute_cmd_finish_inner(sdmmc_t *sdmmc, sdmmc_cmd_t *cmd, sdmmc_req_t *req)
+{
+	int result = 1;
+	if (req)
+	{
+		result = _sdmmc_update_dma(sdmmc);
 #ifdef ERROR_EXTRA_PRINTING
-			if (!result)
-				EPRINTF("SDMMC: DMA Update failed!");
+		if (!result)
+			EPRINTF("SDMMC: DMA Update failed!");
 #endif
-		}
 	}
 
 	_sdmmc_mask_interrupts(sdmmc);
@@ -1069,9 +1080,6 @@ DPRINTF("rsp(%d): %08X, %08X, %08X, %08X\n", result,
 			// Flush cache after transfer.
 			bpmp_mmu_maintenance(BPMP_MMU_MAINT_CLN_INV_WAY, false);
 
-			if (blkcnt_out)
-				*blkcnt_out = blkcnt;
-
 			if (req->is_auto_stop_trn)
 				sdmmc->rsp3 = sdmmc->regs->rspreg3;
 		}
@@ -1390,7 +1398,21 @@ void sdmmc_init_cmd(sdmmc_cmd_t *cmdbuf, u16 cmd, u32 arg, u32 rsp_type, u32 che
 	cmdbuf->check_busy = check_busy;
 }
 
-int sdmmc_execute_cmd(sdmmc_t *sdmmc, sdmmc_cmd_t *cmd, sdmmc_req_t *req, u32 *blkcnt_out)
+static void _sdmmc_execute_cmd_end(sdmmc_t *sdmmc)
+{
+	usleep((8000 + sdmmc->divisor - 1) / sdmmc->divisor);
+
+	if (sdmmc->disable_clock_on_end)
+		sdmmc->regs->clkcon &= ~SDHCI_CLOCK_CARD_EN;
+	sdmmc->disable_clock_on_end = 0;
+}
+
+/*
+ * Starts a command and its data transfer without waiting for the data.
+ * The CPU is free until sdmmc_execute_cmd_finish, which must follow before
+ * any other command is sent to this controller. req->buf must not be touched in between.
+ */
+int sdmmc_execute_cmd_start(sdmmc_t *sdmmc, sdmmc_cmd_t *cmd, sdmmc_req_t *req, u32 *blkcnt_out)
 {
 	if (!sdmmc->card_clock_enabled)
 		return 0;
@@ -1399,24 +1421,38 @@ int sdmmc_execute_cmd(sdmmc_t *sdmmc, sdmmc_cmd_t *cmd, sdmmc_req_t *req, u32 *b
 	if (sdmmc->manual_cal && sdmmc->powersave_enabled)
 		_sdmmc_autocal_execute(sdmmc, sdmmc_get_io_power(sdmmc));
 
-	int should_disable_sd_clock = 0;
+	sdmmc->disable_clock_on_end = 0;
 	if (!(sdmmc->regs->clkcon & SDHCI_CLOCK_CARD_EN))
 	{
-		should_disable_sd_clock = 1;
+		sdmmc->disable_clock_on_end = 1;
 		sdmmc->regs->clkcon |= SDHCI_CLOCK_CARD_EN;
 		_sdmmc_commit_changes(sdmmc);
 		usleep((8000 + sdmmc->divisor - 1) / sdmmc->divisor);
 	}
 
-	int result = _sdmmc_execute_cmd_inner(sdmmc, cmd, req, blkcnt_out);
-	usleep((8000 + sdmmc->divisor - 1) / sdmmc->divisor);
+	int result = _sdmmc_execute_cmd_start_inner(sdmmc, cmd, req, blkcnt_out);
+	if (!result)
+		_sdmmc_execute_cmd_end(sdmmc);
 
-	if (should_disable_sd_clock)
-		sdmmc->regs->clkcon &= ~SDHCI_CLOCK_CARD_EN;
+	return result;
+}
+
+int sdmmc_execute_cmd_finish(sdmmc_t *sdmmc, sdmmc_cmd_t *cmd, sdmmc_req_t *req)
+{
+	int result = _sdmmc_execute_cmd_finish_inner(sdmmc, cmd, req);
+	_sdmmc_execute_cmd_end(sdmmc);
 
 	return result;
 }
 
+int sdmmc_execute_cmd(sdmmc_t *sdmmc, sdmmc_cmd_t *cmd, sdmmc_req_t *req, u32 *blkcnt_out)
+{
+	if (!sdmmc_execute_cmd_start(sdmmc, cmd, req, blkcnt_out))
+		return 0;
+
+	return sdmmc_execute_cmd_finish(sdmmc, cmd, req);
+}
+
 int sdmmc_enable_low_voltage(sdmmc_t *sdmmc)
 {
 	if(sdmmc->id != SDMMC_1)
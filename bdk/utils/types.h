@@ -37,7 +37,11 @@ typedef unsigned short WORD;
 typedef unsigned short WCHAR;
 typedef unsigned int u32;
 typedef unsigned int UINT;
+#ifdef __LP64__
+typedef unsigned int DWORD; // FatFs expects a 32-bit DWORD (host builds).
+#else
 typedef unsigned long DWORD;
+#endif
 typedef unsigned long long QWORD;
 typedef unsigned long long int u64;
 
@@ -45,7 +49,7 @@ typedef volatile unsigned char vu8;
 typedef volatile unsigned short vu16;
 typedef volatile unsigned int vu32;
 
-#ifdef __aarch64__
+#if defined(__aarch64__) || defined(__LP64__)
 typedef u64 uptr;
 #else /* __arm__ or __thumb__ */
 typedef u32 uptr;
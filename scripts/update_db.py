@@ -1,14 +1,19 @@
 #!/usr/bin/env python3
 """
 FuseCheck Database Generator
-Fetches data from FuseNCA repository and generates fusecheck_db.txt
+Fetches data from FuseNCA repository and generates fusecheck_db.txt and
+its precompiled binary form fusecheck_db.bin
 
 Usage:
     python scripts/update_db.py              # Output to stdout
-    python scripts/update_db.py -o db.txt    # Output to file
+    python scripts/update_db.py -o db.txt    # Output to file (and db.bin)
+    python scripts/update_db.py --from-text fusecheck_db.txt   # Only rebuild the .bin
 """
 
 import json
+import os
+import struct
+import zlib
 import urllib.request
 import urllib.error
 import sys
@@ -21,6 +26,15 @@ from itertools import groupby
 FUSENCA_JSON_URL = "https://raw.githubusercontent.com/sthetix/FuseNCA/master/fuses.json"
 OUTPUT_PATH = "fusecheck_db.txt"
 
+# Binary database layout, must match source/fusecheck/fuse_db.h
+BIN_MAGIC = 0x42444346  # "FCDB"
+BIN_VERSION = 2
+BIN_HEADER = struct.Struct("<IHHHHIII")  # magic, version, header_size, fuse_count, nca_count, crc32, text_size, text_crc32
+BIN_RANGE = struct.Struct("<IIB3x")    # start, end, prod_fuses
+BIN_NCA = struct.Struct("<I16s")       # version, content_id
+MAX_FUSE_ENTRIES = 64
+MAX_NCA_ENTRIES = 256
+
 
 @dataclass
 class Version:
@@ -44,6 +58,9 @@ class Version:
     def __str__(self) -> str:
         return f"{self.major}.{self.minor}.{self.patch}"
 
+    def packed(self) -> int:
+        return (self.major << 16) | (self.minor << 8) | self.patch
+
 
 @dataclass
 class FuseEntry:
@@ -160,14 +177,70 @@ def generate_db(entries: List[FuseEntry]) -> str:
     return "\n".join(lines) + "\n"
 
 
+def generate_bin(fuse_ranges: List[Tuple[str, int]], ncas: List[Tuple[str, str]], text: bytes) -> bytes:
+    """Generate fusecheck_db.bin content from fuse ranges and (version, nca) pairs.
+    text is the fusecheck_db.txt they came from, the payload ignores the .bin once it differs."""
+    ranges = []
+    for version_range, fuses in fuse_ranges:
+        start, _, end = version_range.partition("-")
+        ranges.append((Version.from_string(start).packed(), Version.from_string(end or start).packed(), fuses))
+    ranges.sort()
+
+    for prev, cur in zip(ranges, ranges[1:]):
+        if cur[0] <= prev[1]:
+            raise ValueError(f"Overlapping fuse ranges at {cur[0]:06x}")
+    if len(ranges) > MAX_FUSE_ENTRIES or len(ncas) > MAX_NCA_ENTRIES:
+        raise ValueError("Too many entries for the payload tables")
+
+    data = b"".join(BIN_RANGE.pack(*r) for r in ranges)
+    for version, nca in ncas:
+        data += BIN_NCA.pack(Version.from_string(version).packed(), bytes.fromhex(nca[:32]))
+
+    header = BIN_HEADER.pack(BIN_MAGIC, BIN_VERSION, BIN_HEADER.size, len(ranges), len(ncas), zlib.crc32(data),
+                             len(text), zlib.crc32(text))
+    return header + data
+
+
+def parse_text_db(path: str) -> Tuple[List[Tuple[str, int]], List[Tuple[str, str]]]:
+    """Read fuse ranges and (version, nca) pairs back from a fusecheck_db.txt"""
+    fuse_ranges, ncas = [], []
+    with open(path) as f:
+        for line in f:
+            parts = line.split()
+            if len(parts) >= 3 and parts[0] == "[FUSE]":
+                fuse_ranges.append((parts[1], int(parts[2])))
+            elif len(parts) >= 3 and parts[0] == "[NCA]" and parts[2].endswith(".nca"):
+                ncas.append((parts[1], parts[2]))
+    return fuse_ranges, ncas
+
+
+def bin_path_for(text_path: str) -> str:
+    return os.path.splitext(text_path)[0] + ".bin"
+
+
+def write_bin(path: str, content: bytes):
+    with open(path, "wb") as f:
+        f.write(content)
+    print(f"Binary database written to {path} ({len(content)} bytes)", file=sys.stderr)
+
+
 def main():
     import argparse
     parser = argparse.ArgumentParser(description="Generate FuseCheck database from FuseNCA")
     parser.add_argument("-o", "--output", default=OUTPUT_PATH, help="Output file path")
     parser.add_argument("-u", "--url", default=FUSENCA_JSON_URL, help="FuseNCA fuses.json URL")
     parser.add_argument("--stdout", action="store_true", help="Output to stdout instead of file")
+    parser.add_argument("--bin-output", help="Binary database path (default: output path with .bin)")
+    parser.add_argument("--from-text", metavar="DB_TXT", help="Build the binary database from an existing text database")
     args = parser.parse_args()
 
+    if args.from_text:
+        fuse_ranges, ncas = parse_text_db(args.from_text)
+        with open(args.from_text, "rb") as f:
+            text = f.read()
+        write_bin(args.bin_output or bin_path_for(args.from_text), generate_bin(fuse_ranges, ncas, text))
+        return
+
     # Fetch data
     raw_data = fetch_fusenca_data(args.url)
 
@@ -193,8 +266,14 @@ def main():
         with open(args.output, "w", newline="\n") as f:
             f.write(db_content)
         print(f"Database written to {args.output}", file=sys.stderr)
-        print(f"  {len([l for l in db_content.split('\\n') if l.startswith('[FUSE]')])} fuse entries", file=sys.stderr)
-        print(f"  {len([l for l in db_content.split('\\n') if l.startswith('[NCA]')])} NCA entries", file=sys.stderr)
+        db_lines = db_content.split("\n")
+        print(f"  {len([l for l in db_lines if l.startswith('[FUSE]')])} fuse entries", file=sys.stderr)
+        print(f"  {len([l for l in db_lines if l.startswith('[NCA]')])} NCA entries", file=sys.stderr)
+
+        nca_entries = sorted(entries, key=lambda e: e.version_obj, reverse=True)
+        bin_content = generate_bin(group_fuse_ranges(entries), [(e.version, e.nca) for e in nca_entries],
+                                   db_content.encode())
+        write_bin(args.bin_output or bin_path_for(args.output), bin_content)
 
 
 if __name__ == "__main__":
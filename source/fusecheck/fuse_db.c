@@ -0,0 +1,516 @@
+/*
+ * Fuse Compatibility Checker
+ * Based on TegraExplorer, Lockpick_RCM, and fuse-check
+ *
+ * Copyright (c) 2018-2025 CTCaer, shchmue, and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+#include <string.h>
+#include <ctype.h>
+
+#include "fuse_db.h"
+#include "profile.h"
+#include <libs/fatfs/ff.h>
+#include <mem/heap.h>
+#include <utils/sprintf.h>
+#include <utils/types.h>
+#include <utils/util.h>
+
+nca_entry_t nca_db[MAX_NCA_ENTRIES];
+size_t nca_db_count = 0;
+
+fuse_count_entry_t fuse_db[MAX_FUSE_ENTRIES];
+size_t fuse_db_count = 0;
+static bool fuse_db_sorted = true;  // Cleared while overlapping ranges keep file order
+
+// Open addressed (linear probing) table of nca_db indices + 1, 0 marks a free slot.
+static u16 nca_index[NCA_INDEX_SIZE];
+static bool nca_db_has_unindexed = false;  // Entries whose name is not a content ID
+
+static bool database_loaded = false;
+bool database_file_loaded = false;  // Track if DB file was actually loaded from SD
+
+static bool str_ends_with(const char *s, const char *suffix) {
+    if (!s || !suffix) return false;
+    size_t ls = strlen(s);
+    size_t lsf = strlen(suffix);
+    return (ls >= lsf) && (strncmp(s + ls - lsf, suffix, lsf) == 0);
+}
+
+static void strip_newline(char *s) {
+    if (!s) return;
+    size_t len = strlen(s);
+    while (len && (s[len - 1] == '\n' || s[len - 1] == '\r')) {
+        s[len - 1] = '\0';
+        len--;
+    }
+}
+
+static int hex_nibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Decode "<32 hex chars>.nca" into its 16-byte content ID
+bool nca_name_to_content_id(const char *filename, u8 *content_id) {
+    for (int i = 0; i < NCA_CONTENT_ID_SIZE; i++) {
+        int hi = hex_nibble(filename[i * 2]);
+        if (hi < 0) return false;
+        int lo = hex_nibble(filename[i * 2 + 1]);
+        if (lo < 0) return false;
+        content_id[i] = (hi << 4) | lo;
+    }
+
+    return strcmp(filename + NCA_CONTENT_ID_SIZE * 2, ".nca") == 0;
+}
+
+// Content IDs are random, so their first word is already a good hash
+static u32 nca_index_slot(const u8 *content_id) {
+    u32 hash;
+    memcpy(&hash, content_id, sizeof(hash));
+    return hash & (NCA_INDEX_SIZE - 1);
+}
+
+// Expects nca_db[entry].content_id to be filled in
+static void nca_index_insert(size_t entry) {
+    u32 slot = nca_index_slot(nca_db[entry].content_id);
+    while (nca_index[slot]) {
+        // Keep the first entry for duplicate names, same as a linear scan
+        if (!memcmp(nca_db[nca_index[slot] - 1].content_id, nca_db[entry].content_id, NCA_CONTENT_ID_SIZE))
+            return;
+        slot = (slot + 1) & (NCA_INDEX_SIZE - 1);
+    }
+    nca_index[slot] = entry + 1;
+}
+
+// Returns the nca_db index whose filename equals filename, or -1
+int nca_db_find(const char *filename) {
+    u8 content_id[NCA_CONTENT_ID_SIZE];
+
+    if (nca_name_to_content_id(filename, content_id)) {
+        u32 slot = nca_index_slot(content_id);
+        while (nca_index[slot]) {
+            size_t entry = nca_index[slot] - 1;
+            if (!memcmp(nca_db[entry].content_id, content_id, NCA_CONTENT_ID_SIZE)) {
+                // Hex decoding ignores case, the filename match must not
+                if (strcmp(nca_db[entry].nca_filename, filename) == 0)
+                    return entry;
+                break;
+            }
+            slot = (slot + 1) & (NCA_INDEX_SIZE - 1);
+        }
+    }
+
+    if (!nca_db_has_unindexed)
+        return -1;
+
+    for (size_t i = 0; i < nca_db_count; i++) {
+        if (strcmp(nca_db[i].nca_filename, filename) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+// Parse "21.0.0-21.2.0" or "21.2.0" into packed start and end versions
+static bool parse_version_range(const char *range_str, u32 *start, u32 *end) {
+    char range_copy[32];
+    strncpy(range_copy, range_str, sizeof(range_copy) - 1);
+    range_copy[sizeof(range_copy) - 1] = '\0';
+
+    u8 maj, min, pat;
+    char *dash = strchr(range_copy, '-');
+    if (dash)
+        *dash = '\0';
+
+    if (!parse_version_string(range_copy, &maj, &min, &pat))
+        return false;
+    *start = FUSE_DB_VERSION(maj, min, pat);
+
+    if (dash) {
+        if (!parse_version_string(dash + 1, &maj, &min, &pat))
+            return false;
+        *end = FUSE_DB_VERSION(maj, min, pat);
+    } else {
+        *end = *start;
+    }
+
+    return *start <= *end;
+}
+
+static void parse_database_line(char *line) {
+    strip_newline(line);
+
+    const char *p = line;
+    while (*p && isspace((unsigned char)*p)) p++;
+
+    // Skip comments and empty lines
+    if (*p == '\0' || *p == '#') return;
+
+    // Check for [NCA] prefix
+    if (p[0] == '[' && p[1] == 'N' && p[2] == 'C' && p[3] == 'A' && p[4] == ']') {
+        if (nca_db_count >= MAX_NCA_ENTRIES) return;
+
+        p += 5; // Skip "[NCA]"
+        while (*p && isspace((unsigned char)*p)) p++;
+
+        // Parse version
+        char version[16] = {0};
+        int vi = 0;
+        while (*p && !isspace((unsigned char)*p) && vi < 15) {
+            version[vi++] = *p++;
+        }
+        while (*p && isspace((unsigned char)*p)) p++;
+
+        // Parse NCA filename
+        char filename[64] = {0};
+        int fi = 0;
+        while (*p && !isspace((unsigned char)*p) && fi < 63) {
+            filename[fi++] = *p++;
+        }
+
+        if (version[0] && filename[0] && str_ends_with(filename, ".nca")) {
+            u8 tmp_maj = 0, tmp_min = 0, tmp_pat = 0;
+            if (parse_version_string(version, &tmp_maj, &tmp_min, &tmp_pat)) {
+                nca_entry_t *entry = &nca_db[nca_db_count];
+                strncpy(entry->version, version, sizeof(entry->version) - 1);
+                strncpy(entry->nca_filename, filename, sizeof(entry->nca_filename) - 1);
+                entry->packed_version = FUSE_DB_VERSION(tmp_maj, tmp_min, tmp_pat);
+                if (nca_name_to_content_id(entry->nca_filename, entry->content_id))
+                    nca_index_insert(nca_db_count);
+                else
+                    nca_db_has_unindexed = true;
+                nca_db_count++;
+            }
+        }
+    }
+    // Check for [FUSE] prefix
+    else if (p[0] == '[' && p[1] == 'F' && p[2] == 'U' && p[3] == 'S' && p[4] == 'E' && p[5] == ']') {
+        if (fuse_db_count >= MAX_FUSE_ENTRIES) return;
+
+        p += 6; // Skip "[FUSE]"
+        while (*p && isspace((unsigned char)*p)) p++;
+
+        // Parse version range
+        char version_range[32] = {0};
+        int vi = 0;
+        while (*p && !isspace((unsigned char)*p) && vi < 31) {
+            version_range[vi++] = *p++;
+        }
+        while (*p && isspace((unsigned char)*p)) p++;
+
+        // Parse production fuses
+        int prod_fuses = 0;
+        while (*p >= '0' && *p <= '9') {
+            prod_fuses = prod_fuses * 10 + (*p - '0');
+            p++;
+        }
+
+        // Ranges are parsed once here, entries that can never match are dropped
+        u32 start, end;
+        if (version_range[0] && prod_fuses >= 0 && prod_fuses <= 255 && parse_version_range(version_range, &start, &end)) {
+            strncpy(fuse_db[fuse_db_count].version_range, version_range, sizeof(fuse_db[fuse_db_count].version_range) - 1);
+            fuse_db[fuse_db_count].prod_fuses = (u8)prod_fuses;
+            fuse_db[fuse_db_count].start = start;
+            fuse_db[fuse_db_count].end = end;
+            fuse_db_count++;
+        }
+    }
+}
+
+// Stable insertion sort by start version, for the binary search in get_required_fuses.
+// Overlapping ranges from a text database keep file order, so the first match still wins.
+static void sort_fuse_db(void) {
+    fuse_db_sorted = false;
+    for (size_t i = 1; i < fuse_db_count; i++) {
+        for (size_t j = 0; j < i; j++) {
+            if (fuse_db[i].start <= fuse_db[j].end && fuse_db[j].start <= fuse_db[i].end) {
+                char buf[96];
+                s_printf(buf, "DB: fuse ranges %s and %s overlap, using file order",
+                    fuse_db[j].version_range, fuse_db[i].version_range);
+                debug_log(buf);
+                return;
+            }
+        }
+    }
+
+    for (size_t i = 1; i < fuse_db_count; i++) {
+        fuse_count_entry_t tmp = fuse_db[i];
+        size_t j = i;
+        while (j > 0 && fuse_db[j - 1].start > tmp.start) {
+            fuse_db[j] = fuse_db[j - 1];
+            j--;
+        }
+        fuse_db[j] = tmp;
+    }
+    fuse_db_sorted = true;
+}
+
+static void format_version(char *buf, u32 version) {
+    s_printf(buf, "%d.%d.%d", (int)(version >> 16), (int)((version >> 8) & 0xFF), (int)(version & 0xFF));
+}
+
+// Fill nca_db and fuse_db from a binary database image, rejecting anything malformed
+bool load_database_from_bin(const void *buf, u32 size) {
+    static const char hex[] = "0123456789abcdef";
+    const fuse_db_bin_hdr_t *hdr = (const fuse_db_bin_hdr_t *)buf;
+
+    if (size < sizeof(fuse_db_bin_hdr_t) || hdr->magic != FUSE_DB_BIN_MAGIC ||
+        hdr->version != FUSE_DB_BIN_VERSION || hdr->header_size != sizeof(fuse_db_bin_hdr_t) ||
+        hdr->fuse_count > MAX_FUSE_ENTRIES || hdr->nca_count > MAX_NCA_ENTRIES)
+        return false;
+
+    u32 data_size = hdr->fuse_count * sizeof(fuse_db_bin_range_t) + hdr->nca_count * sizeof(fuse_db_bin_nca_t);
+    if (size != sizeof(fuse_db_bin_hdr_t) + data_size)
+        return false;
+
+    const u8 *data = (const u8 *)buf + sizeof(fuse_db_bin_hdr_t);
+    if (crc32_calc(0, data, data_size) != hdr->checksum)
+        return false;
+
+    const fuse_db_bin_range_t *ranges = (const fuse_db_bin_range_t *)data;
+    for (u32 i = 0; i < hdr->fuse_count; i++) {
+        if (ranges[i].start > ranges[i].end || (i && ranges[i].start <= ranges[i - 1].end))
+            return false;
+    }
+
+    memset(nca_index, 0, sizeof(nca_index));
+    nca_db_has_unindexed = false;
+
+    for (u32 i = 0; i < hdr->fuse_count; i++) {
+        fuse_count_entry_t *entry = &fuse_db[i];
+        entry->start = ranges[i].start;
+        entry->end = ranges[i].end;
+        entry->prod_fuses = ranges[i].prod_fuses;
+
+        format_version(entry->version_range, entry->start);
+        if (entry->end != entry->start) {
+            u32 len = strlen(entry->version_range);
+            entry->version_range[len] = '-';
+            format_version(entry->version_range + len + 1, entry->end);
+        }
+    }
+    fuse_db_count = hdr->fuse_count;
+    fuse_db_sorted = true;
+
+    const fuse_db_bin_nca_t *ncas = (const fuse_db_bin_nca_t *)(ranges + hdr->fuse_count);
+    for (u32 i = 0; i < hdr->nca_count; i++) {
+        nca_entry_t *entry = &nca_db[i];
+        entry->packed_version = ncas[i].version;
+        memcpy(entry->content_id, ncas[i].content_id, NCA_CONTENT_ID_SIZE);
+        format_version(entry->version, entry->packed_version);
+
+        for (u32 j = 0; j < NCA_CONTENT_ID_SIZE; j++) {
+            entry->nca_filename[j * 2] = hex[entry->content_id[j] >> 4];
+            entry->nca_filename[j * 2 + 1] = hex[entry->content_id[j] & 0xF];
+        }
+        strcpy(entry->nca_filename + NCA_CONTENT_ID_SIZE * 2, ".nca");
+
+        nca_index_insert(i);
+    }
+    nca_db_count = hdr->nca_count;
+
+    return true;
+}
+
+// Whether a binary database was built from this text database. Editing the text
+// by hand leaves the binary stale.
+bool fuse_db_bin_matches_text(const void *buf, u32 size, const char *text, u32 text_size) {
+    const fuse_db_bin_hdr_t *hdr = (const fuse_db_bin_hdr_t *)buf;
+
+    return size >= sizeof(fuse_db_bin_hdr_t) && hdr->text_size == text_size &&
+        hdr->text_crc == crc32_calc(0, (const u8 *)text, text_size);
+}
+
+// Prefer the binary database, a missing, invalid or stale one falls back to the text file
+static bool load_database_bin_file(const char *text, u32 text_size) {
+    static u8 bin_buf[FUSE_DB_BIN_MAX_SIZE] __attribute__((aligned(4)));
+    FIL fp;
+    UINT br = 0;
+
+    if (f_open(&fp, DATABASE_BIN_PATH, FA_READ) != FR_OK)
+        return false;
+
+    u32 size = f_size(&fp);
+    bool ok = size <= sizeof(bin_buf) && f_read(&fp, bin_buf, size, &br) == FR_OK && br == size;
+    f_close(&fp);
+
+    if (ok && text && !fuse_db_bin_matches_text(bin_buf, size, text, text_size)) {
+        debug_log("DB: binary database does not match the text, using text");
+        return false;
+    }
+
+    if (!ok || !load_database_from_bin(bin_buf, size)) {
+        debug_log("DB: invalid binary database, using text");
+        return false;
+    }
+
+    return true;
+}
+
+static void log_database_counts(void) {
+    char buf[64];
+    s_printf(buf, "DB: loaded %d NCA, %d fuse entries", (int)nca_db_count, (int)fuse_db_count);
+    debug_log(buf);
+}
+
+// Parse a text image of the database, splitting lines the same way f_gets does.
+static void parse_database_text(const char *buf, u32 size) {
+    char line[128];
+    u32 pos = 0;
+    while (pos < size) {
+        // Keep the newline, truncate long lines.
+        u32 len = 0;
+        while (pos < size && len < sizeof(line) - 1) {
+            char c = buf[pos++];
+            line[len++] = c;
+            if (c == '\n')
+                break;
+        }
+        line[len] = '\0';
+        parse_database_line(line);
+    }
+    sort_fuse_db();
+}
+
+// The whole text file, or NULL if there is none.
+static char *read_database_text(u32 *size) {
+    FIL fp;
+    UINT br = 0;
+
+    if (f_open(&fp, DATABASE_PATH, FA_READ) != FR_OK)
+        return NULL;
+
+    *size = f_size(&fp);
+    char *text = (char *)malloc(*size);
+    if (f_read(&fp, text, *size, &br) != FR_OK || br != *size) {
+        free(text);
+        text = NULL;
+    }
+    f_close(&fp);
+
+    return text;
+}
+
+static void read_database(void) {
+    u32 text_size = 0;
+    char *text = read_database_text(&text_size);
+
+    if (load_database_bin_file(text, text_size)) {
+        free(text);
+        database_file_loaded = true;
+        log_database_counts();
+        return;
+    }
+
+    if (!text) {
+        debug_log("DB: file not found, using built-in data");
+        return;
+    }
+    database_file_loaded = true;  // File successfully read
+
+    parse_database_text(text, text_size);
+    free(text);
+
+    log_database_counts();
+}
+
+// Unified database loader
+void load_database(void) {
+    if (database_loaded)
+        return;
+
+    database_loaded = true;
+    database_file_loaded = false;  // Reset flag
+
+    PROFILE_BEGIN(span, "load_database");
+    read_database();
+    PROFILE_END(span);
+}
+
+// Same as load_database but parses an already loaded text image of the database.
+// Used by tools that do not have the SD card mounted (e.g. the host build).
+bool load_database_from_buffer(const char *buf, u32 size) {
+    if (database_loaded)
+        return database_file_loaded;
+
+    database_loaded = true;
+    database_file_loaded = true;
+
+    parse_database_text(buf, size);
+
+    log_database_counts();
+
+    return true;
+}
+
+u8 get_required_fuses(u8 major, u8 minor, u8 patch) {
+    u32 version = FUSE_DB_VERSION(major, minor, patch);
+
+    if (!fuse_db_sorted) {
+        for (size_t i = 0; i < fuse_db_count; i++) {
+            if (fuse_db[i].start <= version && version <= fuse_db[i].end)
+                return fuse_db[i].prod_fuses;
+        }
+        return 1;
+    }
+
+    // Find the last range starting at or before version
+    size_t lo = 0, hi = fuse_db_count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (fuse_db[mid].start <= version)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo && version <= fuse_db[lo - 1].end)
+        return fuse_db[lo - 1].prod_fuses;
+
+    // Fallback: return 1 if database not loaded or version not found
+    return 1;
+}
+
+// Helper function to parse version string like "18.0.1" into major, minor, patch
+bool parse_version_string(const char *version_str, u8 *major, u8 *minor, u8 *patch) {
+    if (!version_str) return false;
+
+    // Manual parsing without sscanf
+    int maj = 0, min = 0, pat = 0;
+    const char *p = version_str;
+
+    // Parse major
+    while (*p >= '0' && *p <= '9') {
+        maj = maj * 10 + (*p - '0');
+        p++;
+    }
+    if (*p != '.') return false;
+    p++;
+
+    // Parse minor
+    while (*p >= '0' && *p <= '9') {
+        min = min * 10 + (*p - '0');
+        p++;
+    }
+
+    // Parse patch if exists
+    if (*p == '.') {
+        p++;
+        while (*p >= '0' && *p <= '9') {
+            pat = pat * 10 + (*p - '0');
+            p++;
+        }
+    }
+
+    *major = (u8)maj;
+    *minor = (u8)min;
+    *patch = (u8)pat;
+    return true;
+}
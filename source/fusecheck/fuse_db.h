@@ -0,0 +1,98 @@
+/*
+ * Fuse Compatibility Checker
+ * Based on TegraExplorer, Lockpick_RCM, and fuse-check
+ *
+ * Copyright (c) 2018-2025 CTCaer, shchmue, and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+#ifndef _FUSE_DB_H_
+#define _FUSE_DB_H_
+
+#include <string.h>
+
+#include <utils/types.h>
+
+// Unified database (NCA + Fuse Count) loaded from SD
+#define DATABASE_PATH "sd:/config/fusecheck/fusecheck_db.txt"
+#define DATABASE_BIN_PATH "sd:/config/fusecheck/fusecheck_db.bin"
+#define MAX_NCA_ENTRIES 256
+#define MAX_FUSE_ENTRIES 64
+
+// Content ID index over nca_db. Power of two, kept at most half full.
+#define NCA_INDEX_SIZE (MAX_NCA_ENTRIES * 2)
+#define NCA_CONTENT_ID_SIZE 0x10
+
+// Versions packed as 0x00MMmmpp, so they compare as plain integers
+#define FUSE_DB_VERSION(maj, min, pat) (((u32)(maj) << 16) | ((u32)(min) << 8) | (u32)(pat))
+
+typedef struct {
+    char version[16];
+    char nca_filename[64];
+    u8 content_id[NCA_CONTENT_ID_SIZE];
+    u32 packed_version;
+} nca_entry_t;
+
+// Sorted by start version. A text database with overlapping ranges stays in file order.
+typedef struct {
+    char version_range[32];
+    u8 prod_fuses;
+    u32 start;
+    u32 end;
+} fuse_count_entry_t;
+
+// Binary database emitted by scripts/update_db.py (little endian):
+// header, fuse_count ranges sorted by start, then nca_count NCA entries.
+#define FUSE_DB_BIN_MAGIC   0x42444346 // "FCDB"
+#define FUSE_DB_BIN_VERSION 2
+
+typedef struct {
+    u32 magic;
+    u16 version;
+    u16 header_size;
+    u16 fuse_count;
+    u16 nca_count;
+    u32 checksum;  // CRC32 of everything after the header
+    u32 text_size; // Size and CRC32 of the fusecheck_db.txt it was built from,
+    u32 text_crc;  // a text database that differs makes it stale
+} fuse_db_bin_hdr_t;
+
+typedef struct {
+    u32 start;
+    u32 end;
+    u8 prod_fuses;
+    u8 rsvd[3];
+} fuse_db_bin_range_t;
+
+typedef struct {
+    u32 version;
+    u8 content_id[NCA_CONTENT_ID_SIZE];
+} fuse_db_bin_nca_t;
+
+#define FUSE_DB_BIN_MAX_SIZE (sizeof(fuse_db_bin_hdr_t) + \
+    MAX_FUSE_ENTRIES * sizeof(fuse_db_bin_range_t) + MAX_NCA_ENTRIES * sizeof(fuse_db_bin_nca_t))
+
+extern nca_entry_t nca_db[MAX_NCA_ENTRIES];
+extern size_t nca_db_count;
+
+extern fuse_count_entry_t fuse_db[MAX_FUSE_ENTRIES];
+extern size_t fuse_db_count;
+
+extern bool database_file_loaded;  // Track if DB file was actually loaded from SD
+
+void load_database(void);
+bool load_database_from_buffer(const char *buf, u32 size);
+bool load_database_from_bin(const void *buf, u32 size);
+bool fuse_db_bin_matches_text(const void *buf, u32 size, const char *text, u32 text_size);
+bool parse_version_string(const char *version_str, u8 *major, u8 *minor, u8 *patch);
+u8 get_required_fuses(u8 major, u8 minor, u8 patch);
+bool nca_name_to_content_id(const char *filename, u8 *content_id);
+int nca_db_find(const char *filename);
+
+// Provided by the frontend (no-op on hardware)
+void debug_log(const char *msg);
+
+#endif
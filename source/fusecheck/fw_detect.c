@@ -0,0 +1,202 @@
+/*
+ * Fuse Compatibility Checker
+ * Based on TegraExplorer, Lockpick_RCM, and fuse-check
+ *
+ * Copyright (c) 2018-2025 CTCaer, shchmue, and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+#include <string.h>
+
+#include "fw_detect.h"
+#include "fuse_db.h"
+#include "profile.h"
+#include <libs/fatfs/ff.h>
+#include <sec/se.h>
+#include "../storage/emummc.h"
+#include "../storage/nx_emmc.h"
+#include "../storage/nx_emmc_bis.h"
+#include <utils/list.h>
+#include <utils/sprintf.h>
+
+#define REGISTERED_PATH "bis:/Contents/registered"
+
+static fw_detect_strategy_t detect_strategy = FW_DETECT_PROBE;
+static fw_detect_stats_t detect_stats;
+
+void fw_detect_set_strategy(fw_detect_strategy_t strategy) {
+    detect_strategy = strategy;
+}
+
+void fw_detect_get_stats(fw_detect_stats_t *stats) {
+    memcpy(stats, &detect_stats, sizeof(fw_detect_stats_t));
+}
+
+// Look up the known SystemVersion NCAs by name, newest version first
+static bool probe_known_ncas(u8 *major, u8 *minor, u8 *patch) {
+    static u16 order[MAX_NCA_ENTRIES];
+    static u32 order_ver[MAX_NCA_ENTRIES];
+    char path[96];
+    FILINFO fno;
+
+    // Insertion sort, stable so equal versions keep database order
+    for (size_t i = 0; i < nca_db_count; i++) {
+        u32 ver = nca_db[i].packed_version;
+        size_t j = i;
+        while (j > 0 && order_ver[j - 1] < ver) {
+            order[j] = order[j - 1];
+            order_ver[j] = order_ver[j - 1];
+            j--;
+        }
+        order[j] = i;
+        order_ver[j] = ver;
+    }
+
+    for (size_t i = 0; i < nca_db_count; i++) {
+        const nca_entry_t *entry = &nca_db[order[i]];
+        s_printf(path, REGISTERED_PATH "/%s", entry->nca_filename);
+        detect_stats.probes++;
+        // NCAs over 4GB are stored as directories, f_stat accepts both
+        if (f_stat(path, &fno) == FR_OK) {
+            debug_log("NCA: Found match!");
+            if (parse_version_string(entry->version, major, minor, patch))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+static bool enumerate_registered(u8 *major, u8 *minor, u8 *patch) {
+    bool result = false;
+    DIR dir;
+    FILINFO fno;
+
+    debug_log("NCA: About to open directory");
+    if (f_opendir(&dir, REGISTERED_PATH) != FR_OK) {
+        debug_log("NCA: Failed to open directory");
+        return false;
+    }
+
+    debug_log("NCA: Directory opened, scanning...");
+    while (f_readdir(&dir, &fno) == FR_OK && fno.fname[0]) {
+        detect_stats.files_scanned++;
+        int idx = nca_db_find(fno.fname);
+        if (idx >= 0) {
+            debug_log("NCA: Found match!");
+            if (parse_version_string(nca_db[idx].version, major, minor, patch))
+                result = true;
+        }
+        if (result) break;
+    }
+    char buf[64];
+    s_printf(buf, "NCA: Scanned %d files", (int)detect_stats.files_scanned);
+    debug_log(buf);
+    f_closedir(&dir);
+    debug_log("NCA: Directory closed");
+
+    return result;
+}
+
+// Detect firmware from SystemVersion NCA in SYSTEM partition
+// Requires BIS key 2 to be derived and set in SE
+bool detect_firmware_from_nca(u8 *major, u8 *minor, u8 *patch, key_storage_t *keys) {
+    bool result = false;
+
+    debug_log("NCA: Start");
+    memset(&detect_stats, 0, sizeof(detect_stats));
+
+    // Try loading database (once) before scanning
+    load_database();
+    bool use_external_db = nca_db_count > 0;
+    debug_log(use_external_db ? "NCA: Using database" : "NCA: No database loaded");
+
+    // Initialize GPT list properly
+    LIST_INIT(gpt);
+
+    // Check if we have BIS key 2 (required for SYSTEM partition)
+    if (!key_exists(keys->bis_key[2])) {
+        debug_log("NCA: No BIS key 2");
+        return false;
+    }
+    debug_log("NCA: BIS key 2 exists");
+
+    // Set BIS key 2 in the security engine for SYSTEM partition
+    se_aes_key_set(KS_BIS_02_CRYPT, keys->bis_key[2] + 0x00, SE_KEY_128_SIZE);
+    se_aes_key_set(KS_BIS_02_TWEAK, keys->bis_key[2] + 0x10, SE_KEY_128_SIZE);
+    debug_log("NCA: BIS keys set in SE");
+
+    // Set eMMC to GPP partition
+    if (!emummc_storage_set_mmc_partition(EMMC_GPP)) {
+        debug_log("NCA: Failed to set GPP partition");
+        return false;
+    }
+    debug_log("NCA: GPP partition set");
+
+    // Parse GPT
+    PROFILE_BEGIN(gpt_span, "nx_emmc_gpt_parse");
+    nx_emmc_gpt_parse(&gpt, &emmc_storage);
+    PROFILE_END(gpt_span);
+    debug_log("NCA: GPT parsed");
+
+    // Find SYSTEM partition
+    emmc_part_t *system_part = nx_emmc_part_find(&gpt, "SYSTEM");
+    if (!system_part) {
+        debug_log("NCA: SYSTEM partition not found");
+        nx_emmc_gpt_free(&gpt);
+        return false;
+    }
+    debug_log("NCA: SYSTEM partition found");
+
+    // Initialize BIS for SYSTEM partition
+    PROFILE_BEGIN(mount_span, "bis_mount");
+    debug_log("NCA: About to call nx_emmc_bis_init");
+    nx_emmc_bis_init(system_part);
+    debug_log("NCA: nx_emmc_bis_init done");
+
+    // Mount SYSTEM partition
+    debug_log("NCA: About to mount SYSTEM");
+    FRESULT mount_res = f_mount(&emmc_fs, "bis:", 1);
+    PROFILE_END(mount_span);
+    if (mount_res != FR_OK) {
+        debug_log("NCA: Mount failed");
+        f_mount(NULL, "bis:", 1);
+        nx_emmc_gpt_free(&gpt);
+        return false;
+    }
+    debug_log("NCA: SYSTEM mounted");
+
+    // Search for NCA files in /Contents/registered/
+    PROFILE_BEGIN(scan_span, "nca_scan");
+    if (use_external_db) {
+        if (detect_strategy == FW_DETECT_PROBE) {
+            detect_stats.strategy = FW_DETECT_PROBE;
+            result = probe_known_ncas(major, minor, patch);
+        }
+
+        // No name matched (or probing is disabled), scan the whole directory as before
+        if (!result) {
+            detect_stats.strategy = FW_DETECT_ENUMERATE;
+            result = enumerate_registered(major, minor, patch);
+        }
+    }
+    PROFILE_END(scan_span);
+
+    nx_emmc_bis_stats_t bis_stats;
+    nx_emmc_bis_get_stats(&bis_stats);
+    detect_stats.clusters_decrypted = bis_stats.clusters_decrypted;
+    char buf[64];
+    s_printf(buf, "NCA: %d probes, %d clusters decrypted", (int)detect_stats.probes, (int)detect_stats.clusters_decrypted);
+    debug_log(buf);
+
+    // Unmount and cleanup
+    debug_log("NCA: Unmounting");
+    f_mount(NULL, "bis:", 1);
+    nx_emmc_gpt_free(&gpt);
+    debug_log("NCA: Cleanup done");
+
+    return result;
+}
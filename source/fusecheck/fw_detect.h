@@ -0,0 +1,34 @@
+/*
+ * Fuse Compatibility Checker
+ * Based on TegraExplorer, Lockpick_RCM, and fuse-check
+ *
+ * Copyright (c) 2018-2025 CTCaer, shchmue, and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+#ifndef _FW_DETECT_H_
+#define _FW_DETECT_H_
+
+#include "../keys/crypto.h"
+#include <utils/types.h>
+
+typedef enum {
+    FW_DETECT_PROBE = 0,      // f_stat known SystemVersion NCAs newest first, enumerate on miss
+    FW_DETECT_ENUMERATE = 1,  // Scan all of Contents/registered
+} fw_detect_strategy_t;
+
+typedef struct {
+    fw_detect_strategy_t strategy;  // Strategy that produced the result
+    u32 probes;                     // f_stat calls made
+    u32 files_scanned;              // Directory entries read while enumerating
+    u32 clusters_decrypted;         // BIS clusters decrypted while mounted
+} fw_detect_stats_t;
+
+void fw_detect_set_strategy(fw_detect_strategy_t strategy);
+void fw_detect_get_stats(fw_detect_stats_t *stats);
+bool detect_firmware_from_nca(u8 *major, u8 *minor, u8 *patch, key_storage_t *keys);
+
+#endif
@@ -0,0 +1,115 @@
+/*
+ * Fuse Compatibility Checker
+ * Boot stage profiler
+ *
+ * Copyright (c) 2018-2025 CTCaer, shchmue, and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+#include "profile.h"
+
+#ifdef FUSECHECK_PROFILE
+
+#include <string.h>
+
+#include <libs/fatfs/ff.h>
+#include <mem/heap.h>
+#include <storage/nx_sd.h>
+#include <utils/sprintf.h>
+#include <utils/util.h>
+
+static profile_span_t spans[PROFILE_MAX_SPANS];
+static u32 span_seq;    // Spans started so far, slot is seq % PROFILE_MAX_SPANS
+static u32 span_depth;
+static u32 base_us;
+
+void profile_init(void) {
+    span_seq = 0;
+    span_depth = 0;
+    base_us = get_tmr_us();
+}
+
+// Open a span that started at start_us (relative to profile_init), for work
+// done before a span id could be kept, e.g. ahead of the stack pivot.
+u32 profile_begin_at(const char *name, u32 start_us) {
+    profile_span_t *span = &spans[span_seq % PROFILE_MAX_SPANS];
+    span->name = name;
+    span->start_us = start_us;
+    span->end_us = start_us;
+    span->depth = span_depth++;
+
+    return span_seq++;
+}
+
+u32 profile_begin(const char *name) {
+    return profile_begin_at(name, get_tmr_us() - base_us);
+}
+
+void profile_end(u32 id) {
+    if (span_depth)
+        span_depth--;
+
+    // Already overwritten by newer spans.
+    if (span_seq - id > PROFILE_MAX_SPANS)
+        return;
+
+    spans[id % PROFILE_MAX_SPANS].end_us = get_tmr_us() - base_us;
+}
+
+// Copy out the retained spans, oldest first.
+u32 profile_get_spans(profile_span_t *out, u32 max) {
+    u32 count = MIN(MIN(span_seq, PROFILE_MAX_SPANS), max);
+    u32 first = span_seq - count;
+
+    for (u32 i = 0; i < count; i++)
+        out[i] = spans[(first + i) % PROFILE_MAX_SPANS];
+
+    return count;
+}
+
+// Writes the trace as CSV and as Chrome trace JSON (chrome://tracing, Perfetto).
+int profile_save(void) {
+    profile_span_t *trace = (profile_span_t *)malloc(sizeof(spans));
+    u32 count = profile_get_spans(trace, PROFILE_MAX_SPANS);
+
+    // Longest row is bounded by the name, keep names short.
+    const u32 row_size = 160;
+    char *buf = (char *)malloc(row_size * (count + 2));
+    int res = 0;
+
+    f_mkdir("sd:/config");
+    f_mkdir(PROFILE_DIR);
+
+    char *pos = buf;
+    strcpy(pos, "name,start_us,duration_us,depth\n");
+    pos += strlen(pos);
+    for (u32 i = 0; i < count; i++) {
+        s_printf(pos, "%s,%d,%d,%d\n", trace[i].name, (int)trace[i].start_us,
+            (int)(trace[i].end_us - trace[i].start_us), (int)trace[i].depth);
+        pos += strlen(pos);
+    }
+    res |= sd_save_to_file(buf, pos - buf, PROFILE_CSV_PATH);
+
+    pos = buf;
+    strcpy(pos, "{\"traceEvents\":[\n");
+    pos += strlen(pos);
+    for (u32 i = 0; i < count; i++) {
+        s_printf(pos, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%d,\"dur\":%d,\"pid\":1,\"tid\":1}%s\n",
+            trace[i].name, (int)trace[i].start_us, (int)(trace[i].end_us - trace[i].start_us),
+            i + 1 < count ? "," : "");
+        pos += strlen(pos);
+    }
+    strcpy(pos, "],\"displayTimeUnit\":\"ms\"}\n");
+    pos += strlen(pos);
+    res |= sd_save_to_file(buf, pos - buf, PROFILE_JSON_PATH);
+
+    free(buf);
+    free(trace);
+
+    return res;
+}
+
+#endif
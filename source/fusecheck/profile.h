@@ -0,0 +1,56 @@
+/*
+ * Fuse Compatibility Checker
+ * Boot stage profiler
+ *
+ * Copyright (c) 2018-2025 CTCaer, shchmue, and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+#include <utils/types.h>
+
+// Build with -DFUSECHECK_PROFILE to record boot stage spans. Without it every
+// hook below compiles to nothing.
+#define PROFILE_DIR       "sd:/config/fusecheck"
+#define PROFILE_CSV_PATH  PROFILE_DIR "/boot_profile.csv"
+#define PROFILE_JSON_PATH PROFILE_DIR "/boot_trace.json"
+#define PROFILE_MAX_SPANS 64  // Ring buffer, the oldest spans are overwritten
+
+typedef struct {
+    const char *name;  // Must outlive the trace (string literal)
+    u32 start_us;      // Relative to profile_init
+    u32 end_us;        // Equal to start_us while the span is open
+    u32 depth;         // Spans open around this one
+} profile_span_t;
+
+#ifdef FUSECHECK_PROFILE
+
+void profile_init(void);
+u32  profile_begin(const char *name);
+u32  profile_begin_at(const char *name, u32 start_us);
+void profile_end(u32 id);
+u32  profile_get_spans(profile_span_t *out, u32 max);
+int  profile_save(void);
+
+#define PROFILE_BEGIN(var, name) u32 var = profile_begin(name)
+#define PROFILE_BEGIN_AT(var, name, start_us) u32 var = profile_begin_at(name, start_us)
+#define PROFILE_END(var)         profile_end(var)
+
+#else
+
+static inline void profile_init(void) { }
+static inline u32  profile_get_spans(profile_span_t *out, u32 max) { return 0; }
+static inline int  profile_save(void) { return 0; }
+
+#define PROFILE_BEGIN(var, name)
+#define PROFILE_BEGIN_AT(var, name, start_us)
+#define PROFILE_END(var)
+
+#endif
+
+#endif
@@ -21,9 +21,12 @@
 #include "../config.h"
 #include <gfx_utils.h>
 #include "../gfx/tui.h"
+#include <libs/fatfs/ff.h>
+#include <mem/heap.h>
 #include <mem/minerva.h>
 #include <sec/se.h>
 #include <sec/se_t210.h>
+#include <storage/nx_sd.h>
 
 #include <string.h>
 
@@ -117,7 +120,140 @@ bool decrypt_eticket_rsa_key(key_storage_t *keys, void *buffer, bool is_dev) {
     return true;
 }
 
-void es_decode_tickets(u32 buf_size, titlekey_buffer_t *titlekey_buffer, u32 remaining, u32 total, u32 *titlekey_count, u32 x, u32 y, u32 *pct, u32 *last_pct, bool is_personalized) {
+// Derives the cache keys from the device key. Returns false when there is no device key to bind the cache to.
+bool es_titlekey_cache_init(titlekey_cache_t *cache, key_storage_t *keys) {
+    memset(cache, 0, sizeof(*cache));
+
+    if ((!h_cfg.t210b01 && !key_exists(keys->device_key)) || (h_cfg.t210b01 && (!key_exists(keys->master_key[0]) || !key_exists(keys->device_key_4x)))) {
+        return false;
+    }
+
+    u32 device_key[SE_KEY_128_SIZE / 4] = {0};
+    get_device_key(KS_AES_ECB, keys, device_key, 0);
+    load_aes_key(KS_AES_ECB, cache->crypt_key, device_key, titlekey_cache_crypt_key_source);
+    load_aes_key(KS_AES_ECB, cache->mac_key, device_key, titlekey_cache_mac_key_source);
+    memset(device_key, 0, sizeof(device_key));
+
+    return true;
+}
+
+// Folds one ticket_list.bin block into the list hash: hash = SHA256(hash || SHA256(block))
+void es_titlekey_cache_hash_list(titlekey_cache_t *cache, const void *buf, u32 size) {
+    u8 chain[SE_SHA_256_SIZE * 2] __attribute__((aligned(4)));
+    memcpy(chain, cache->list_hash, SE_SHA_256_SIZE);
+    se_calc_sha256_oneshot(chain + SE_SHA_256_SIZE, buf, size);
+    se_calc_sha256_oneshot(cache->list_hash, chain, sizeof(chain));
+}
+
+static u32 _titlekey_cache_slot(const titlekey_cache_t *cache, u64 ticket_id) {
+    return ((u32)(ticket_id ^ (ticket_id >> 32)) * 0x9E3779B1) & cache->index_mask;
+}
+
+// Reads the cache from SD once the list hash is complete. A missing, stale or foreign cache just starts empty.
+void es_titlekey_cache_load(titlekey_cache_t *cache, u32 ticket_count) {
+    cache->new_capacity = ticket_count;
+    cache->new_entries = calloc(MAX(ticket_count, 1), sizeof(titlekey_cache_entry_t));
+
+    u32 size = 0;
+    u8 *buf = sd_file_read(TITLEKEY_CACHE_PATH, &size);
+    if (!buf)
+        return;
+
+    titlekey_cache_hdr_t *hdr = (titlekey_cache_hdr_t *)buf;
+    titlekey_cache_body_t *body = (titlekey_cache_body_t *)(buf + sizeof(titlekey_cache_hdr_t));
+    u32 body_size = size - sizeof(titlekey_cache_hdr_t);
+    if (size < sizeof(titlekey_cache_hdr_t) + sizeof(titlekey_cache_body_t) || hdr->magic != TITLEKEY_CACHE_MAGIC || hdr->version != TITLEKEY_CACHE_VERSION)
+        goto out;
+
+    u8 cmac[SE_AES_CMAC_DIGEST_SIZE] __attribute__((aligned(4)));
+    se_aes_key_set(KS_AES_CMAC, cache->mac_key, SE_KEY_128_SIZE);
+    se_aes_cmac(KS_AES_CMAC, cmac, sizeof(cmac), body, body_size);
+    if (memcmp(cmac, hdr->cmac, sizeof(cmac)) != 0)
+        goto out;
+
+    se_aes_key_set(KS_AES_CTR, cache->crypt_key, SE_KEY_128_SIZE);
+    se_aes_crypt_ctr(KS_AES_CTR, body, body_size, body, body_size, hdr->ctr);
+    if (body->entry_count > (body_size - sizeof(titlekey_cache_body_t)) / sizeof(titlekey_cache_entry_t) || !body->entry_count)
+        goto out;
+
+    cache->entry_count = body->entry_count;
+    cache->entries = malloc(cache->entry_count * sizeof(titlekey_cache_entry_t));
+    memcpy(cache->entries, body + 1, cache->entry_count * sizeof(titlekey_cache_entry_t));
+    cache->list_match = memcmp(body->list_hash, cache->list_hash, sizeof(cache->list_hash)) == 0;
+
+    // Keep the index at most half full.
+    u32 index_size = 4;
+    while (index_size < cache->entry_count * 2)
+        index_size <<= 1;
+    cache->index_mask = index_size - 1;
+    cache->index = calloc(index_size, sizeof(u32));
+    for (u32 i = 0; i < cache->entry_count; i++) {
+        u32 slot = _titlekey_cache_slot(cache, cache->entries[i].ticket_id);
+        while (cache->index[slot])
+            slot = (slot + 1) & cache->index_mask;
+        cache->index[slot] = i + 1;
+    }
+
+out:
+    memset(buf, 0, size);
+    free(buf);
+}
+
+static const titlekey_cache_entry_t *_titlekey_cache_find(const titlekey_cache_t *cache, u64 ticket_id, const u8 *rights_id) {
+    if (!cache->index)
+        return NULL;
+
+    for (u32 slot = _titlekey_cache_slot(cache, ticket_id); cache->index[slot]; slot = (slot + 1) & cache->index_mask) {
+        const titlekey_cache_entry_t *entry = &cache->entries[cache->index[slot] - 1];
+        if (entry->ticket_id == ticket_id && memcmp(entry->rights_id, rights_id, sizeof(entry->rights_id)) == 0)
+            return entry;
+    }
+
+    return NULL;
+}
+
+// Writes this run's titlekeys with the current list hash. The counter comes from the list hash, so each list gets its own keystream.
+bool es_titlekey_cache_save(titlekey_cache_t *cache) {
+    u32 body_size = sizeof(titlekey_cache_body_t) + cache->new_count * sizeof(titlekey_cache_entry_t);
+    u32 size = sizeof(titlekey_cache_hdr_t) + body_size;
+    u8 *buf = calloc(1, size);
+
+    titlekey_cache_hdr_t *hdr = (titlekey_cache_hdr_t *)buf;
+    titlekey_cache_body_t *body = (titlekey_cache_body_t *)(buf + sizeof(titlekey_cache_hdr_t));
+    hdr->magic = TITLEKEY_CACHE_MAGIC;
+    hdr->version = TITLEKEY_CACHE_VERSION;
+    memcpy(hdr->ctr, cache->list_hash, sizeof(hdr->ctr));
+    memcpy(body->list_hash, cache->list_hash, sizeof(body->list_hash));
+    body->entry_count = cache->new_count;
+    memcpy(body + 1, cache->new_entries, cache->new_count * sizeof(titlekey_cache_entry_t));
+
+    se_aes_key_set(KS_AES_CTR, cache->crypt_key, SE_KEY_128_SIZE);
+    se_aes_crypt_ctr(KS_AES_CTR, body, body_size, body, body_size, hdr->ctr);
+    se_aes_key_set(KS_AES_CMAC, cache->mac_key, SE_KEY_128_SIZE);
+    se_aes_cmac(KS_AES_CMAC, hdr->cmac, sizeof(hdr->cmac), body, body_size);
+
+    f_mkdir("sd:/switch");
+    bool res = !sd_save_to_file(buf, size, TITLEKEY_CACHE_PATH);
+    free(buf);
+
+    return res;
+}
+
+void es_titlekey_cache_free(titlekey_cache_t *cache) {
+    if (cache->entries) {
+        memset(cache->entries, 0, cache->entry_count * sizeof(titlekey_cache_entry_t));
+        free(cache->entries);
+    }
+    if (cache->new_entries) {
+        memset(cache->new_entries, 0, cache->new_capacity * sizeof(titlekey_cache_entry_t));
+        free(cache->new_entries);
+    }
+    if (cache->index)
+        free(cache->index);
+    memset(cache, 0, sizeof(*cache));
+}
+
+void es_decode_tickets(u32 buf_size, titlekey_buffer_t *titlekey_buffer, u32 remaining, u32 total, u32 *titlekey_count, u32 x, u32 y, u32 *pct, u32 *last_pct, bool is_personalized, titlekey_cache_t *cache) {
     ticket_t *curr_ticket = (ticket_t *)titlekey_buffer->read_buffer;
     for (u32 i = 0; i < MIN(buf_size / sizeof(ticket_t), remaining) * sizeof(ticket_t) && curr_ticket->signature_type != 0; i += sizeof(ticket_t), curr_ticket++) {
         minerva_periodic_training();
@@ -135,9 +271,22 @@ void es_decode_tickets(u32 buf_size, titlekey_buffer_t *titlekey_buffer, u32 rem
         const u32 block_size = SE_RSA2048_DIGEST_SIZE;
         const u32 titlekey_size = sizeof(titlekey_buffer->titlekeys[0]);
         if (is_personalized) {
-            se_rsa_exp_mod(0, curr_titlekey, block_size, curr_titlekey, block_size);
-            if (rsa_oaep_decode(curr_titlekey, titlekey_size, null_hash, sizeof(null_hash), curr_titlekey, block_size) != titlekey_size)
-                continue;
+            const titlekey_cache_entry_t *cached = cache ? _titlekey_cache_find(cache, curr_ticket->ticket_id, curr_ticket->rights_id) : NULL;
+            if (cached) {
+                memcpy(curr_titlekey, cached->titlekey, titlekey_size);
+                cache->rsa_skipped++;
+            } else {
+                se_rsa_exp_mod(0, curr_titlekey, block_size, curr_titlekey, block_size);
+                if (rsa_oaep_decode(curr_titlekey, titlekey_size, null_hash, sizeof(null_hash), curr_titlekey, block_size) != titlekey_size)
+                    continue;
+            }
+
+            if (cache && cache->new_count < cache->new_capacity) {
+                titlekey_cache_entry_t *entry = &cache->new_entries[cache->new_count++];
+                entry->ticket_id = curr_ticket->ticket_id;
+                memcpy(entry->rights_id, curr_ticket->rights_id, sizeof(entry->rights_id));
+                memcpy(entry->titlekey, curr_titlekey, sizeof(entry->titlekey));
+            }
         }
         memcpy(titlekey_buffer->rights_ids[*titlekey_count], curr_ticket->rights_id, sizeof(titlekey_buffer->rights_ids[0]));
         memcpy(titlekey_buffer->titlekeys[*titlekey_count], curr_titlekey, titlekey_size);
@@ -27,6 +27,11 @@
 
 #define TICKET_SIG_TYPE_RSA2048_SHA256 0x10004
 
+// Personalized titlekeys from earlier runs, so unchanged tickets skip the RSA decrypt.
+#define TITLEKEY_CACHE_PATH    "sd:/switch/titlekey_cache.bin"
+#define TITLEKEY_CACHE_MAGIC   0x434B5454 // "TTKC"
+#define TITLEKEY_CACHE_VERSION 1
+
 static const u8 eticket_rsa_kek_source[0x10] __attribute__((aligned(4))) = {
     0xDB, 0xA4, 0x51, 0x12, 0x4C, 0xA0, 0xA9, 0x83, 0x68, 0x14, 0xF5, 0xED, 0x95, 0xE3, 0x12, 0x5B};
 static const u8 eticket_rsa_kek_source_dev[0x10] __attribute__((aligned(4))) = {
@@ -35,6 +40,11 @@ static const u8 eticket_rsa_kek_source_legacy[0x10] __attribute__((aligned(4)))
     0x88, 0x87, 0x50, 0x90, 0xA6, 0x2F, 0x75, 0x70, 0xA2, 0xD7, 0x71, 0x51, 0xAE, 0x6D, 0x39, 0x87};
 static const u8 eticket_rsa_kekek_source[0x10] __attribute__((aligned(4))) = {
     0x46, 0x6E, 0x57, 0xB7, 0x4A, 0x44, 0x7F, 0x02, 0xF3, 0x21, 0xCD, 0xE5, 0x8F, 0x2F, 0x55, 0x35};
+// Not console key sources, only used to derive the titlekey cache keys from the device key.
+static const u8 titlekey_cache_crypt_key_source[0x10] __attribute__((aligned(4))) = {
+    0x5E, 0xA3, 0x46, 0xB0, 0xAD, 0x19, 0x97, 0xD7, 0x5E, 0xE4, 0x28, 0x6C, 0x84, 0xDC, 0xA0, 0xC3};
+static const u8 titlekey_cache_mac_key_source[0x10] __attribute__((aligned(4))) = {
+    0x8B, 0x24, 0x01, 0x99, 0xC9, 0x30, 0x6C, 0x86, 0x78, 0xC9, 0x0E, 0x10, 0x5F, 0x0B, 0xCF, 0x88};
 
 bool test_eticket_rsa_keypair(const eticket_rsa_keypair_t *keypair);
 
@@ -44,6 +54,12 @@ void es_derive_rsa_kek_original(key_storage_t *keys, void *out_rsa_kek, bool is_
 
 bool decrypt_eticket_rsa_key(key_storage_t *keys, void *buffer, bool is_dev);
 
-void es_decode_tickets(u32 buf_size, titlekey_buffer_t *titlekey_buffer, u32 remaining, u32 total, u32 *titlekey_count, u32 x, u32 y, u32 *pct, u32 *last_pct, bool is_personalized);
+bool es_titlekey_cache_init(titlekey_cache_t *cache, key_storage_t *keys);
+void es_titlekey_cache_hash_list(titlekey_cache_t *cache, const void *buf, u32 size);
+void es_titlekey_cache_load(titlekey_cache_t *cache, u32 ticket_count);
+bool es_titlekey_cache_save(titlekey_cache_t *cache);
+void es_titlekey_cache_free(titlekey_cache_t *cache);
+
+void es_decode_tickets(u32 buf_size, titlekey_buffer_t *titlekey_buffer, u32 remaining, u32 total, u32 *titlekey_count, u32 x, u32 y, u32 *pct, u32 *last_pct, bool is_personalized, titlekey_cache_t *cache);
 
 #endif
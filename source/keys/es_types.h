@@ -73,4 +73,41 @@ typedef struct {
     char newline[1];
 } titlekey_text_buffer_t;
 
+// Personalized titlekey decoded on an earlier run.
+typedef struct {
+    u64 ticket_id;
+    u8 rights_id[0x10];
+    u8 titlekey[0x10];
+    u8 reserved[0x8];
+} titlekey_cache_entry_t;
+
+// Cache file: header, then the body and its entries, encrypted and authenticated as one.
+typedef struct {
+    u32 magic;
+    u32 version;
+    u8 ctr[SE_AES_IV_SIZE];
+    u8 cmac[SE_AES_CMAC_DIGEST_SIZE];
+} titlekey_cache_hdr_t;
+
+typedef struct {
+    u8 list_hash[SE_SHA_256_SIZE];
+    u32 entry_count;
+    u8 reserved[0xC];
+} titlekey_cache_body_t;
+
+typedef struct {
+    u8 crypt_key[SE_KEY_128_SIZE];
+    u8 mac_key[SE_KEY_128_SIZE];
+    u8 list_hash[SE_SHA_256_SIZE]; // Chained over the ticket_list.bin blocks.
+    bool list_match; // ticket_list.bin is unchanged since the cache was written.
+    titlekey_cache_entry_t *entries;
+    u32 entry_count;
+    u32 *index; // Open addressing on ticket id, entry index + 1, index_mask + 1 slots.
+    u32 index_mask;
+    titlekey_cache_entry_t *new_entries; // Decoded this run, written back by es_titlekey_cache_save().
+    u32 new_count;
+    u32 new_capacity;
+    u32 rsa_skipped;
+} titlekey_cache_t;
+
 #endif
@@ -246,7 +246,7 @@ static bool _count_ticket_records(u32 buf_size, titlekey_buffer_t *titlekey_buff
     return false;
 }
 
-static bool _get_titlekeys_from_save(u32 buf_size, const u8 *save_mac_key, titlekey_buffer_t *titlekey_buffer, eticket_rsa_keypair_t *rsa_keypair) {
+static bool _get_titlekeys_from_save(u32 buf_size, const u8 *save_mac_key, titlekey_buffer_t *titlekey_buffer, eticket_rsa_keypair_t *rsa_keypair, titlekey_cache_t *cache) {
     FIL fp;
     u64 br = buf_size;
     u64 offset = 0;
@@ -271,7 +271,7 @@ static bool _get_titlekeys_from_save(u32 buf_size, const u8 *save_mac_key, title
     }
 
     save_ctx_t *save_ctx = calloc(1, sizeof(save_ctx_t));
-    save_init(save_ctx, &fp, save_mac_key, 0);
+    save_init(save_ctx, &fp, save_mac_key, ACTION_FAST_SEEK);
 
     bool save_process_success = save_process(save_ctx);
     TPRINTF("\n  Save process...");
@@ -297,15 +297,32 @@ static bool _get_titlekeys_from_save(u32 buf_size, const u8 *save_mac_key, title
         minerva_periodic_training();
         if (!save_data_file_read(&ticket_file, &br, offset, titlekey_buffer->read_buffer, buf_size) ||
             titlekey_buffer->read_buffer[0] == 0 ||
-            br != buf_size ||
-            _count_ticket_records(buf_size, titlekey_buffer, &file_tkey_count)
+            br != buf_size
         ) {
             break;
         }
+        if (cache)
+            es_titlekey_cache_hash_list(cache, titlekey_buffer->read_buffer, buf_size);
+        if (_count_ticket_records(buf_size, titlekey_buffer, &file_tkey_count))
+            break;
         offset += br;
     }
     TPRINTF("  Count titlekeys...");
 
+    if (cache)
+        es_titlekey_cache_load(cache, file_tkey_count);
+
+    // Same ticket list as when the cache was written, so it holds every titlekey and ticket.bin can be skipped.
+    if (cache && cache->list_match) {
+        for (u32 i = 0; i < cache->entry_count; i++) {
+            memcpy(titlekey_buffer->rights_ids[_titlekey_count], cache->entries[i].rights_id, sizeof(titlekey_buffer->rights_ids[0]));
+            memcpy(titlekey_buffer->titlekeys[_titlekey_count], cache->entries[i].titlekey, sizeof(titlekey_buffer->titlekeys[0]));
+            _titlekey_count++;
+        }
+        cache->rsa_skipped = cache->entry_count;
+        goto done;
+    }
+
     if (!save_open_file(save_ctx, &ticket_file, ticket_bin_path, OPEN_MODE_READ)) {
         EPRINTF("Unable to locate ticket.bin in save.");
         f_close(&fp);
@@ -323,9 +340,15 @@ static bool _get_titlekeys_from_save(u32 buf_size, const u8 *save_mac_key, title
         if (!save_data_file_read(&ticket_file, &br, offset, titlekey_buffer->read_buffer, buf_size) || titlekey_buffer->read_buffer[0] == 0 || br != buf_size)
             break;
         offset += br;
-        es_decode_tickets(buf_size, titlekey_buffer, remaining, file_tkey_count, &_titlekey_count, save_x, save_y, &pct, &last_pct, is_personalized);
+        es_decode_tickets(buf_size, titlekey_buffer, remaining, file_tkey_count, &_titlekey_count, save_x, save_y, &pct, &last_pct, is_personalized, cache);
         remaining -= MIN(buf_size / sizeof(ticket_t), remaining);
     }
+
+    // Only a complete pass describes this ticket list.
+    if (cache && !remaining && !es_titlekey_cache_save(cache))
+        EPRINTF("Unable to save titlekey cache.");
+
+done:
     tui_pbar(save_x, save_y, 100, COLOR_GREEN, 0xFF155500);
     f_close(&fp);
     save_free_contexts(save_ctx);
@@ -402,11 +425,19 @@ static bool _derive_titlekeys(key_storage_t *keys, titlekey_buffer_t *titlekey_b
     gfx_printf("%kTitlekeys...     \n", colors[(color_idx++) % 6]);
 
     const u32 buf_size = SAVE_BLOCK_SIZE_DEFAULT;
-    _get_titlekeys_from_save(buf_size, keys->save_mac_key, titlekey_buffer, NULL);
-    _get_titlekeys_from_save(buf_size, keys->save_mac_key, titlekey_buffer, &keys->eticket_rsa_keypair);
+    titlekey_cache_t cache;
+    bool use_cache = es_titlekey_cache_init(&cache, keys);
+    _get_titlekeys_from_save(buf_size, keys->save_mac_key, titlekey_buffer, NULL, NULL);
+    _get_titlekeys_from_save(buf_size, keys->save_mac_key, titlekey_buffer, &keys->eticket_rsa_keypair, use_cache ? &cache : NULL);
 
     gfx_printf("\n%k  Found %d titlekeys.\n\n", colors[(color_idx++) % 6], _titlekey_count);
 
+    if (use_cache) {
+        gfx_printf("%k  Skipped %d of %d RSA decrypts with the titlekey cache.\n\n", colors[(color_idx++) % 6], cache.rsa_skipped,
+            cache.list_match ? cache.rsa_skipped : cache.new_count);
+        es_titlekey_cache_free(&cache);
+    }
+
     return true;
 }
 
@@ -421,6 +452,7 @@ static void _derive_emmc_keys(key_storage_t *keys, titlekey_buffer_t *titlekey_b
     // SYSTEM/USER
     se_aes_key_set(KS_BIS_02_CRYPT, keys->bis_key[2] + 0x00, SE_KEY_128_SIZE);
     se_aes_key_set(KS_BIS_02_TWEAK, keys->bis_key[2] + 0x10, SE_KEY_128_SIZE);
+    nx_emmc_bis_end();
 
     if (!emummc_storage_set_mmc_partition(EMMC_GPP)) {
         EPRINTF("Unable to set partition.");
@@ -892,6 +924,8 @@ bool derive_bis_keys_silently(key_storage_t *keys_out) {
     se_aes_key_set(KS_BIS_01_TWEAK, keys->bis_key[1] + 0x10, SE_KEY_128_SIZE);
     se_aes_key_set(KS_BIS_02_CRYPT, keys->bis_key[2] + 0x00, SE_KEY_128_SIZE);
     se_aes_key_set(KS_BIS_02_TWEAK, keys->bis_key[2] + 0x10, SE_KEY_128_SIZE);
+    // Anything decrypted with the previous keys is stale.
+    nx_emmc_bis_end();
 
     minerva_change_freq(FREQ_800);
 
@@ -26,11 +26,142 @@
 #include <string.h>
 
 #include <libs/fatfs/diskio.h>	/* FatFs lower layer API */
+#include <mem/heap.h>
 #include <memory_map.h>
 #include <storage/nx_sd.h>
 #include "../../storage/nx_emmc_bis.h"
 #include <storage/sdmmc.h>
 
+/*-----------------------------------------------------------------------*/
+/* SD sector cache                                                       */
+/*-----------------------------------------------------------------------*/
+/* Write-through cache of single sector SD reads. FatFs reads FAT and    */
+/* directory sectors into its window and file data into the file buffer, */
+/* so the two are told apart by the destination and kept in separate     */
+/* pools. Multi sector transfers are never cached.                       */
+/*-----------------------------------------------------------------------*/
+#define SD_CACHE_META_SECTORS 64
+#define SD_CACHE_DATA_SECTORS 32
+#define SD_CACHE_SECTORS (SD_CACHE_META_SECTORS + SD_CACHE_DATA_SECTORS)
+#define SD_CACHE_EMPTY   0xFFFFFFFF
+
+typedef struct _sd_cache_entry_t
+{
+	u32 sector;
+	u32 last_use;
+} sd_cache_entry_t;
+
+static sd_cache_entry_t sd_cache[SD_CACHE_SECTORS];
+static u8 *sd_cache_data = NULL;
+static u32 sd_cache_tick = 0;
+static bool sd_cache_enabled = true;
+static disk_sd_cache_stats_t sd_cache_stats;
+
+static void _sd_cache_reset()
+{
+	for (u32 i = 0; i < SD_CACHE_SECTORS; i++)
+	{
+		sd_cache[i].sector = SD_CACHE_EMPTY;
+		sd_cache[i].last_use = 0;
+	}
+	sd_cache_tick = 0;
+}
+
+static DRESULT _sd_read(BYTE *buff, DWORD sector, UINT count)
+{
+	if (!sd_cache_enabled || count != 1)
+	{
+		sd_cache_stats.bypassed += count;
+		return sdmmc_storage_read(&sd_storage, sector, count, buff) ? RES_OK : RES_ERROR;
+	}
+
+	if (!sd_cache_data)
+	{
+		sd_cache_data = malloc(SD_CACHE_SECTORS * 512);
+		_sd_cache_reset();
+	}
+
+	bool meta = buff == sd_fs.win;
+	u32 first = meta ? 0 : SD_CACHE_META_SECTORS;
+	u32 end = meta ? SD_CACHE_META_SECTORS : SD_CACHE_SECTORS;
+
+	// Hit, or the least recently used entry of the pool to refill.
+	u32 victim = first;
+	for (u32 i = first; i < end; i++)
+	{
+		if (sd_cache[i].sector == sector)
+		{
+			if (meta)
+				sd_cache_stats.meta_hits++;
+			else
+				sd_cache_stats.data_hits++;
+			sd_cache[i].last_use = ++sd_cache_tick;
+			memcpy(buff, sd_cache_data + i * 512, 512);
+
+			return RES_OK;
+		}
+
+		if (sd_cache[i].last_use < sd_cache[victim].last_use)
+			victim = i;
+	}
+
+	if (meta)
+		sd_cache_stats.meta_misses++;
+	else
+		sd_cache_stats.data_misses++;
+
+	u8 *slot = sd_cache_data + victim * 512;
+	sd_cache[victim].sector = SD_CACHE_EMPTY;
+	sd_cache[victim].last_use = 0;
+	if (!sdmmc_storage_read(&sd_storage, sector, 1, slot))
+		return RES_ERROR;
+
+	sd_cache[victim].sector = sector;
+	sd_cache[victim].last_use = ++sd_cache_tick;
+	memcpy(buff, slot, 512);
+
+	return RES_OK;
+}
+
+static DRESULT _sd_write(const BYTE *buff, DWORD sector, UINT count)
+{
+	int res = sdmmc_storage_write(&sd_storage, sector, count, (void *)buff);
+	if (!sd_cache_data)
+		return res ? RES_OK : RES_ERROR;
+
+	// Refresh cached copies, or drop them if the card contents are unknown after a failure.
+	for (u32 i = 0; i < SD_CACHE_SECTORS; i++)
+	{
+		u32 offset = sd_cache[i].sector - sector;
+		if (sd_cache[i].sector == SD_CACHE_EMPTY || offset >= count)
+			continue;
+
+		if (res)
+		{
+			memcpy(sd_cache_data + i * 512, buff + offset * 512, 512);
+			sd_cache_stats.write_updates++;
+		}
+		else
+		{
+			sd_cache[i].sector = SD_CACHE_EMPTY;
+			sd_cache[i].last_use = 0;
+		}
+	}
+
+	return res ? RES_OK : RES_ERROR;
+}
+
+void disk_sd_cache_enable(bool enable)
+{
+	sd_cache_enabled = enable;
+	_sd_cache_reset();
+}
+
+void disk_sd_cache_get_stats(disk_sd_cache_stats_t *stats)
+{
+	memcpy(stats, &sd_cache_stats, sizeof(disk_sd_cache_stats_t));
+}
+
 /*-----------------------------------------------------------------------*/
 /* Get Drive Status                                                      */
 /*-----------------------------------------------------------------------*/
@@ -38,6 +169,9 @@ DSTATUS disk_status (
 	BYTE pdrv /* Physical drive number to identify the drive */
 )
 {
+	if (pdrv == DRIVE_SD && !sd_storage.initialized)
+		return STA_NOINIT;
+
 	return 0;
 }
 
@@ -48,7 +182,14 @@ DSTATUS disk_initialize (
 	BYTE pdrv /* Physical drive number to identify the drive */
 )
 {
-	return 0;
+	// A (re)mount may follow a card swap or a power cycle.
+	if (pdrv == DRIVE_SD)
+	{
+		_sd_cache_reset();
+		memset(&sd_cache_stats, 0, sizeof(disk_sd_cache_stats_t));
+	}
+
+	return disk_status(pdrv);
 }
 
 /*-----------------------------------------------------------------------*/
@@ -64,7 +205,7 @@ DRESULT disk_read (
 	switch (pdrv)
 	{
 	case DRIVE_SD:
-		return sdmmc_storage_read(&sd_storage, sector, count, buff) ? RES_OK : RES_ERROR;
+		return _sd_read(buff, sector, count);
 
 	case DRIVE_BIS:
 		return nx_emmc_bis_read(sector, count, buff);
@@ -86,7 +227,7 @@ DRESULT disk_write (
 	switch (pdrv)
 	{
 	case DRIVE_SD:
-		return sdmmc_storage_write(&sd_storage, sector, count, (void *)buff) ? RES_OK : RES_ERROR;
+		return _sd_write(buff, sector, count);
 
 	case DRIVE_BIS:
 		return nx_emmc_bis_write(sector, count, (void *)buff);
@@ -104,5 +245,33 @@ DRESULT disk_ioctl (
 	void *buff		/* Buffer to send/receive control data */
 )
 {
-	return RES_OK;
+	if (pdrv != DRIVE_SD)
+		return RES_OK;
+
+	if (!sd_storage.initialized)
+		return RES_NOTRDY;
+
+	switch (cmd)
+	{
+	case CTRL_SYNC:
+		// Writes go straight to the card, there is nothing pending.
+		return RES_OK;
+
+	case GET_SECTOR_COUNT:
+		*(DWORD *)buff = sd_storage.sec_cnt;
+		return RES_OK;
+
+	case GET_SECTOR_SIZE:
+		*(WORD *)buff = 512;
+		return RES_OK;
+
+	case GET_BLOCK_SIZE:
+		// Allocation unit in sectors, 1 if unknown.
+		*(DWORD *)buff = sd_storage_get_ssr_au(&sd_storage) * 2;
+		if (!*(DWORD *)buff)
+			*(DWORD *)buff = 1;
+		return RES_OK;
+	}
+
+	return RES_PARERR;
 }
@@ -43,12 +43,9 @@
 
 #define FF_FASTFS		0
 
-#if FF_FASTFS
 #define FF_USE_FASTSEEK	1
-#else
-#define FF_USE_FASTSEEK	0
-#endif
-/* This option switches fast seek function. (0:Disable or 1:Enable) */
+/* This option switches fast seek function. (0:Disable or 1:Enable)
+/  f_read_fast/f_write_fast and f_expand_cltbl also need FF_FASTFS. */
 
 
 #define FF_USE_EXPAND	0
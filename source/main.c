@@ -10,7 +10,6 @@
  */
 
 #include <string.h>
-#include <ctype.h>
 #include "config.h"
 #include <display/di.h>
 #include <gfx_utils.h>
@@ -31,6 +30,9 @@
 #include <utils/sprintf.h>
 #include "keys/keys.h"
 #include "keys/cal0_read.h"
+#include "fusecheck/fuse_db.h"
+#include "fusecheck/fw_detect.h"
+#include "fusecheck/profile.h"
 #include <sec/se.h>
 #include "frontend/gui.h"
 #include <input/touch.h>
@@ -59,148 +61,11 @@ const volatile ipl_ver_meta_t __attribute__((section ("._ipl_version"))) ipl_ver
 volatile nyx_storage_t *nyx_str = (nyx_storage_t *)NYX_STORAGE_ADDR;
 extern void pivot_stack(u32 stack_top);
 
-// Forward declarations
-bool parse_version_string(const char *version_str, u8 *major, u8 *minor, u8 *patch);
-void debug_log(const char *msg);
-
-// Unified database (NCA + Fuse Count) loaded from SD
-#define DATABASE_PATH "sd:/config/fusecheck/fusecheck_db.txt"
-#define MAX_NCA_ENTRIES 256
-#define MAX_FUSE_ENTRIES 64
-
-typedef struct {
-    char version[16];
-    char nca_filename[64];
-} nca_entry_t;
-
-typedef struct {
-    char version_range[32];
-    u8 prod_fuses;
-} fuse_count_entry_t;
-
-static nca_entry_t nca_db[MAX_NCA_ENTRIES];
-static size_t nca_db_count = 0;
-
-static fuse_count_entry_t fuse_db[MAX_FUSE_ENTRIES];
-static size_t fuse_db_count = 0;
-
-static bool database_loaded = false;
-static bool database_file_loaded = false;  // Track if DB file was actually loaded from SD
-
 typedef enum {
     MAIN_ACTION_FUSE_MAP = 0,
     MAIN_ACTION_EXIT = 1,
 } main_action_t;
 
-static bool str_ends_with(const char *s, const char *suffix) {
-    if (!s || !suffix) return false;
-    size_t ls = strlen(s);
-    size_t lsf = strlen(suffix);
-    return (ls >= lsf) && (strncmp(s + ls - lsf, suffix, lsf) == 0);
-}
-
-static void strip_newline(char *s) {
-    if (!s) return;
-    size_t len = strlen(s);
-    while (len && (s[len - 1] == '\n' || s[len - 1] == '\r')) {
-        s[len - 1] = '\0';
-        len--;
-    }
-}
-
-// Unified database loader
-static void load_database(void) {
-    if (database_loaded)
-        return;
-
-    database_loaded = true;
-    database_file_loaded = false;  // Reset flag
-
-    FIL fp;
-    if (f_open(&fp, DATABASE_PATH, FA_READ) != FR_OK) {
-        debug_log("DB: file not found, using built-in data");
-        return;
-    }
-    database_file_loaded = true;  // File successfully opened
-
-    char line[128];
-    while (f_gets(line, sizeof(line), &fp)) {
-        strip_newline(line);
-
-        const char *p = line;
-        while (*p && isspace((unsigned char)*p)) p++;
-
-        // Skip comments and empty lines
-        if (*p == '\0' || *p == '#') continue;
-
-        // Check for [NCA] prefix
-        if (p[0] == '[' && p[1] == 'N' && p[2] == 'C' && p[3] == 'A' && p[4] == ']') {
-            if (nca_db_count >= MAX_NCA_ENTRIES) continue;
-
-            p += 5; // Skip "[NCA]"
-            while (*p && isspace((unsigned char)*p)) p++;
-
-            // Parse version
-            char version[16] = {0};
-            int vi = 0;
-            while (*p && !isspace((unsigned char)*p) && vi < 15) {
-                version[vi++] = *p++;
-            }
-            while (*p && isspace((unsigned char)*p)) p++;
-
-            // Parse NCA filename
-            char filename[64] = {0};
-            int fi = 0;
-            while (*p && !isspace((unsigned char)*p) && fi < 63) {
-                filename[fi++] = *p++;
-            }
-
-            if (version[0] && filename[0] && str_ends_with(filename, ".nca")) {
-                u8 tmp_maj = 0, tmp_min = 0, tmp_pat = 0;
-                if (parse_version_string(version, &tmp_maj, &tmp_min, &tmp_pat)) {
-                    strncpy(nca_db[nca_db_count].version, version, sizeof(nca_db[nca_db_count].version) - 1);
-                    strncpy(nca_db[nca_db_count].nca_filename, filename, sizeof(nca_db[nca_db_count].nca_filename) - 1);
-                    nca_db_count++;
-                }
-            }
-        }
-        // Check for [FUSE] prefix
-        else if (p[0] == '[' && p[1] == 'F' && p[2] == 'U' && p[3] == 'S' && p[4] == 'E' && p[5] == ']') {
-            if (fuse_db_count >= MAX_FUSE_ENTRIES) continue;
-
-            p += 6; // Skip "[FUSE]"
-            while (*p && isspace((unsigned char)*p)) p++;
-
-            // Parse version range
-            char version_range[32] = {0};
-            int vi = 0;
-            while (*p && !isspace((unsigned char)*p) && vi < 31) {
-                version_range[vi++] = *p++;
-            }
-            while (*p && isspace((unsigned char)*p)) p++;
-
-            // Parse production fuses
-            int prod_fuses = 0;
-            while (*p >= '0' && *p <= '9') {
-                prod_fuses = prod_fuses * 10 + (*p - '0');
-                p++;
-            }
-
-            if (version_range[0] && prod_fuses >= 0 && prod_fuses <= 255) {
-                strncpy(fuse_db[fuse_db_count].version_range, version_range, sizeof(fuse_db[fuse_db_count].version_range) - 1);
-                fuse_db[fuse_db_count].prod_fuses = (u8)prod_fuses;
-                fuse_db_count++;
-            }
-        }
-    }
-
-    f_close(&fp);
-
-    char buf[64];
-    s_printf(buf, "DB: loaded %d NCA, %d fuse entries", (int)nca_db_count, (int)fuse_db_count);
-    debug_log(buf);
-}
-
 // Payload relocation defines
 #define RELOC_META_OFF      0x7C
 #define PATCHED_RELOC_SZ    0x94
@@ -309,206 +174,12 @@ u8 get_burnt_fuses() {
     return fuse_count;
 }
 
-// Helper to compare versions: returns -1 if v1 < v2, 0 if equal, 1 if v1 > v2
-static int compare_versions(u8 maj1, u8 min1, u8 pat1, u8 maj2, u8 min2, u8 pat2) {
-    if (maj1 != maj2) return (maj1 < maj2) ? -1 : 1;
-    if (min1 != min2) return (min1 < min2) ? -1 : 1;
-    if (pat1 != pat2) return (pat1 < pat2) ? -1 : 1;
-    return 0;
-}
-
-// Check if a version falls within a version range string (e.g., "21.0.0-21.2.0" or "21.2.0")
-static bool version_in_range(u8 maj, u8 min, u8 pat, const char *range_str) {
-    char range_copy[64];
-    strncpy(range_copy, range_str, sizeof(range_copy) - 1);
-    range_copy[sizeof(range_copy) - 1] = '\0';
-
-    // Check if it's a range (contains '-')
-    char *dash = strchr(range_copy, '-');
-    if (dash) {
-        // Parse range: "start-end"
-        *dash = '\0';
-        char *start = range_copy;
-        char *end = dash + 1;
-
-        u8 start_maj, start_min, start_pat;
-        u8 end_maj, end_min, end_pat;
-
-        if (!parse_version_string(start, &start_maj, &start_min, &start_pat))
-            return false;
-        if (!parse_version_string(end, &end_maj, &end_min, &end_pat))
-            return false;
-
-        // Check if version is within [start, end]
-        return (compare_versions(maj, min, pat, start_maj, start_min, start_pat) >= 0 &&
-                compare_versions(maj, min, pat, end_maj, end_min, end_pat) <= 0);
-    } else {
-        // Single version - must match exactly
-        u8 range_maj, range_min, range_pat;
-        if (!parse_version_string(range_copy, &range_maj, &range_min, &range_pat))
-            return false;
-        return (maj == range_maj && min == range_min && pat == range_pat);
-    }
-}
-
-u8 get_required_fuses(u8 major, u8 minor, u8 patch) {
-    // Try to find matching version in external database
-    for (int i = 0; i < fuse_db_count; i++) {
-        if (version_in_range(major, minor, patch, fuse_db[i].version_range)) {
-            return fuse_db[i].prod_fuses;
-        }
-    }
-
-    // Fallback: return 1 if database not loaded or version not found
-    return 1;
-}
-
-
-// Helper function to parse version string like "18.0.1" into major, minor, patch
-bool parse_version_string(const char *version_str, u8 *major, u8 *minor, u8 *patch) {
-    if (!version_str) return false;
-
-    // Manual parsing without sscanf
-    int maj = 0, min = 0, pat = 0;
-    const char *p = version_str;
-
-    // Parse major
-    while (*p >= '0' && *p <= '9') {
-        maj = maj * 10 + (*p - '0');
-        p++;
-    }
-    if (*p != '.') return false;
-    p++;
-
-    // Parse minor
-    while (*p >= '0' && *p <= '9') {
-        min = min * 10 + (*p - '0');
-        p++;
-    }
-
-    // Parse patch if exists
-    if (*p == '.') {
-        p++;
-        while (*p >= '0' && *p <= '9') {
-            pat = pat * 10 + (*p - '0');
-            p++;
-        }
-    }
-
-    *major = (u8)maj;
-    *minor = (u8)min;
-    *patch = (u8)pat;
-    return true;
-}
-
 // Helper to write debug log
 void debug_log(const char *msg) {
     // Debug logging disabled - fuse-check-debug.txt will not be created
     (void)msg;
 }
 
-// Detect firmware from SystemVersion NCA in SYSTEM partition
-// Requires BIS key 2 to be derived and set in SE
-bool detect_firmware_from_nca(u8 *major, u8 *minor, u8 *patch, key_storage_t *keys) {
-    bool result = false;
-
-    debug_log("NCA: Start");
-
-    // Try loading database (once) before scanning
-    load_database();
-    bool use_external_db = nca_db_count > 0;
-    debug_log(use_external_db ? "NCA: Using database" : "NCA: No database loaded");
-
-    // Initialize GPT list properly
-    LIST_INIT(gpt);
-
-    // Check if we have BIS key 2 (required for SYSTEM partition)
-    if (!key_exists(keys->bis_key[2])) {
-        debug_log("NCA: No BIS key 2");
-        return false;
-    }
-    debug_log("NCA: BIS key 2 exists");
-
-    // Set BIS key 2 in the security engine for SYSTEM partition
-    se_aes_key_set(KS_BIS_02_CRYPT, keys->bis_key[2] + 0x00, SE_KEY_128_SIZE);
-    se_aes_key_set(KS_BIS_02_TWEAK, keys->bis_key[2] + 0x10, SE_KEY_128_SIZE);
-    debug_log("NCA: BIS keys set in SE");
-
-    // Set eMMC to GPP partition
-    if (!emummc_storage_set_mmc_partition(EMMC_GPP)) {
-        debug_log("NCA: Failed to set GPP partition");
-        return false;
-    }
-    debug_log("NCA: GPP partition set");
-
-    // Parse GPT
-    nx_emmc_gpt_parse(&gpt, &emmc_storage);
-    debug_log("NCA: GPT parsed");
-
-    // Find SYSTEM partition
-    emmc_part_t *system_part = nx_emmc_part_find(&gpt, "SYSTEM");
-    if (!system_part) {
-        debug_log("NCA: SYSTEM partition not found");
-        nx_emmc_gpt_free(&gpt);
-        return false;
-    }
-    debug_log("NCA: SYSTEM partition found");
-
-    // Initialize BIS for SYSTEM partition
-    debug_log("NCA: About to call nx_emmc_bis_init");
-    nx_emmc_bis_init(system_part);
-    debug_log("NCA: nx_emmc_bis_init done");
-
-    // Mount SYSTEM partition
-    debug_log("NCA: About to mount SYSTEM");
-    if (f_mount(&emmc_fs, "bis:", 1) != FR_OK) {
-        debug_log("NCA: Mount failed");
-        f_mount(NULL, "bis:", 1);
-        nx_emmc_gpt_free(&gpt);
-        return false;
-    }
-    debug_log("NCA: SYSTEM mounted");
-
-    // Search for NCA files in /Contents/registered/
-    DIR dir;
-    FILINFO fno;
-    debug_log("NCA: About to open directory");
-    if (f_opendir(&dir, "bis:/Contents/registered") == FR_OK) {
-        debug_log("NCA: Directory opened, scanning...");
-        int file_count = 0;
-        while (f_readdir(&dir, &fno) == FR_OK && fno.fname[0]) {
-            file_count++;
-            if (use_external_db) {
-                for (size_t i = 0; i < nca_db_count; i++) {
-                    if (strcmp(fno.fname, nca_db[i].nca_filename) == 0) {
-                        debug_log("NCA: Found match!");
-                        if (parse_version_string(nca_db[i].version, major, minor, patch)) {
-                            result = true;
-                            break;
-                        }
-                    }
-                }
-            }
-            if (result) break;
-        }
-        char buf[64];
-        s_printf(buf, "NCA: Scanned %d files", file_count);
-        debug_log(buf);
-        f_closedir(&dir);
-        debug_log("NCA: Directory closed");
-    } else {
-        debug_log("NCA: Failed to open directory");
-    }
-
-    // Unmount and cleanup
-    debug_log("NCA: Unmounting");
-    f_mount(NULL, "bis:", 1);
-    nx_emmc_gpt_free(&gpt);
-    debug_log("NCA: Cleanup done");
-
-    return result;
-}
-
 void print_centered(int y, const char *text) {
     int len = strlen(text);
     int x = (1280 - (len * 16)) / 2; // Auto-calculate center
@@ -734,12 +405,46 @@ static void show_fuse_info_page(int scroll_offset) {
     redraw_fuse_info_rows(scroll_offset);
 }
 
+#ifdef FUSECHECK_PROFILE
+static void show_profile_page(void) {
+    static profile_span_t spans[PROFILE_MAX_SPANS];
+    u32 count = profile_get_spans(spans, PROFILE_MAX_SPANS);
+
+    gfx_clear_grey(0x1B);
+    draw_app_bars("Any button: Back");
+
+    SETCOLOR(COLOR_CYAN, COLOR_DEFAULT);
+    print_centered(48, "Boot Profile");
+
+    int row_y = 112;
+    for (u32 i = 0; i < count && row_y <= 640; i++, row_y += 28) {
+        u32 dur = spans[i].end_us - spans[i].start_us;
+
+        SETCOLOR(COLOR_WHITE, COLOR_DEFAULT);
+        gfx_con_setpos(160 + spans[i].depth * 24, row_y);
+        gfx_printf("%s", spans[i].name);
+
+        SETCOLOR(COLOR_CYAN, COLOR_DEFAULT);
+        gfx_con_setpos(760, row_y);
+        gfx_printf("%6d.%03d ms", dur / 1000, dur % 1000);
+    }
+}
+#endif
+
 
 
 void ipl_main() {
+    // Nothing may live in this frame before the stack pivot. profile_init only
+    // sets the profiler statics, the boot and hw_init spans are opened once the
+    // stack has moved and backdated to it.
+    profile_init();
+
     // Initialize hardware
     hw_init();
     pivot_stack(IPL_STACK_TOP);
+    PROFILE_BEGIN_AT(boot_span, "boot", 0);
+    PROFILE_BEGIN_AT(hw_span, "hw_init", 0);
+    PROFILE_END(hw_span);
     heap_init(IPL_HEAP_START);
     set_default_configuration();
 
@@ -752,11 +457,15 @@ void ipl_main() {
     display_backlight_brightness(100, 1000);
 
     // Mount SD Card
+    PROFILE_BEGIN(sd_span, "sd_mount");
     h_cfg.errors |= !sd_mount() ? ERR_SD_BOOT_EN : 0;
+    PROFILE_END(sd_span);
 
     // Train DRAM
+    PROFILE_BEGIN(mtc_span, "minerva_init");
     if (minerva_init())
         h_cfg.errors |= ERR_LIBSYS_MTC;
+    PROFILE_END(mtc_span);
 
     // Overclock BPMP
     bpmp_clk_rate_set(h_cfg.t210b01 ? BPMP_CLK_DEFAULT_BOOST : BPMP_CLK_LOWER_BOOST);
@@ -769,7 +478,9 @@ void ipl_main() {
     // Derive keys silently in RAM (no file saving, suppress errors)
     key_storage_t __attribute__((aligned(4))) keys = {0};
     gfx_con.mute = true;  // Mute gfx output to suppress warnings
+    PROFILE_BEGIN(keys_span, "derive_bis_keys_silently");
     bool keys_derived = derive_bis_keys_silently(&keys);
+    PROFILE_END(keys_span);
     gfx_con.mute = false;
 
     if (!keys_derived) {
@@ -794,19 +505,23 @@ void ipl_main() {
     bool fw_detected = false;
     char serial_number[0x19] = {0};
 
+    // Reuses the eMMC session opened by derive_bis_keys_silently, it stays up until exit
     if (emummc_storage_init_mmc() == 0) {
         // Read serial from PRODINFO (BIS key 0 already loaded in SE by derive_bis_keys_silently)
         if (emummc_storage_set_mmc_partition(EMMC_GPP)) {
             nx_emmc_cal0_t *cal0 = (nx_emmc_cal0_t *)malloc(NX_EMMC_CALIBRATION_SIZE);
             if (cal0) {
+                PROFILE_BEGIN(cal0_span, "cal0_read");
                 if (cal0_read(KS_BIS_00_TWEAK, KS_BIS_00_CRYPT, cal0))
                     strncpy(serial_number, cal0->serial_number, 0x18);
+                PROFILE_END(cal0_span);
                 free(cal0);
             }
         }
         // Detect firmware version from NCA (also uses GPP, loads BIS key 2 for SYSTEM)
+        PROFILE_BEGIN(detect_span, "detect_firmware_from_nca");
         fw_detected = detect_firmware_from_nca(&fw_major, &fw_minor, &fw_patch, &keys);
-        emummc_storage_end();
+        PROFILE_END(detect_span);
     }
 
     // fw_major/fw_minor/fw_patch remain 0 if not detected; fw_detected gates display
@@ -823,7 +538,11 @@ void ipl_main() {
 
     // Show results in horizontal layout (single page)
     main_action_t selected_action = MAIN_ACTION_FUSE_MAP;
+    PROFILE_BEGIN(render_span, "first_render");
     show_fuse_check_horizontal(burnt_fuses, fw_major, fw_minor, fw_patch, required_fuses, fw_detected, serial_number, hw_type, selected_action);
+    PROFILE_END(render_span);
+    PROFILE_END(boot_span);
+    profile_save();
 
     // Wait for button to exit, support info page, scrolling, and screenshot combo
     bool on_info_page = false;
@@ -883,6 +602,18 @@ void ipl_main() {
         // On main page: VOL+ toggles to info page
         if (!on_info_page)
         {
+#ifdef FUSECHECK_PROFILE
+            // Both volume buttons: boot profile overlay until the next press.
+            if (vol_up && vol_dn)
+            {
+                show_profile_page();
+                btn_wait();
+                show_fuse_check_horizontal(burnt_fuses, fw_major, fw_minor, fw_patch, required_fuses, fw_detected, serial_number, hw_type, selected_action);
+                btn_last = btn_read();
+                continue;
+            }
+#endif
+
             if (vol_up || vol_dn)
             {
                 selected_action = (selected_action == MAIN_ACTION_FUSE_MAP) ? MAIN_ACTION_EXIT : MAIN_ACTION_FUSE_MAP;
@@ -946,6 +677,8 @@ void ipl_main() {
         }
     }
 
+    emummc_storage_end();
+
     // Launch bootloader/update.bin instead of reboot
     FILINFO fno;
     if (!f_stat("sd:/bootloader/update.bin", &fno)) {
@@ -138,13 +138,28 @@ static int emummc_raw_get_part_off(int part_idx)
 	return 2;
 }
 
+static int _emummc_select_mmc_partition(u32 partition)
+{
+	// The selected partition is tracked for as long as the session is open.
+	if (emmc_storage.partition == partition)
+		return 1;
+
+	return sdmmc_storage_set_mmc_partition(&emmc_storage, partition);
+}
+
 int emummc_storage_init_mmc()
 {
 	FILINFO fno;
 	emu_cfg.active_part = 0;
 
 	// Always init eMMC even when in emuMMC. eMMC is needed from the emuMMC driver anyway.
-	if (!sdmmc_storage_init_mmc(&emmc_storage, &emmc_sdmmc, SDMMC_BUS_WIDTH_8, SDHCI_TIMING_MMC_HS400))
+	// An open session is reused and only torn down by emummc_storage_end().
+	if (emmc_storage.initialized)
+	{
+		if (!_emummc_select_mmc_partition(EMMC_GPP))
+			return 2;
+	}
+	else if (!sdmmc_storage_init_mmc(&emmc_storage, &emmc_sdmmc, SDMMC_BUS_WIDTH_8, SDHCI_TIMING_MMC_HS400))
 		return 2;
 
 	if (!emu_cfg.enabled || h_cfg.emummc_force_disable)
@@ -235,6 +250,39 @@ int emummc_storage_read(u32 sector, u32 num_sectors, void *buf)
 	return 1;
 }
 
+static sdmmc_storage_t *_emummc_async_storage = NULL;
+static int _emummc_async_res = 0;
+
+// Starts a read that can complete in the background, see sdmmc_storage_read_start.
+// File based emuMMC reads complete here. Every start must be paired with a finish.
+int emummc_storage_read_start(u32 sector, u32 num_sectors, void *buf)
+{
+	if (!emu_cfg.enabled || h_cfg.emummc_force_disable)
+		_emummc_async_storage = &emmc_storage;
+	else if (emu_cfg.sector)
+	{
+		sector += emu_cfg.sector;
+		sector += emummc_raw_get_part_off(emu_cfg.active_part) * 0x2000;
+		_emummc_async_storage = &sd_storage;
+	}
+	else
+	{
+		_emummc_async_storage = NULL;
+		_emummc_async_res = emummc_storage_read(sector, num_sectors, buf);
+		return _emummc_async_res;
+	}
+
+	return sdmmc_storage_read_start(_emummc_async_storage, sector, num_sectors, buf);
+}
+
+int emummc_storage_read_finish()
+{
+	if (!_emummc_async_storage)
+		return _emummc_async_res;
+
+	return sdmmc_storage_read_finish(_emummc_async_storage);
+}
+
 int emummc_storage_write(u32 sector, u32 num_sectors, void *buf)
 {
 	FIL fp;
@@ -279,7 +327,7 @@ int emummc_storage_write(u32 sector, u32 num_sectors, void *buf)
 int emummc_storage_set_mmc_partition(u32 partition)
 {
 	emu_cfg.active_part = partition;
-	sdmmc_storage_set_mmc_partition(&emmc_storage, partition);
+	_emummc_select_mmc_partition(partition);
 
 	if (!emu_cfg.enabled || h_cfg.emummc_force_disable || emu_cfg.sector)
 		return 1;
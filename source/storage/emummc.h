@@ -54,6 +54,8 @@ bool emummc_set_path(char *path);
 int  emummc_storage_init_mmc();
 int  emummc_storage_end();
 int  emummc_storage_read(u32 sector, u32 num_sectors, void *buf);
+int  emummc_storage_read_start(u32 sector, u32 num_sectors, void *buf);
+int  emummc_storage_read_finish();
 int  emummc_storage_write(u32 sector, u32 num_sectors, void *buf);
 int  emummc_storage_set_mmc_partition(u32 partition);
 
@@ -86,6 +86,21 @@ int nx_emmc_part_read(sdmmc_storage_t *storage, emmc_part_t *part, u32 sector_of
 	return emummc_storage_read(part->lba_start + sector_off, num_sectors, buf);
 }
 
+// Every start must be paired with nx_emmc_part_read_finish, which returns the read result.
+int nx_emmc_part_read_start(sdmmc_storage_t *storage, emmc_part_t *part, u32 sector_off, u32 num_sectors, void *buf)
+{
+	// The last LBA is inclusive.
+	if (part->lba_start + sector_off > part->lba_end)
+		return 0;
+
+	return emummc_storage_read_start(part->lba_start + sector_off, num_sectors, buf);
+}
+
+int nx_emmc_part_read_finish(sdmmc_storage_t *storage)
+{
+	return emummc_storage_read_finish();
+}
+
 int nx_emmc_part_write(sdmmc_storage_t *storage, emmc_part_t *part, u32 sector_off, u32 num_sectors, void *buf)
 {
 	// The last LBA is inclusive.
@@ -46,6 +46,8 @@ void nx_emmc_gpt_free(link_t *gpt);
 emmc_part_t *nx_emmc_part_find(link_t *gpt, const char *name);
 int  nx_emmc_part_read(sdmmc_storage_t *storage, emmc_part_t *part, u32 sector_off, u32 num_sectors, void *buf);
 int  nx_emmc_part_write(sdmmc_storage_t *storage, emmc_part_t *part, u32 sector_off, u32 num_sectors, void *buf);
+int  nx_emmc_part_read_start(sdmmc_storage_t *storage, emmc_part_t *part, u32 sector_off, u32 num_sectors, void *buf);
+int  nx_emmc_part_read_finish(sdmmc_storage_t *storage);
 
 void nx_emmc_get_autorcm_masks(u8 *mod0, u8 *mod1);
 
@@ -21,7 +21,6 @@
 
 #include <memory_map.h>
 
-#include <mem/heap.h>
 #include <sec/se.h>
 #include <sec/se_t210.h>
 #include "../storage/nx_emmc.h"
@@ -29,35 +28,71 @@
 #include <storage/sdmmc.h>
 #include <utils/types.h>
 
-#define MAX_CLUSTER_CACHE_ENTRIES 32768
-#define CLUSTER_LOOKUP_EMPTY_ENTRY 0xFFFFFFFF
+#define CLUSTER_LOOKUP_EMPTY_ENTRY 0xFFFFFFFF // empty lookup slot, or cluster_num of an unused entry
+#define CLUSTER_CACHE_CLAIMED      0xFFFFFFFE // cluster_num of entries a batch is being read into
 #define SECTORS_PER_CLUSTER 0x20
 
 typedef struct _cluster_cache_t
 {
-	u32 cluster_num;                // index of the cluster in the partition
-	u32 visit_count;                // used for debugging/access analysis
+	u32 cluster_num;                // index of the cluster in the partition, CLUSTER_LOOKUP_EMPTY_ENTRY or CLUSTER_CACHE_CLAIMED
+	u32 visit_count;                // accesses since cached, aged by the CLOCK policy
 	u8  dirty;                      // has been modified without writeback flag
-	u8  align[7];
-	u8  cluster[XTS_CLUSTER_SIZE];  // the cached cluster itself
+	u8  align[3];
 } cluster_cache_t;
 
 typedef struct _bis_cache_t
 {
 	u8 emmc_buffer[XTS_CLUSTER_SIZE];
-	cluster_cache_t cluster_cache[];
+	u8 read_buffer[XTS_CLUSTER_SIZE * NX_BIS_READAHEAD_MAX]; // batched cluster reads
+	u8 tweak_buffer[XTS_CLUSTER_SIZE * NX_BIS_READAHEAD_MAX]; // XTS tweak stream per batch slot
+	u8 cluster_data[][XTS_CLUSTER_SIZE]; // the cached clusters, adjacent so a batch can be read into them
 } bis_cache_t;
 
-static u8 ks_crypt = 0;
-static u8 ks_tweak = 0;
-static u8 cache_filled = 0;
-static u32 dirty_cluster_count = 0;
-static u32 cluster_cache_end_index = 0;
-static emmc_part_t *system_part = NULL;
+// As many entries as fit in size bytes of carveout. The cluster data is followed by the
+// cluster_cache_t of every entry, then by the lookup tables, at most 4 slots per entry.
+#define CLUSTER_CACHE_ENTRIES(size) (((size) - sizeof(bis_cache_t)) / (XTS_CLUSTER_SIZE + sizeof(cluster_cache_t) + 4 * sizeof(u32)))
+
+// A BIS partition with its own keyslots, lookup table and share of the cluster cache.
+typedef struct _bis_vol_t
+{
+	emmc_part_t part;             // copy, the GPT list is freed once mounted
+	bool initialized;
+	bool lock_cluster_cache;
+	u8 ks_crypt;
+	u8 ks_tweak;
+	u8 cache_filled;
+	u32 dirty_cluster_count;
+	u32 cache_first;              // first cluster_cache entry of this volume
+	u32 cache_entries;            // entries owned by this volume
+	u32 cluster_cache_end_index;  // next free entry, then the CLOCK hand once filled, relative to cache_first
+	u32 *cluster_lookup;          // open addressing cluster -> entry map, at most half full
+	u32 lookup_shift;             // 32 - log2 of its slots
+	u32 last_miss_cluster;
+	nx_emmc_bis_stats_t stats;
+} bis_vol_t;
+
+// Weight of each volume when the cluster cache is split between the initialized ones.
+static const u8 bis_vol_cache_weight[NX_BIS_VOL_COUNT] = {
+	[NX_BIS_VOL_PRODINFO]  = 1,
+	[NX_BIS_VOL_PRODINFOF] = 1,
+	[NX_BIS_VOL_SAFE]      = 4,
+	[NX_BIS_VOL_SYSTEM]    = 42,
+	[NX_BIS_VOL_USER]      = 16,
+};
+
+static bis_vol_t bis_vols[NX_BIS_VOL_COUNT];
+static bis_vol_t *bis = &bis_vols[NX_BIS_VOL_SYSTEM]; // volume being accessed
+static u32 current_vol = NX_BIS_VOL_SYSTEM;           // volume of the last nx_emmc_bis_init
 static bis_cache_t *bis_cache = (bis_cache_t *)NX_BIS_CACHE_ADDR;
-static u32 *cluster_lookup_buf = NULL;
-static u32 *cluster_lookup = NULL;
-static bool lock_cluster_cache = false;
+static cluster_cache_t *cluster_cache = NULL;
+static u32 *cluster_lookup_slots = NULL;
+static u32 cluster_cache_max = 0;
+static u32 cache_policy = NX_BIS_CACHE_CLOCK;
+static u32 readahead_window = NX_BIS_READAHEAD_DEFAULT;
+static u32 pipeline_chunk = NX_BIS_PIPELINE_DEFAULT;
+static bool zero_copy = true;
+static bis_vol_t *tweak_table_vol = NULL;             // volume whose keys built the tweak tables
+static u32 tweak_table_cluster[NX_BIS_READAHEAD_MAX]; // cluster each tweak_buffer slot was built for
 
 static void _gf256_mul_x_le(void *block)
 {
@@ -75,81 +110,156 @@ static void _gf256_mul_x_le(void *block)
 		pdata[0x0] ^= 0x87;
 }
 
-static int _nx_aes_xts_crypt_sec(u32 tweak_ks, u32 crypt_ks, u32 enc, u8 *tweak, bool regen_tweak, u32 tweak_exp, u32 sec, void *dst, const void *src, u32 sec_size)
+// Build (or reuse) the tweak stream of a whole cluster in a tweak_buffer slot.
+static u32 *_nx_emmc_bis_tweak_table(u32 slot, u32 cluster)
 {
-	u32 *pdst = (u32 *)dst;
-	u32 *psrc = (u32 *)src;
-	u32 *ptweak = (u32 *)tweak;
+	u32 *table = (u32 *)(bis_cache->tweak_buffer + slot * XTS_CLUSTER_SIZE);
+	if (tweak_table_vol == bis && tweak_table_cluster[slot] == cluster)
+		return table;
 
-	if (regen_tweak)
+	// Another volume's keys built the tables.
+	if (tweak_table_vol != bis)
 	{
-		for (int i = 0xF; i >= 0; i--)
-		{
-			tweak[i] = sec & 0xFF;
-			sec >>= 8;
-		}
-		if (!se_aes_crypt_block_ecb(tweak_ks, 1, tweak, tweak))
-			return 0;
+		memset(tweak_table_cluster, 0xFF, sizeof(tweak_table_cluster));
+		tweak_table_vol = bis;
 	}
 
-	// tweak_exp allows us to use a saved tweak to reduce _gf256_mul_x_le calls.
-	for (u32 i = 0; i < (tweak_exp << 5); i++)
-		_gf256_mul_x_le(tweak);
-
-	u8 orig_tweak[0x10] __attribute__((aligned(4)));
-	memcpy(orig_tweak, tweak, 0x10);
-
-	// We are assuming a 0x10-aligned sector size in this implementation.
-	for (u32 i = 0; i < (sec_size >> 4); i++)
+	u8 tweak[0x10] __attribute__((aligned(4)));
+	u32 sec = cluster;
+	for (int i = 0xF; i >= 0; i--)
 	{
-		for (u32 j = 0; j < 4; j++)
-			pdst[j] = psrc[j] ^ ptweak[j];
+		tweak[i] = sec & 0xFF;
+		sec >>= 8;
+	}
+	if (!se_aes_crypt_block_ecb(bis->ks_tweak, ENCRYPT, tweak, tweak))
+		return NULL;
 
+	u32 *ptweak = (u32 *)tweak;
+	for (u32 i = 0; i < (XTS_CLUSTER_SIZE >> 4); i++)
+	{
+		table[i * 4 + 0] = ptweak[0];
+		table[i * 4 + 1] = ptweak[1];
+		table[i * 4 + 2] = ptweak[2];
+		table[i * 4 + 3] = ptweak[3];
 		_gf256_mul_x_le(tweak);
-		psrc += 4;
-		pdst += 4;
 	}
+	tweak_table_cluster[slot] = cluster;
+
+	return table;
+}
+
+static void _nx_emmc_bis_tweak_xor(u32 *dst, const u32 *src, const u32 *tweaks, u32 size)
+{
+	for (u32 i = 0; i < (size >> 2); i++)
+		dst[i] = src[i] ^ tweaks[i];
+}
 
-	if (!se_aes_crypt_ecb(crypt_ks, enc, dst, sec_size, dst, sec_size))
+// Crypt size bytes of a cluster, starting at sector sec_in_cluster. Must not cross the cluster end.
+static int _nx_aes_xts_crypt_sec(u32 crypt_ks, u32 enc, u32 cluster, u32 sec_in_cluster, void *dst, const void *src, u32 size)
+{
+	u32 *table = _nx_emmc_bis_tweak_table(0, cluster);
+	if (!table)
 		return 0;
 
-	pdst = (u32 *)dst;
-	ptweak = (u32 *)orig_tweak;
-	for (u32 i = 0; i < (sec_size >> 4); i++)
-	{
-		for (u32 j = 0; j < 4; j++)
-			pdst[j] = pdst[j] ^ ptweak[j];
+	// Jump straight to the tweak of the first sector.
+	const u32 *tweaks = table + sec_in_cluster * NX_EMMC_BLOCKSIZE / sizeof(u32);
 
-		_gf256_mul_x_le(orig_tweak);
-		pdst += 4;
-	}
+	_nx_emmc_bis_tweak_xor(dst, src, tweaks, size);
+	if (!se_aes_crypt_ecb(crypt_ks, enc, dst, size, dst, size))
+		return 0;
+	_nx_emmc_bis_tweak_xor(dst, dst, tweaks, size);
 
 	return 1;
 }
 
+// Decrypt/encrypt count whole clusters of a batch in place, starting at batch slot,
+// with a single AES pass over all of them.
+static int _nx_aes_xts_crypt_clusters(u32 crypt_ks, u32 enc, u32 cluster, u32 slot, u32 count, u8 *batch)
+{
+	for (u32 i = 0; i < count; i++)
+		if (!_nx_emmc_bis_tweak_table(slot + i, cluster + i))
+			return 0;
+
+	u32 size = count * XTS_CLUSTER_SIZE;
+	u32 *buf = (u32 *)(batch + slot * XTS_CLUSTER_SIZE);
+	u32 *tweaks = (u32 *)(bis_cache->tweak_buffer + slot * XTS_CLUSTER_SIZE);
+	_nx_emmc_bis_tweak_xor(buf, buf, tweaks, size);
+	if (!se_aes_crypt_ecb(crypt_ks, enc, buf, size, buf, size))
+		return 0;
+	_nx_emmc_bis_tweak_xor(buf, buf, tweaks, size);
+
+	return 1;
+}
+
+static inline u32 _nx_emmc_bis_lookup_home(u32 cluster)
+{
+	return (cluster * 0x9E3779B1) >> bis->lookup_shift;
+}
+
+// Cache entry of cluster, or CLUSTER_LOOKUP_EMPTY_ENTRY.
+static u32 _nx_emmc_bis_lookup_find(u32 cluster)
+{
+	u32 mask = (u32)-1 >> bis->lookup_shift;
+	for (u32 pos = _nx_emmc_bis_lookup_home(cluster);; pos = (pos + 1) & mask)
+	{
+		u32 index = bis->cluster_lookup[pos];
+		if (index == CLUSTER_LOOKUP_EMPTY_ENTRY || cluster_cache[index].cluster_num == cluster)
+			return index;
+	}
+}
+
+// cluster must not be in the map yet.
+static void _nx_emmc_bis_lookup_insert(u32 cluster, u32 index)
+{
+	u32 mask = (u32)-1 >> bis->lookup_shift;
+	u32 pos = _nx_emmc_bis_lookup_home(cluster);
+	while (bis->cluster_lookup[pos] != CLUSTER_LOOKUP_EMPTY_ENTRY)
+		pos = (pos + 1) & mask;
+	bis->cluster_lookup[pos] = index;
+}
+
+// Remove cluster and shift back the slots that probed past it, so no tombstones are needed.
+static void _nx_emmc_bis_lookup_remove(u32 cluster)
+{
+	u32 mask = (u32)-1 >> bis->lookup_shift;
+	u32 hole = _nx_emmc_bis_lookup_home(cluster);
+	while (cluster_cache[bis->cluster_lookup[hole]].cluster_num != cluster)
+		hole = (hole + 1) & mask;
+
+	for (u32 pos = (hole + 1) & mask; bis->cluster_lookup[pos] != CLUSTER_LOOKUP_EMPTY_ENTRY; pos = (pos + 1) & mask)
+	{
+		u32 home = _nx_emmc_bis_lookup_home(cluster_cache[bis->cluster_lookup[pos]].cluster_num);
+		if (((pos - home) & mask) >= ((pos - hole) & mask))
+		{
+			bis->cluster_lookup[hole] = bis->cluster_lookup[pos];
+			hole = pos;
+		}
+	}
+	bis->cluster_lookup[hole] = CLUSTER_LOOKUP_EMPTY_ENTRY;
+}
+
 static int nx_emmc_bis_write_block(u32 sector, u32 count, void *buff, bool force_flush)
 {
-	if (!system_part)
+	if (!bis->initialized)
 		return 3; // Not ready.
 
-	u8 tweak[0x10] __attribute__((aligned(4)));
 	u32 cluster = sector / SECTORS_PER_CLUSTER;
 	u32 aligned_sector = cluster * SECTORS_PER_CLUSTER;
 	u32 sector_index_in_cluster = sector % SECTORS_PER_CLUSTER;
-	u32 cluster_lookup_index = cluster_lookup[cluster];
+	u32 cluster_lookup_index = _nx_emmc_bis_lookup_find(cluster);
 	bool is_cached = cluster_lookup_index != CLUSTER_LOOKUP_EMPTY_ENTRY;
 
 	// Write to cached cluster.
 	if (is_cached)
 	{
 		if (buff)
-			memcpy(bis_cache->cluster_cache[cluster_lookup_index].cluster + sector_index_in_cluster * NX_EMMC_BLOCKSIZE, buff, count * NX_EMMC_BLOCKSIZE);
+			memcpy(bis_cache->cluster_data[cluster_lookup_index] + sector_index_in_cluster * NX_EMMC_BLOCKSIZE, buff, count * NX_EMMC_BLOCKSIZE);
 		else
-			buff = bis_cache->cluster_cache[cluster_lookup_index].cluster;
-		bis_cache->cluster_cache[cluster_lookup_index].visit_count++;
-		if (bis_cache->cluster_cache[cluster_lookup_index].dirty == 0)
-			dirty_cluster_count++;
-		bis_cache->cluster_cache[cluster_lookup_index].dirty = 1;
+			buff = bis_cache->cluster_data[cluster_lookup_index];
+		cluster_cache[cluster_lookup_index].visit_count++;
+		if (cluster_cache[cluster_lookup_index].dirty == 0)
+			bis->dirty_cluster_count++;
+		cluster_cache[cluster_lookup_index].dirty = 1;
 		if (!force_flush)
 			return 0; // Success.
 
@@ -160,16 +270,16 @@ static int nx_emmc_bis_write_block(u32 sector, u32 count, void *buff, bool force
 	}
 
 	// Encrypt and write.
-	if (!_nx_aes_xts_crypt_sec(ks_tweak, ks_crypt, ENCRYPT, tweak, true, sector_index_in_cluster, cluster, bis_cache->emmc_buffer, buff, count * NX_EMMC_BLOCKSIZE) ||
-		!nx_emmc_part_write(&emmc_storage, system_part, sector, count, bis_cache->emmc_buffer)
+	if (!_nx_aes_xts_crypt_sec(bis->ks_crypt, ENCRYPT, cluster, sector_index_in_cluster, bis_cache->emmc_buffer, buff, count * NX_EMMC_BLOCKSIZE) ||
+		!nx_emmc_part_write(&emmc_storage, &bis->part, sector, count, bis_cache->emmc_buffer)
 	)
 		return 1; // R/W error.
 
 	// Mark cache entry not dirty if write succeeds.
 	if (is_cached)
 	{
-		bis_cache->cluster_cache[cluster_lookup_index].dirty = 0;
-		dirty_cluster_count--;
+		cluster_cache[cluster_lookup_index].dirty = 0;
+		bis->dirty_cluster_count--;
 	}
 
 	return 0; // Success.
@@ -180,103 +290,251 @@ static void _nx_emmc_bis_flush_cluster(cluster_cache_t *cache_entry)
 	nx_emmc_bis_write_block(cache_entry->cluster_num * SECTORS_PER_CLUSTER, SECTORS_PER_CLUSTER, NULL, true);
 }
 
-static int nx_emmc_bis_read_block(u32 sector, u32 count, void *buff)
+// Pick the cache entry for a new cluster, evicting (and flushing) its previous cluster if needed.
+static u32 _nx_emmc_bis_cache_get_entry()
 {
-	if (!system_part)
-		return 3; // Not ready.
+	u32 index;
+
+	if (!bis->cache_filled)
+	{
+		index = bis->cache_first + bis->cluster_cache_end_index++;
+		if (bis->cluster_cache_end_index >= bis->cache_entries)
+		{
+			bis->cluster_cache_end_index = 0;
+			bis->cache_filled = 1;
+		}
 
-	static u32 prev_cluster = -1;
-	static u32 prev_sector = 0;
-	static u8 tweak[0x10] __attribute__((aligned(4)));
-	u8 cache_tweak[0x10] __attribute__((aligned(4)));
+		return index;
+	}
+
+	while (true)
+	{
+		index = bis->cache_first + bis->cluster_cache_end_index;
+		bis->cluster_cache_end_index = (bis->cluster_cache_end_index + 1) % bis->cache_entries;
+
+		if (cluster_cache[index].cluster_num == CLUSTER_CACHE_CLAIMED)
+			continue;
+
+		if (cache_policy == NX_BIS_CACHE_ROUND_ROBIN)
+			break;
+
+		// CLOCK: clusters that were hit since the last sweep get another round, with their count aged.
+		cluster_cache_t *entry = &cluster_cache[index];
+		if (entry->visit_count <= 1)
+			break;
+		entry->visit_count >>= 1;
+	}
+
+	cluster_cache_t *victim = &cluster_cache[index];
+	if (victim->cluster_num == CLUSTER_LOOKUP_EMPTY_ENTRY)
+		return index; // Left empty by a failed read.
+
+	if (victim->dirty)
+		_nx_emmc_bis_flush_cluster(victim);
+	_nx_emmc_bis_lookup_remove(victim->cluster_num);
+	bis->stats.cache_evictions++;
+
+	return index;
+}
+
+static int _nx_emmc_bis_read_chunk_start(u32 cluster, u32 slot, u32 count, u8 *batch)
+{
+	bis->stats.emmc_reads++;
+
+	return nx_emmc_part_read_start(&emmc_storage, &bis->part, (cluster + slot) * SECTORS_PER_CLUSTER, count * SECTORS_PER_CLUSTER,
+		batch + slot * XTS_CLUSTER_SIZE);
+}
+
+// Read run clusters into batch in pipeline_chunk sized reads, decrypting each chunk
+// while the next one is transferred. Every started read is finished, even on errors.
+static int _nx_emmc_bis_read_pipelined(u32 cluster, u32 run, u8 *batch)
+{
+	u32 chunk = pipeline_chunk ? MIN(pipeline_chunk, run) : run;
+
+	int started = _nx_emmc_bis_read_chunk_start(cluster, 0, chunk, batch);
+	for (u32 slot = 0; slot < run; slot += chunk)
+	{
+		u32 count = MIN(chunk, run - slot);
+		u32 next = slot + count;
+
+		if (!nx_emmc_part_read_finish(&emmc_storage) || !started)
+			return 1; // R/W error.
 
-	u32 tweak_exp = 0;
-	bool regen_tweak = true;
+		if (next < run)
+			started = _nx_emmc_bis_read_chunk_start(cluster, next, MIN(chunk, run - next), batch);
+
+		if (!_nx_aes_xts_crypt_clusters(bis->ks_crypt, DECRYPT, cluster + slot, slot, count, batch))
+		{
+			if (next < run)
+				nx_emmc_part_read_finish(&emmc_storage);
+			return 1; // R/W error.
+		}
+	}
+
+	return 0;
+}
+
+// Read and decrypt a run of uncached clusters and add them to the cache, returning the entry of the first one.
+// The entries are claimed first, so when they are adjacent the clusters are read and decrypted in place.
+static int _nx_emmc_bis_cache_read_clusters(u32 cluster, u32 run, u32 *first_index)
+{
+	u32 index[NX_BIS_READAHEAD_MAX];
+	bool in_place = zero_copy;
+
+	for (u32 i = 0; i < run; i++)
+	{
+		index[i] = _nx_emmc_bis_cache_get_entry();
+		cluster_cache_t *entry = &cluster_cache[index[i]];
+		entry->cluster_num = CLUSTER_CACHE_CLAIMED;
+		entry->visit_count = 0;
+		entry->dirty = 0;
+		in_place &= index[i] == index[0] + i;
+	}
+
+	u8 *batch = in_place ? bis_cache->cluster_data[index[0]] : bis_cache->read_buffer;
+	if (_nx_emmc_bis_read_pipelined(cluster, run, batch))
+	{
+		for (u32 i = 0; i < run; i++)
+			cluster_cache[index[i]].cluster_num = CLUSTER_LOOKUP_EMPTY_ENTRY;
+		return 1; // R/W error.
+	}
+	bis->stats.clusters_decrypted += run;
+
+	for (u32 i = 0; i < run; i++)
+	{
+		cluster_cache_t *entry = &cluster_cache[index[i]];
+		entry->cluster_num = cluster + i;
+		entry->visit_count = i ? 0 : 1; // Read-ahead clusters count as visited on first hit.
+		_nx_emmc_bis_lookup_insert(cluster + i, index[i]);
+		if (!in_place)
+		{
+			memcpy(bis_cache->cluster_data[index[i]], bis_cache->read_buffer + i * XTS_CLUSTER_SIZE, XTS_CLUSTER_SIZE);
+			bis->stats.clusters_copied++;
+		}
+	}
+	*first_index = index[0];
+
+	return 0; // Success.
+}
+
+// Read whole, uncached clusters straight into the caller's buffer, bypassing the cache.
+// Only for requests covering at least a read-ahead window, smaller ones gain more from
+// read-ahead and from being cached. Returns how many clusters were read, 0 if the
+// request does not qualify or on error.
+static u32 _nx_emmc_bis_read_direct(u32 sector, u32 count, u8 *buff, int *res)
+{
+	*res = 0;
+	if (!bis->initialized || !zero_copy || sector % SECTORS_PER_CLUSTER || count < readahead_window * SECTORS_PER_CLUSTER || ((uptr)buff & 7))
+		return 0;
+
+	u32 cluster = sector / SECTORS_PER_CLUSTER;
+	u32 part_clusters = (bis->part.lba_end - bis->part.lba_start + 1) / SECTORS_PER_CLUSTER;
+	if (cluster >= part_clusters)
+		return 0;
+
+	u32 run_max = MIN(MIN(count / SECTORS_PER_CLUSTER, NX_BIS_READAHEAD_MAX), part_clusters - cluster);
+	u32 run = 0;
+	while (run < run_max && _nx_emmc_bis_lookup_find(cluster + run) == CLUSTER_LOOKUP_EMPTY_ENTRY)
+		run++;
+	if (run < readahead_window)
+		return 0;
+
+	if (_nx_emmc_bis_read_pipelined(cluster, run, buff))
+	{
+		*res = 1; // R/W error.
+		return 0;
+	}
+	bis->stats.cache_misses += run;
+	bis->stats.clusters_decrypted += run;
+	bis->stats.direct_clusters += run;
+	bis->last_miss_cluster = cluster + run - 1;
+
+	return run;
+}
+
+static int nx_emmc_bis_read_block(u32 sector, u32 count, void *buff, u32 clusters_left)
+{
+	if (!bis->initialized)
+		return 3; // Not ready.
 
 	u32 cluster = sector / SECTORS_PER_CLUSTER;
-	u32 aligned_sector = cluster * SECTORS_PER_CLUSTER;
 	u32 sector_index_in_cluster = sector % SECTORS_PER_CLUSTER;
-	u32 cluster_lookup_index = cluster_lookup[cluster];
+	u32 cluster_lookup_index = _nx_emmc_bis_lookup_find(cluster);
 
 	// Read from cached cluster.
 	if (cluster_lookup_index != CLUSTER_LOOKUP_EMPTY_ENTRY)
 	{
-		memcpy(buff, bis_cache->cluster_cache[cluster_lookup_index].cluster + sector_index_in_cluster * NX_EMMC_BLOCKSIZE, count * NX_EMMC_BLOCKSIZE);
-		bis_cache->cluster_cache[cluster_lookup_index].visit_count++;
-		prev_sector = sector + count - 1;
-		prev_cluster = cluster;
+		memcpy(buff, bis_cache->cluster_data[cluster_lookup_index] + sector_index_in_cluster * NX_EMMC_BLOCKSIZE, count * NX_EMMC_BLOCKSIZE);
+		cluster_cache[cluster_lookup_index].visit_count++;
+		bis->stats.cache_hits++;
 		return 0; // Success.
 	}
 
+	bis->stats.cache_misses++;
+
 	// Cache cluster.
-	if (!lock_cluster_cache)
+	if (!bis->lock_cluster_cache)
 	{
-		// Roll the cache index over and flush if full.
-		if (cluster_cache_end_index >= MAX_CLUSTER_CACHE_ENTRIES)
-		{
-			cluster_cache_end_index = 0;
-			cache_filled = 1;
-		}
-		// Check if cache entry was previously in use in case of cache loop.
-		if (cache_filled == 1 && bis_cache->cluster_cache[cluster_cache_end_index].dirty == 1)
-			_nx_emmc_bis_flush_cluster(&bis_cache->cluster_cache[cluster_cache_end_index]);
-		bis_cache->cluster_cache[cluster_cache_end_index].cluster_num = cluster;
-		bis_cache->cluster_cache[cluster_cache_end_index].visit_count = 1;
-		bis_cache->cluster_cache[cluster_cache_end_index].dirty = 0;
-		cluster_lookup[cluster] = cluster_cache_end_index;
-
-		// Read and decrypt the whole cluster the sector resides in.
-		if (!nx_emmc_part_read(&emmc_storage, system_part, aligned_sector, SECTORS_PER_CLUSTER, bis_cache->emmc_buffer) ||
-			!_nx_aes_xts_crypt_sec(ks_tweak, ks_crypt, DECRYPT, cache_tweak, true, 0, cluster, bis_cache->emmc_buffer, bis_cache->emmc_buffer, XTS_CLUSTER_SIZE)
-		)
+		// Fetch the rest of the request, or the read-ahead window when the misses are sequential,
+		// up to the first cluster that is already cached.
+		u32 part_clusters = (bis->part.lba_end - bis->part.lba_start + 1) / SECTORS_PER_CLUSTER;
+		u32 run_max = cluster == bis->last_miss_cluster + 1 ? MAX(clusters_left, readahead_window) : clusters_left;
+		run_max = MIN(MIN(run_max, readahead_window), part_clusters - cluster);
+
+		u32 run = 1;
+		while (run < run_max && _nx_emmc_bis_lookup_find(cluster + run) == CLUSTER_LOOKUP_EMPTY_ENTRY)
+			run++;
+
+		if (_nx_emmc_bis_cache_read_clusters(cluster, run, &cluster_lookup_index))
 			return 1; // R/W error.
+		bis->last_miss_cluster = cluster + run - 1;
+		bis->stats.readahead_clusters += run - MIN(run, clusters_left);
 
-		// Copy to cluster cache.
-		memcpy(bis_cache->cluster_cache[cluster_cache_end_index].cluster, bis_cache->emmc_buffer, XTS_CLUSTER_SIZE);
-		memcpy(buff, bis_cache->emmc_buffer + sector_index_in_cluster * NX_EMMC_BLOCKSIZE, count * NX_EMMC_BLOCKSIZE);
-		cluster_cache_end_index++;
+		memcpy(buff, bis_cache->cluster_data[cluster_lookup_index] + sector_index_in_cluster * NX_EMMC_BLOCKSIZE, count * NX_EMMC_BLOCKSIZE);
 		return 0; // Success.
 	}
 
 	// If not reading from or writing to cache, do a regular read and decrypt.
-	if (!nx_emmc_part_read(&emmc_storage, system_part, sector, count, bis_cache->emmc_buffer))
+	if (!nx_emmc_part_read(&emmc_storage, &bis->part, sector, count, bis_cache->emmc_buffer))
 		return 1; // R/W error.
 
-	if (prev_cluster != cluster) // Sector in different cluster than last read.
-	{
-		prev_cluster = cluster;
-		tweak_exp = sector_index_in_cluster;
-	}
-	else if (sector > prev_sector) // Sector in same cluster and past last sector.
-	{
-		// Calculates the new tweak using the saved one, reducing expensive _gf256_mul_x_le calls.
-		tweak_exp = sector - prev_sector - 1;
-		regen_tweak = false;
-	}
-	else // Sector in same cluster and before or same as last sector.
-		tweak_exp = sector_index_in_cluster;
-
-	// Maximum one cluster (1 XTS crypto block 16KB).
-	if (!_nx_aes_xts_crypt_sec(ks_tweak, ks_crypt, DECRYPT, tweak, regen_tweak, tweak_exp, prev_cluster, buff, bis_cache->emmc_buffer, count * NX_EMMC_BLOCKSIZE))
+	// Maximum one cluster (1 XTS crypto block 16KB). Reads within the same cluster reuse its tweak table.
+	if (!_nx_aes_xts_crypt_sec(bis->ks_crypt, DECRYPT, cluster, sector_index_in_cluster, buff, bis_cache->emmc_buffer, count * NX_EMMC_BLOCKSIZE))
 		return 1; // R/W error.
-	prev_sector = sector + count - 1;
+	bis->stats.sectors_decrypted += count;
 
 	return 0; // Success.
 }
 
-int nx_emmc_bis_read(u32 sector, u32 count, void *buff)
+int nx_emmc_bis_vol_read(u32 vol, u32 sector, u32 count, void *buff)
 {
+	if (vol >= NX_BIS_VOL_COUNT)
+		return 4; // Invalid parameter.
+	bis = &bis_vols[vol];
+	if (!bis->initialized)
+		return 3; // Not ready.
+
 	int res = 1;
 	u8 *buf = (u8 *)buff;
 	u32 curr_sct = sector;
+	u32 end_cluster = (sector + count - 1) / SECTORS_PER_CLUSTER;
 
 	while (count)
 	{
-		u32 sct_cnt = MIN(count, 0x20);
-		res = nx_emmc_bis_read_block(curr_sct, sct_cnt, buf);
+		// Whole clusters that are not cached skip the cache.
+		u32 sct_cnt = _nx_emmc_bis_read_direct(curr_sct, count, buf, &res) * SECTORS_PER_CLUSTER;
 		if (res)
 			return 1;
 
+		// Split at cluster boundaries, a block read never spans two clusters.
+		if (!sct_cnt)
+		{
+			sct_cnt = MIN(count, SECTORS_PER_CLUSTER - curr_sct % SECTORS_PER_CLUSTER);
+			res = nx_emmc_bis_read_block(curr_sct, sct_cnt, buf, end_cluster - curr_sct / SECTORS_PER_CLUSTER + 1);
+			if (res)
+				return 1;
+		}
+
 		count -= sct_cnt;
 		curr_sct += sct_cnt;
 		buf += NX_EMMC_BLOCKSIZE * sct_cnt;
@@ -285,15 +543,21 @@ int nx_emmc_bis_read(u32 sector, u32 count, void *buff)
 	return res;
 }
 
-int nx_emmc_bis_write(u32 sector, u32 count, void *buff)
+int nx_emmc_bis_vol_write(u32 vol, u32 sector, u32 count, void *buff)
 {
+	if (vol >= NX_BIS_VOL_COUNT)
+		return 4; // Invalid parameter.
+	bis = &bis_vols[vol];
+	if (!bis->initialized)
+		return 3; // Not ready.
+
 	int res = 1;
 	u8 *buf = (u8 *)buff;
 	u32 curr_sct = sector;
 
 	while (count)
 	{
-		u32 sct_cnt = MIN(count, 0x20);
+		u32 sct_cnt = MIN(count, SECTORS_PER_CLUSTER - curr_sct % SECTORS_PER_CLUSTER);
 		res = nx_emmc_bis_write_block(curr_sct, sct_cnt, buf, false);
 		if (res)
 			return 1;
@@ -306,78 +570,240 @@ int nx_emmc_bis_write(u32 sector, u32 count, void *buff)
 	return res;
 }
 
-void nx_emmc_bis_cluster_cache_init()
+int nx_emmc_bis_read(u32 sector, u32 count, void *buff)
 {
-	u32 cluster_lookup_size = (system_part->lba_end - system_part->lba_start + 1) / SECTORS_PER_CLUSTER * sizeof(*cluster_lookup);
+	return nx_emmc_bis_vol_read(current_vol, sector, count, buff);
+}
 
-	if (cluster_lookup_buf)
-		free(cluster_lookup_buf);
+int nx_emmc_bis_write(u32 sector, u32 count, void *buff)
+{
+	return nx_emmc_bis_vol_write(current_vol, sector, count, buff);
+}
 
-	// Check if carveout protected, in case of old hwinit (pre 4.0.0) chainload.
-	*(vu32 *)NX_BIS_LOOKUP_ADDR = 0;
-	if (*(vu32 *)NX_BIS_LOOKUP_ADDR != 0)
+static u32 _nx_emmc_bis_part_vol(emmc_part_t *part)
+{
+	switch (part->index)
 	{
-		cluster_lookup_buf = (u32 *)malloc(cluster_lookup_size + 0x2000);
-		cluster_lookup = (u32 *)ALIGN((u32)cluster_lookup_buf, 0x1000);
+	case 0:  // PRODINFO.
+		return NX_BIS_VOL_PRODINFO;
+	case 1:  // PRODINFOF.
+		return NX_BIS_VOL_PRODINFOF;
+	case 8:  // SAFE.
+		return NX_BIS_VOL_SAFE;
+	case 10: // USER.
+		return NX_BIS_VOL_USER;
+	case 9:  // SYSTEM.
+	default:
+		return NX_BIS_VOL_SYSTEM;
 	}
-	else
+}
+
+static u32 _nx_emmc_bis_lookup_slots(u32 entries)
+{
+	u32 slots = 2;
+	while (slots < entries * 2)
+		slots <<= 1;
+
+	return slots;
+}
+
+// Size the cache to the carveout. Old hwinit (pre 4.0.0) chainloads leave its upper part protected.
+static void _nx_emmc_bis_cache_layout()
+{
+	u32 cache_size = NX_BIS_CACHE_SZ;
+	vu32 *upper[] = { (vu32 *)(NX_BIS_CACHE_ADDR + NX_BIS_CACHE_LOW_SZ), (vu32 *)(NX_BIS_CACHE_ADDR + NX_BIS_CACHE_SZ - sizeof(u32)) };
+	for (u32 i = 0; i < ARRAY_SIZE(upper); i++)
 	{
-		cluster_lookup_buf = NULL;
-		cluster_lookup = (u32 *)NX_BIS_LOOKUP_ADDR;
+		*upper[i] = 0;
+		if (*upper[i] != 0)
+			cache_size = NX_BIS_CACHE_LOW_SZ;
 	}
 
+	cluster_cache_max = CLUSTER_CACHE_ENTRIES(cache_size);
+	cluster_cache = (cluster_cache_t *)bis_cache->cluster_data[cluster_cache_max];
+	cluster_lookup_slots = (u32 *)&cluster_cache[cluster_cache_max];
+}
+
+// Clear the cache of the volume being accessed.
+static void _nx_emmc_bis_cache_clear()
+{
 	// Clear cluster lookup table and reset end index.
-	memset(cluster_lookup, -1, cluster_lookup_size);
-	cluster_cache_end_index = 0;
-	lock_cluster_cache = false;
+	memset(bis->cluster_lookup, -1, (1u << (32 - bis->lookup_shift)) * sizeof(u32));
+	bis->cluster_cache_end_index = 0;
+	bis->lock_cluster_cache = false;
+	bis->last_miss_cluster = -1;
 
-	dirty_cluster_count = 0;
-	cache_filled = 0;
+	bis->dirty_cluster_count = 0;
+	bis->cache_filled = 0;
 }
 
+static void _nx_emmc_bis_flush_dirty()
+{
+	if (bis->dirty_cluster_count == 0)
+		return;
+
+	u32 limit = bis->cache_filled == 1 ? bis->cache_entries : bis->cluster_cache_end_index;
+	u32 clusters_to_flush = bis->dirty_cluster_count;
+	for (u32 i = bis->cache_first; i < bis->cache_first + limit && clusters_to_flush; i++)
+	{
+		if (cluster_cache[i].dirty) {
+			_nx_emmc_bis_flush_cluster(&cluster_cache[i]);
+			clusters_to_flush--;
+		}
+	}
+}
+
+// Split the cluster cache between the initialized volumes and the one being set up, by weight,
+// so partitions that are never opened hold no entries. The volume being set up is cleared, as
+// is any other whose share moved. Its dirty clusters are flushed first, clearing a volume
+// leaves the cluster_cache entries of the others untouched.
+static void _nx_emmc_bis_cache_split()
+{
+	bis_vol_t *vol_setup = bis;
+
+	if (!cluster_cache)
+		_nx_emmc_bis_cache_layout();
+
+	u32 weight_total = 0;
+	for (u32 vol = 0; vol < NX_BIS_VOL_COUNT; vol++)
+	{
+		if (bis_vols[vol].initialized || &bis_vols[vol] == vol_setup)
+			weight_total += bis_vol_cache_weight[vol];
+	}
+
+	u32 weight_end = 0;
+	u32 cache_first = 0;
+	u32 *lookup = cluster_lookup_slots;
+	for (u32 vol = 0; vol < NX_BIS_VOL_COUNT; vol++)
+	{
+		bis = &bis_vols[vol];
+		if (!bis->initialized && bis != vol_setup)
+			continue;
+
+		weight_end += bis_vol_cache_weight[vol];
+		u32 entries = cluster_cache_max * weight_end / weight_total - cache_first;
+		u32 slots = _nx_emmc_bis_lookup_slots(entries);
+
+		if (bis == vol_setup || bis->cache_first != cache_first || bis->cache_entries != entries || bis->cluster_lookup != lookup)
+		{
+			if (bis != vol_setup)
+				_nx_emmc_bis_flush_dirty();
+
+			bis->cache_first = cache_first;
+			bis->cache_entries = entries;
+			bis->cluster_lookup = lookup;
+			bis->lookup_shift = 32;
+			for (u32 i = slots; i > 1; i >>= 1)
+				bis->lookup_shift--;
+			_nx_emmc_bis_cache_clear();
+		}
+
+		cache_first += entries;
+		lookup += slots;
+	}
+
+	bis = vol_setup;
+}
+
+// Drop the cache of the volume selected by nx_emmc_bis_init.
+void nx_emmc_bis_cluster_cache_init()
+{
+	bis = &bis_vols[current_vol];
+	if (bis->initialized)
+		_nx_emmc_bis_cache_clear();
+}
+
+// Select the volume of part for nx_emmc_bis_read/write and the calls below. It is set up unless
+// it is already mounted on the same partition, so its cache stays warm across remounts.
 void nx_emmc_bis_init(emmc_part_t *part)
 {
-	system_part = part;
+	current_vol = _nx_emmc_bis_part_vol(part);
+	bis = &bis_vols[current_vol];
+	memset(&bis->stats, 0, sizeof(bis->stats));
 
-	nx_emmc_bis_cluster_cache_init();
+	if (bis->initialized && bis->part.lba_start == part->lba_start && bis->part.lba_end == part->lba_end)
+		return;
 
-	switch (part->index)
+	if (bis->initialized)
+		_nx_emmc_bis_flush_dirty();
+	memcpy(&bis->part, part, sizeof(emmc_part_t));
+	if (tweak_table_vol == bis)
+		tweak_table_vol = NULL; // Keys change with the partition.
+
+	switch (current_vol)
 	{
-	case 0:  // PRODINFO.
-	case 1:  // PRODINFOF.
-		ks_crypt = 0;
-		ks_tweak = 1;
+	case NX_BIS_VOL_PRODINFO:
+	case NX_BIS_VOL_PRODINFOF:
+		bis->ks_crypt = 0;
+		bis->ks_tweak = 1;
 		break;
-	case 8:  // SAFE.
-		ks_crypt = 2;
-		ks_tweak = 3;
+	case NX_BIS_VOL_SAFE:
+		bis->ks_crypt = 2;
+		bis->ks_tweak = 3;
 		break;
-	case 9:  // SYSTEM.
-	case 10: // USER.
-		ks_crypt = 4;
-		ks_tweak = 5;
+	case NX_BIS_VOL_SYSTEM:
+	case NX_BIS_VOL_USER:
+		bis->ks_crypt = 4;
+		bis->ks_tweak = 5;
 		break;
 	}
+
+	_nx_emmc_bis_cache_split();
+	bis->initialized = true;
 }
 
 void nx_emmc_bis_finalize()
 {
-	if (dirty_cluster_count == 0)
-		return;
+	bis = &bis_vols[current_vol];
+	_nx_emmc_bis_flush_dirty();
+}
 
-	u32 limit = cache_filled == 1 ? MAX_CLUSTER_CACHE_ENTRIES : cluster_cache_end_index;
-	u32 clusters_to_flush = dirty_cluster_count;
-	for (u32 i = 0; i < limit && clusters_to_flush; i++)
+// Flush and drop every volume, needed once the BIS keys or the eMMC change.
+void nx_emmc_bis_end()
+{
+	for (u32 vol = 0; vol < NX_BIS_VOL_COUNT; vol++)
 	{
-		if (bis_cache->cluster_cache[i].dirty) {
-			_nx_emmc_bis_flush_cluster(&bis_cache->cluster_cache[i]);
-			clusters_to_flush--;
-		}
+		bis = &bis_vols[vol];
+		if (!bis->initialized)
+			continue;
+
+		_nx_emmc_bis_flush_dirty();
+		bis->initialized = false;
 	}
+	tweak_table_vol = NULL;
+}
+
+void nx_emmc_bis_set_cache_policy(u32 policy)
+{
+	cache_policy = policy;
+}
+
+// Maximum clusters fetched per eMMC read. 1 disables batching and read-ahead.
+void nx_emmc_bis_set_readahead(u32 clusters)
+{
+	readahead_window = MAX(1, MIN(clusters, NX_BIS_READAHEAD_MAX));
+}
+
+// Clusters per eMMC read within a batch. 0 reads the whole batch with one command.
+void nx_emmc_bis_set_pipeline(u32 clusters)
+{
+	pipeline_chunk = MIN(clusters, NX_BIS_READAHEAD_MAX);
+}
+
+// Read into the cache slots and caller buffers directly instead of through read_buffer.
+void nx_emmc_bis_set_zero_copy(bool enable)
+{
+	zero_copy = enable;
+}
+
+void nx_emmc_bis_get_stats(nx_emmc_bis_stats_t *stats)
+{
+	memcpy(stats, &bis_vols[current_vol].stats, sizeof(nx_emmc_bis_stats_t));
+	stats->cache_entries = bis_vols[current_vol].cache_entries;
 }
 
 // Set cluster cache lock according to arg.
 void nx_emmc_bis_cache_lock(bool lock)
 {
-	lock_cluster_cache = lock;
+	bis_vols[current_vol].lock_cluster_cache = lock;
 }
@@ -238,11 +238,59 @@ typedef struct _nx_emmc_cal0_t
 #define NX_EMMC_CALIBRATION_SIZE   0x8000
 #define XTS_CLUSTER_SIZE           0x4000
 
+// Clusters fetched per eMMC read on sequential misses.
+#define NX_BIS_READAHEAD_MAX     16
+#define NX_BIS_READAHEAD_DEFAULT 8
+
+// Batches are split into reads of this many clusters, each decrypted while the next is in flight.
+#define NX_BIS_PIPELINE_DEFAULT  4
+
+// Cluster cache replacement policies.
+enum
+{
+	NX_BIS_CACHE_CLOCK       = 0, // Evict the first cluster not hit since the last sweep.
+	NX_BIS_CACHE_ROUND_ROBIN = 1, // Evict in fill order.
+};
+
+// BIS volumes, one per partition, each with its own keyslots, lookup table and cluster cache share.
+enum
+{
+	NX_BIS_VOL_PRODINFO  = 0,
+	NX_BIS_VOL_PRODINFOF = 1,
+	NX_BIS_VOL_SAFE      = 2,
+	NX_BIS_VOL_SYSTEM    = 3,
+	NX_BIS_VOL_USER      = 4,
+	NX_BIS_VOL_COUNT
+};
+
+// Cache and decryption work since the last nx_emmc_bis_init.
+typedef struct _nx_emmc_bis_stats_t
+{
+	u32 clusters_decrypted; // Whole clusters decrypted.
+	u32 direct_clusters;    // Of those, decrypted straight into the caller's buffer.
+	u32 clusters_copied;    // Of those, copied into the cache as their entries were not adjacent.
+	u32 sectors_decrypted;  // Sectors decrypted directly while the cache is locked.
+	u32 cache_hits;
+	u32 cache_misses;
+	u32 cache_evictions;
+	u32 emmc_reads;         // eMMC commands issued to fill the cache.
+	u32 readahead_clusters; // Clusters fetched beyond the requested range.
+	u32 cache_entries;      // Cluster cache entries the volume owns, not a counter.
+} nx_emmc_bis_stats_t;
+
+int nx_emmc_bis_vol_read(u32 vol, u32 sector, u32 count, void *buff);
+int nx_emmc_bis_vol_write(u32 vol, u32 sector, u32 count, void *buff);
 int nx_emmc_bis_read(u32 sector, u32 count, void *buff);
 int nx_emmc_bis_write(u32 sector, u32 count, void *buff);
 void nx_emmc_bis_cluster_cache_init();
 void nx_emmc_bis_init(emmc_part_t *part);
 void nx_emmc_bis_finalize();
+void nx_emmc_bis_end();
 void nx_emmc_bis_cache_lock(bool lock);
+void nx_emmc_bis_set_cache_policy(u32 policy);
+void nx_emmc_bis_set_readahead(u32 clusters);
+void nx_emmc_bis_set_pipeline(u32 clusters);
+void nx_emmc_bis_set_zero_copy(bool enable);
+void nx_emmc_bis_get_stats(nx_emmc_bis_stats_t *stats);
 
 #endif
\ No newline at end of file
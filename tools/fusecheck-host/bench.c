@@ -0,0 +1,1746 @@
+/*
+ * FuseCheck host microbenchmarks
+ *
+ * Replays synthetic workloads against the shared payload code.
+ * Usage: fusecheck-bench <benchmark> [options]
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/core_names.h>
+#include <openssl/evp.h>
+#include <openssl/rsa.h>
+
+#include "../../source/fusecheck/fuse_db.h"
+#include "../../source/keys/crypto.h"
+#include "../../source/keys/es_crypto.h"
+#include "../../source/storage/emummc.h"
+#include "../../source/storage/nx_emmc.h"
+#include "../../source/storage/nx_emmc_bis.h"
+#include <libs/fatfs/diskio.h>
+#include <libs/fatfs/ff.h>
+#include <libs/nx_savedata/allocation_table_storage.h>
+#include <libs/nx_savedata/duplex_storage.h>
+#include <libs/nx_savedata/hierarchical_integrity_verification_storage.h>
+#include <libs/nx_savedata/journal_storage.h>
+#include <libs/nx_savedata/remap_storage.h>
+#include <libs/nx_savedata/save_fs_list.h>
+#include <libs/nx_savedata/save.h>
+#include <libs/nx_savedata/storage.h>
+#include <mem/heap.h>
+#include <storage/nx_sd.h>
+#include <sec/se.h>
+#include <utils/types.h>
+#include <utils/util.h>
+
+#include "host.h"
+
+typedef struct _bench_t
+{
+	const char *name;
+	const char *desc;
+	int (*run)(int argc, char **argv);
+} bench_t;
+
+static u64 _rng_state = 0x9E3779B97F4A7C15ull;
+
+static u32 _rand()
+{
+	_rng_state ^= _rng_state << 13;
+	_rng_state ^= _rng_state >> 7;
+	_rng_state ^= _rng_state << 17;
+
+	return (u32)_rng_state;
+}
+
+static void _rand_nca_name(char *name)
+{
+	sprintf(name, "%08x%08x%08x%08x.nca", _rand(), _rand(), _rand(), _rand());
+}
+
+void debug_log(const char *msg) { }
+
+/*
+ * nca-lookup: a Contents/registered listing of 5000 names against a full
+ * MAX_NCA_ENTRIES database, the SystemVersion NCA being the last entry read.
+ */
+#define NCA_LOOKUP_DIR_ENTRIES 5000
+#define NCA_LOOKUP_ROUNDS      20
+
+static int _nca_lookup_linear(char (*names)[64], u32 count)
+{
+	for (u32 n = 0; n < count; n++)
+		for (size_t i = 0; i < nca_db_count; i++)
+			if (strcmp(names[n], nca_db[i].nca_filename) == 0)
+				return i;
+
+	return -1;
+}
+
+static int _nca_lookup_indexed(char (*names)[64], u32 count)
+{
+	for (u32 n = 0; n < count; n++)
+	{
+		int idx = nca_db_find(names[n]);
+		if (idx >= 0)
+			return idx;
+	}
+
+	return -1;
+}
+
+static int _bench_nca_lookup(int argc, char **argv)
+{
+	// Fill the table like a maxed out database file.
+	char line[128];
+	char *db = malloc(MAX_NCA_ENTRIES * sizeof(line));
+	u32 db_size = 0;
+	for (u32 i = 0; i < MAX_NCA_ENTRIES; i++)
+	{
+		char name[64];
+		_rand_nca_name(name);
+		db_size += sprintf(db + db_size, "[NCA] %d.%d.%d %s\n", 1 + i / 16, (i / 4) % 4, i % 4, name);
+	}
+	load_database_from_buffer(db, db_size);
+	free(db);
+
+	char (*names)[64] = malloc(NCA_LOOKUP_DIR_ENTRIES * 64);
+	for (u32 i = 0; i < NCA_LOOKUP_DIR_ENTRIES - 1; i++)
+		_rand_nca_name(names[i]);
+	strcpy(names[NCA_LOOKUP_DIR_ENTRIES - 1], nca_db[MAX_NCA_ENTRIES / 2].nca_filename);
+
+	u32 linear_us = ~0, indexed_us = ~0;
+	int linear_res = -1, indexed_res = -1;
+	for (u32 r = 0; r < NCA_LOOKUP_ROUNDS; r++)
+	{
+		u32 start = get_tmr_us();
+		linear_res = _nca_lookup_linear(names, NCA_LOOKUP_DIR_ENTRIES);
+		linear_us = MIN(linear_us, get_tmr_us() - start);
+
+		start = get_tmr_us();
+		indexed_res = _nca_lookup_indexed(names, NCA_LOOKUP_DIR_ENTRIES);
+		indexed_us = MIN(indexed_us, get_tmr_us() - start);
+	}
+	free(names);
+
+	printf("nca-lookup: %d names against %d entries (best of %d)\n",
+		NCA_LOOKUP_DIR_ENTRIES, (int)nca_db_count, NCA_LOOKUP_ROUNDS);
+	printf("  linear strcmp  %8u us  %6u ns/name\n", linear_us, (u32)((u64)linear_us * 1000 / NCA_LOOKUP_DIR_ENTRIES));
+	printf("  content id     %8u us  %6u ns/name\n", indexed_us, (u32)((u64)indexed_us * 1000 / NCA_LOOKUP_DIR_ENTRIES));
+
+	if (linear_res != indexed_res || linear_res != MAX_NCA_ENTRIES / 2)
+	{
+		printf("  result mismatch: linear %d, indexed %d\n", linear_res, indexed_res);
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * Scratch SYSTEM partition backed by a sparse file. Contents are whatever the
+ * zeroes decrypt to, which is all the BIS cache benchmarks need.
+ */
+static emmc_part_t _scratch_part;
+
+static bool _bis_scratch_open(u32 size_mb)
+{
+	if (!host_sdmmc_attach_scratch(&emmc_storage, (u64)size_mb << 20) || emummc_storage_init_mmc())
+		return false;
+
+	u8 key[SE_KEY_128_SIZE];
+	for (u32 i = 0; i < SE_KEY_128_SIZE; i++)
+		key[i] = _rand();
+	se_aes_key_set(KS_BIS_02_CRYPT, key, SE_KEY_128_SIZE);
+	key[0] ^= 0xFF;
+	se_aes_key_set(KS_BIS_02_TWEAK, key, SE_KEY_128_SIZE);
+
+	memset(&_scratch_part, 0, sizeof(_scratch_part));
+	_scratch_part.index = 9; // SYSTEM.
+	_scratch_part.lba_start = 0;
+	_scratch_part.lba_end = (size_mb << 11) - 1;
+	strcpy(_scratch_part.name, "SYSTEM");
+
+	return true;
+}
+
+static void _bis_scratch_close()
+{
+	nx_emmc_bis_end();
+	host_sdmmc_detach_all();
+}
+
+// Mount the scratch partition with a cold cache.
+static void _bis_scratch_mount()
+{
+	nx_emmc_bis_end();
+	nx_emmc_bis_init(&_scratch_part);
+}
+
+/*
+ * bis-cache: a save file read twice (working set), a one-shot scan larger than
+ * the cache (tickets/NCAs), then the save file again, with FAT lookups of a
+ * small hot set interleaved throughout. The save file takes a quarter of the cache
+ * the volume owns and the scan all of it, so the scan forces evictions
+ * whatever the carveout size.
+ */
+#define BIS_TRACE_HOT_CLUSTERS  64
+#define BIS_TRACE_PART_MB       1024
+
+static u32 *_bis_trace;
+static u32 _bis_trace_len;
+
+static void _bis_trace_add(u32 cluster)
+{
+	// Every data cluster is preceded by a lookup in the FAT/directory hot set.
+	_bis_trace[_bis_trace_len++] = _rand() % BIS_TRACE_HOT_CLUSTERS;
+	_bis_trace[_bis_trace_len++] = cluster;
+}
+
+static void _bis_trace_build(u32 save_clusters, u32 scan_clusters)
+{
+	const u32 save_start = 0x1000;
+	const u32 scan_start = save_start + save_clusters;
+
+	_bis_trace = malloc((save_clusters * 3 + scan_clusters) * 2 * sizeof(u32));
+	_bis_trace_len = 0;
+
+	for (u32 pass = 0; pass < 2; pass++)
+		for (u32 i = 0; i < save_clusters; i++)
+			_bis_trace_add(save_start + i);
+	for (u32 i = 0; i < scan_clusters; i++)
+		_bis_trace_add(scan_start + i);
+	for (u32 i = 0; i < save_clusters; i++)
+		_bis_trace_add(save_start + i);
+}
+
+static int _bench_bis_cache(int argc, char **argv)
+{
+	static const struct { u32 policy; const char *name; } policies[] = {
+		{ NX_BIS_CACHE_ROUND_ROBIN, "round-robin" },
+		{ NX_BIS_CACHE_CLOCK,       "clock" },
+	};
+	static u8 buf[XTS_CLUSTER_SIZE];
+
+	if (!_bis_scratch_open(BIS_TRACE_PART_MB))
+	{
+		printf("bis-cache: failed to create scratch partition\n");
+		return 1;
+	}
+
+	// Size the trace from the entries a lone SYSTEM volume gets.
+	nx_emmc_bis_stats_t stats;
+	_bis_scratch_mount();
+	nx_emmc_bis_get_stats(&stats);
+	u32 save_clusters = stats.cache_entries / 4;
+	u32 scan_clusters = stats.cache_entries;
+	if (0x1000 + save_clusters + scan_clusters > (BIS_TRACE_PART_MB << 6))
+	{
+		printf("bis-cache: %u cache entries do not fit the scratch partition\n", stats.cache_entries);
+		_bis_scratch_close();
+		return 1;
+	}
+	_bis_trace_build(save_clusters, scan_clusters);
+
+	printf("bis-cache: %u cluster reads, %u distinct, %u cache entries\n", _bis_trace_len,
+		BIS_TRACE_HOT_CLUSTERS + save_clusters + scan_clusters, stats.cache_entries);
+
+	// One cluster per miss and every read through the cache, so misses count the
+	// clusters each policy had to fetch again.
+	nx_emmc_bis_set_readahead(1);
+	nx_emmc_bis_set_zero_copy(false);
+	for (u32 p = 0; p < ARRAY_SIZE(policies); p++)
+	{
+		nx_emmc_bis_set_cache_policy(policies[p].policy);
+		_bis_scratch_mount();
+
+		u32 start = get_tmr_us();
+		for (u32 i = 0; i < _bis_trace_len; i++)
+			nx_emmc_bis_read(_bis_trace[i] * (XTS_CLUSTER_SIZE / NX_EMMC_BLOCKSIZE), XTS_CLUSTER_SIZE / NX_EMMC_BLOCKSIZE, buf);
+		u32 elapsed = get_tmr_us() - start;
+
+		nx_emmc_bis_get_stats(&stats);
+		printf("  %-12s hits %7u  misses %7u  evictions %7u  hit rate %5.1f%%  %8u us\n", policies[p].name,
+			stats.cache_hits, stats.cache_misses, stats.cache_evictions,
+			100.0 * stats.cache_hits / (stats.cache_hits + stats.cache_misses), elapsed);
+	}
+	nx_emmc_bis_set_cache_policy(NX_BIS_CACHE_CLOCK);
+	nx_emmc_bis_set_readahead(NX_BIS_READAHEAD_DEFAULT);
+	nx_emmc_bis_set_zero_copy(true);
+
+	free(_bis_trace);
+	_bis_scratch_close();
+
+	return 0;
+}
+
+/*
+ * bis-read: sequential reads through nx_emmc_bis_read with FatFs sized requests
+ * (single sector window reads, one cluster, multi-cluster f_read), for several
+ * read-ahead windows. A window of 1 is the unbatched one cluster per command path.
+ * Batches are read with a single command here, bis-pipeline covers the split reads.
+ */
+#define BIS_READ_MB      32
+#define BIS_READ_PART_MB 64
+
+static int _bench_bis_read(int argc, char **argv)
+{
+	static const u32 req_sectors[] = { 1, XTS_CLUSTER_SIZE / NX_EMMC_BLOCKSIZE, 0x200 };
+	static const u32 windows[] = { 1, 4, 8, NX_BIS_READAHEAD_MAX };
+	const u32 total_sectors = BIS_READ_MB << 11;
+
+	if (!_bis_scratch_open(BIS_READ_PART_MB))
+	{
+		printf("bis-read: failed to create scratch partition\n");
+		return 1;
+	}
+
+	u8 *buf = malloc(0x200 * NX_EMMC_BLOCKSIZE);
+	printf("bis-read: %d MB sequential, eMMC time modelled at %d us/command + %d sectors/ms\n",
+		BIS_READ_MB, HOST_EMMC_CMD_US, HOST_EMMC_SECTORS_MS);
+	nx_emmc_bis_set_pipeline(0);
+	for (u32 r = 0; r < ARRAY_SIZE(req_sectors); r++)
+	{
+		for (u32 w = 0; w < ARRAY_SIZE(windows); w++)
+		{
+			nx_emmc_bis_set_readahead(windows[w]);
+			_bis_scratch_mount();
+			host_io_stats_t io_before = host_io_stats;
+
+			u32 start = get_tmr_us();
+			for (u32 sct = 0; sct < total_sectors; sct += req_sectors[r])
+				nx_emmc_bis_read(sct, req_sectors[r], buf);
+			u32 cpu_us = MAX(get_tmr_us() - start, 1);
+
+			u64 emmc_us = HOST_EMMC_MODEL_US(host_io_stats.read_cmds - io_before.read_cmds,
+				host_io_stats.read_sectors - io_before.read_sectors);
+			nx_emmc_bis_stats_t stats;
+			nx_emmc_bis_get_stats(&stats);
+			printf("  request %6u B  window %2u  %6u eMMC reads  host %7.1f MB/s  modelled %6.1f MB/s\n",
+				req_sectors[r] * NX_EMMC_BLOCKSIZE, windows[w], stats.emmc_reads,
+				(double)BIS_READ_MB * 1000000 / cpu_us, (double)BIS_READ_MB * 1000000 / (cpu_us + emmc_us));
+		}
+	}
+	nx_emmc_bis_set_readahead(NX_BIS_READAHEAD_DEFAULT);
+	nx_emmc_bis_set_pipeline(NX_BIS_PIPELINE_DEFAULT);
+
+	free(buf);
+	_bis_scratch_close();
+
+	return 0;
+}
+
+/*
+ * bis-pipeline: sequential cluster reads with the full read-ahead window, where
+ * eMMC reads and SE decryption actually take their modelled time, the reads on
+ * a worker thread.
+ * Splitting a batch lets decryption of one chunk overlap the next transfer, at
+ * the cost of one command latency per extra chunk.
+ */
+static int _bench_bis_pipeline(int argc, char **argv)
+{
+	static const u32 chunks[] = { 0, 1, 2, 4, 8 };
+	const u32 req_sectors = XTS_CLUSTER_SIZE / NX_EMMC_BLOCKSIZE;
+	const u32 total_sectors = BIS_READ_MB << 11;
+
+	if (!_bis_scratch_open(BIS_READ_PART_MB))
+	{
+		printf("bis-pipeline: failed to create scratch partition\n");
+		return 1;
+	}
+
+	u8 *buf = malloc(XTS_CLUSTER_SIZE);
+	printf("bis-pipeline: %d MB sequential, window %d, eMMC %d us/command + %d sectors/ms, SE %d KB/ms\n",
+		BIS_READ_MB, NX_BIS_READAHEAD_MAX, HOST_EMMC_CMD_US, HOST_EMMC_SECTORS_MS, HOST_SE_AES_BYTES_US);
+	host_set_latency(true);
+	nx_emmc_bis_set_readahead(NX_BIS_READAHEAD_MAX);
+	for (u32 c = 0; c < ARRAY_SIZE(chunks); c++)
+	{
+		nx_emmc_bis_set_pipeline(chunks[c]);
+		_bis_scratch_mount();
+
+		u32 start = get_tmr_us();
+		for (u32 sct = 0; sct < total_sectors; sct += req_sectors)
+			nx_emmc_bis_read(sct, req_sectors, buf);
+		u32 elapsed = MAX(get_tmr_us() - start, 1);
+
+		nx_emmc_bis_stats_t stats;
+		nx_emmc_bis_get_stats(&stats);
+		printf("  chunk %2u  %6u eMMC reads  %7.1f ms  %6.1f MB/s\n",
+			chunks[c], stats.emmc_reads, elapsed / 1000.0, (double)BIS_READ_MB * 1000000 / elapsed);
+	}
+	host_set_latency(false);
+	nx_emmc_bis_set_readahead(NX_BIS_READAHEAD_DEFAULT);
+	nx_emmc_bis_set_pipeline(NX_BIS_PIPELINE_DEFAULT);
+
+	free(buf);
+	_bis_scratch_close();
+
+	return 0;
+}
+
+/*
+ * bis-zero-copy: sequential reads with cluster and read-ahead window sized requests,
+ * copying through read_buffer against reading into the cache slots and, for window
+ * sized requests, into the caller's buffer. Best of several passes, host time only.
+ */
+#define BIS_ZERO_COPY_PASSES 5
+
+static int _bench_bis_zero_copy(int argc, char **argv)
+{
+	static const u32 req_sectors[] = { XTS_CLUSTER_SIZE / NX_EMMC_BLOCKSIZE, NX_BIS_READAHEAD_DEFAULT * XTS_CLUSTER_SIZE / NX_EMMC_BLOCKSIZE };
+	const u32 total_sectors = BIS_READ_MB << 11;
+
+	if (!_bis_scratch_open(BIS_READ_PART_MB))
+	{
+		printf("bis-zero-copy: failed to create scratch partition\n");
+		return 1;
+	}
+
+	u8 *buf = malloc(req_sectors[ARRAY_SIZE(req_sectors) - 1] * NX_EMMC_BLOCKSIZE);
+	printf("bis-zero-copy: %d MB sequential, best of %d passes\n", BIS_READ_MB, BIS_ZERO_COPY_PASSES);
+	for (u32 r = 0; r < ARRAY_SIZE(req_sectors); r++)
+	{
+		for (u32 zc = 0; zc < 2; zc++)
+		{
+			u32 best = -1;
+			nx_emmc_bis_stats_t stats;
+			nx_emmc_bis_set_zero_copy(zc);
+			for (u32 pass = 0; pass < BIS_ZERO_COPY_PASSES; pass++)
+			{
+				_bis_scratch_mount();
+
+				u32 start = get_tmr_us();
+				for (u32 sct = 0; sct < total_sectors; sct += req_sectors[r])
+					nx_emmc_bis_read(sct, req_sectors[r], buf);
+				best = MIN(best, MAX(get_tmr_us() - start, 1));
+				nx_emmc_bis_get_stats(&stats);
+			}
+
+			printf("  request %6u B  %-9s  %5u copied  %5u direct  %7.1f MB/s\n",
+				req_sectors[r] * NX_EMMC_BLOCKSIZE, zc ? "zero-copy" : "copy", stats.clusters_copied,
+				stats.direct_clusters, (double)BIS_READ_MB * 1000000 / best);
+		}
+	}
+	nx_emmc_bis_set_zero_copy(true);
+
+	free(buf);
+	_bis_scratch_close();
+
+	return 0;
+}
+
+/*
+ * bis-volumes: a workflow alternating between SAFE and SYSTEM, remounting each
+ * time, as the key derivation and detection paths do. With a single shared
+ * cache every switch starts cold, with one volume per partition both stay warm.
+ */
+#define BIS_VOLUMES_ROUNDS    4
+#define BIS_VOLUMES_SAFE_MB   4
+#define BIS_VOLUMES_SYSTEM_MB 16
+
+static u32 _bis_volumes_pass(emmc_part_t *part, u32 size_mb, bool keep_warm, u32 *decrypted, u32 *emmc_reads)
+{
+	static u8 buf[XTS_CLUSTER_SIZE];
+	const u32 req_sectors = XTS_CLUSTER_SIZE / NX_EMMC_BLOCKSIZE;
+
+	if (!keep_warm)
+		nx_emmc_bis_end();
+	nx_emmc_bis_init(part);
+
+	u32 start = get_tmr_us();
+	for (u32 sct = 0; sct < (size_mb << 11); sct += req_sectors)
+		nx_emmc_bis_read(sct, req_sectors, buf);
+	u32 elapsed = get_tmr_us() - start;
+
+	nx_emmc_bis_stats_t stats;
+	nx_emmc_bis_get_stats(&stats);
+	*decrypted += stats.clusters_decrypted;
+	*emmc_reads += stats.emmc_reads;
+
+	return elapsed;
+}
+
+static int _bench_bis_volumes(int argc, char **argv)
+{
+	if (!_bis_scratch_open(BIS_READ_PART_MB))
+	{
+		printf("bis-volumes: failed to create scratch partition\n");
+		return 1;
+	}
+
+	u8 key[SE_KEY_128_SIZE];
+	for (u32 i = 0; i < SE_KEY_128_SIZE; i++)
+		key[i] = _rand();
+	se_aes_key_set(KS_BIS_01_CRYPT, key, SE_KEY_128_SIZE);
+	key[0] ^= 0xFF;
+	se_aes_key_set(KS_BIS_01_TWEAK, key, SE_KEY_128_SIZE);
+
+	emmc_part_t safe_part = _scratch_part;
+	safe_part.index = 8; // SAFE.
+	safe_part.lba_end = (BIS_VOLUMES_SAFE_MB << 11) - 1;
+	strcpy(safe_part.name, "SAFE");
+	emmc_part_t system_part = _scratch_part;
+	system_part.lba_start = BIS_VOLUMES_SAFE_MB << 11;
+
+	printf("bis-volumes: %d rounds of %d MB SAFE then %d MB SYSTEM, remounted every time\n",
+		BIS_VOLUMES_ROUNDS, BIS_VOLUMES_SAFE_MB, BIS_VOLUMES_SYSTEM_MB);
+	for (u32 keep_warm = 0; keep_warm < 2; keep_warm++)
+	{
+		u32 decrypted = 0, emmc_reads = 0;
+		u64 elapsed = 0;
+		host_io_stats_t io_before = host_io_stats;
+
+		nx_emmc_bis_end();
+		for (u32 round = 0; round < BIS_VOLUMES_ROUNDS; round++)
+		{
+			elapsed += _bis_volumes_pass(&safe_part, BIS_VOLUMES_SAFE_MB, keep_warm, &decrypted, &emmc_reads);
+			elapsed += _bis_volumes_pass(&system_part, BIS_VOLUMES_SYSTEM_MB, keep_warm, &decrypted, &emmc_reads);
+		}
+
+		u64 emmc_us = HOST_EMMC_MODEL_US(host_io_stats.read_cmds - io_before.read_cmds,
+			host_io_stats.read_sectors - io_before.read_sectors);
+		printf("  %-15s %6u clusters decrypted  %5u eMMC reads  host %6.1f ms  modelled %7.1f ms\n",
+			keep_warm ? "per volume" : "single cache", decrypted, emmc_reads, elapsed / 1000.0, (elapsed + emmc_us) / 1000.0);
+	}
+
+	_bis_scratch_close();
+
+	return 0;
+}
+
+/*
+ * bis-mount: mount cost and cache hit latency for eMMC partition geometries.
+ * Mount is an unmount plus nx_emmc_bis_init, best of several. The hit latency
+ * is single sector reads of random clusters out of a warm set.
+ */
+#define BIS_MOUNT_PASSES       5
+#define BIS_MOUNT_WARM_CLUSTERS 2048
+#define BIS_MOUNT_HITS         200000
+
+static int _bench_bis_mount(int argc, char **argv)
+{
+	static const struct { const char *name; u32 index; u32 size_mb; } geometries[] = {
+		{ "SYSTEM",      9,  2560 },
+		{ "USER 32 GB", 10, 26688 },
+		{ "USER 64 GB", 10, 58368 },
+	};
+	static u8 buf[XTS_CLUSTER_SIZE];
+
+	printf("bis-mount: %d warm clusters, %d single sector hits\n", BIS_MOUNT_WARM_CLUSTERS, BIS_MOUNT_HITS);
+	for (u32 g = 0; g < ARRAY_SIZE(geometries); g++)
+	{
+		if (!_bis_scratch_open(geometries[g].size_mb))
+		{
+			printf("bis-mount: failed to create scratch partition\n");
+			return 1;
+		}
+		_scratch_part.index = geometries[g].index;
+		se_aes_key_set(KS_BIS_02_CRYPT, buf, SE_KEY_128_SIZE);
+		se_aes_key_set(KS_BIS_02_TWEAK, buf, SE_KEY_128_SIZE);
+
+		u32 mount_us = -1;
+		for (u32 pass = 0; pass < BIS_MOUNT_PASSES; pass++)
+		{
+			u32 start = get_tmr_us();
+			_bis_scratch_mount();
+			mount_us = MIN(mount_us, get_tmr_us() - start);
+		}
+
+		u32 part_clusters = (_scratch_part.lba_end + 1) / (XTS_CLUSTER_SIZE / NX_EMMC_BLOCKSIZE);
+		u32 warm[BIS_MOUNT_WARM_CLUSTERS];
+		for (u32 i = 0; i < BIS_MOUNT_WARM_CLUSTERS; i++)
+		{
+			warm[i] = _rand() % part_clusters;
+			nx_emmc_bis_read(warm[i] * (XTS_CLUSTER_SIZE / NX_EMMC_BLOCKSIZE), 1, buf);
+		}
+
+		nx_emmc_bis_stats_t before, after;
+		nx_emmc_bis_get_stats(&before);
+		u32 start = get_tmr_us();
+		for (u32 i = 0; i < BIS_MOUNT_HITS; i++)
+			nx_emmc_bis_read(warm[_rand() % BIS_MOUNT_WARM_CLUSTERS] * (XTS_CLUSTER_SIZE / NX_EMMC_BLOCKSIZE), 1, buf);
+		u32 hit_us = get_tmr_us() - start;
+		nx_emmc_bis_get_stats(&after);
+
+		printf("  %-11s %8u clusters  mount %7u us  hit %5.1f ns  (%u misses)\n", geometries[g].name, part_clusters,
+			mount_us, (double)hit_us * 1000 / BIS_MOUNT_HITS, after.cache_misses - before.cache_misses);
+		_bis_scratch_close();
+	}
+
+	return 0;
+}
+
+/*
+ * sd-cache: the SD accesses of a boot, on a FAT32 image holding a typical
+ * homebrew card layout. emummc.ini, the text database, the update.bin and
+ * payload.bin probes, a screenshot, then the probes again before chainloading.
+ */
+#define SD_CACHE_IMAGE_MB     4096
+#define SD_CACHE_CLUSTER_SECT 64 // 32 KB, the usual cluster size of SD cards.
+#define SD_CACHE_SWITCH_NROS  150
+#define SD_CACHE_CONFIG_DIRS  30
+#define SD_CACHE_SCREENSHOT   (720 * 1280 * 4)
+
+static void _wr32(u8 *p, u32 val) { memcpy(p, &val, 4); }
+static void _wr16(u8 *p, u16 val) { memcpy(p, &val, 2); }
+
+// Writes a blank FAT32 volume straight to sectors, as FatFs is built without f_mkfs.
+static bool _sd_scratch_format(u32 size_mb)
+{
+	static u8 sct[512];
+	const u32 total = size_mb << 11;
+	const u32 rsvd = 32;
+	const u32 clusters = (total - rsvd) / SD_CACHE_CLUSTER_SECT;
+	const u32 fat_sz = (clusters * 4 + 511) / 512;
+
+	if (!host_sdmmc_attach_scratch(&sd_storage, (u64)size_mb << 20) ||
+		!sdmmc_storage_init_sd(&sd_storage, &sd_sdmmc, SDMMC_BUS_WIDTH_4, SDHCI_TIMING_UHS_SDR82))
+		return false;
+
+	memset(sct, 0, sizeof(sct));
+	memcpy(sct, "\xEB\x58\x90MSWIN4.1", 11);
+	_wr16(sct + 11, 512);
+	sct[13] = SD_CACHE_CLUSTER_SECT;
+	_wr16(sct + 14, rsvd);
+	sct[16] = 2;
+	sct[21] = 0xF8;
+	_wr32(sct + 32, total);
+	_wr32(sct + 36, fat_sz);
+	_wr32(sct + 44, 2);  // Root directory cluster.
+	_wr16(sct + 48, 1);  // FSInfo.
+	_wr16(sct + 50, 6);  // Backup boot sector.
+	sct[66] = 0x29;
+	memcpy(sct + 71, "NO NAME    FAT32   ", 19);
+	sct[510] = 0x55;
+	sct[511] = 0xAA;
+	bool ok = sdmmc_storage_write(&sd_storage, 0, 1, sct) && sdmmc_storage_write(&sd_storage, 6, 1, sct);
+
+	memset(sct, 0, sizeof(sct));
+	_wr32(sct + 0, 0x0FFFFFF8);
+	_wr32(sct + 4, 0x0FFFFFFF);
+	_wr32(sct + 8, 0x0FFFFFFF); // Root directory.
+	ok = ok && sdmmc_storage_write(&sd_storage, rsvd, 1, sct) && sdmmc_storage_write(&sd_storage, rsvd + fat_sz, 1, sct);
+
+	sdmmc_storage_end(&sd_storage);
+
+	return ok;
+}
+
+static bool _sd_scratch_populate()
+{
+	static char path[64];
+	static u8 blob[64 * 1024];
+
+	for (u32 i = 0; i < sizeof(blob); i++)
+		blob[i] = _rand();
+
+	bool ok = !f_mkdir("sd:/bootloader") && !f_mkdir("sd:/bootloader/payloads") && !f_mkdir("sd:/config") &&
+		!f_mkdir("sd:/config/fusecheck") && !f_mkdir("sd:/emuMMC") && !f_mkdir("sd:/switch");
+	for (u32 i = 0; ok && i < SD_CACHE_CONFIG_DIRS; i++)
+	{
+		sprintf(path, "sd:/config/homebrew-config-%02u", i);
+		ok = !f_mkdir(path);
+	}
+	for (u32 i = 0; ok && i < SD_CACHE_SWITCH_NROS; i++)
+	{
+		sprintf(path, "sd:/switch/homebrew-application-%03u.nro", i);
+		ok = !sd_save_to_file(blob, 4096 + (_rand() % (sizeof(blob) - 4096)), path);
+	}
+
+	FILE *fp = fopen("../../fusecheck_db.txt", "rb");
+	if (fp)
+	{
+		char *db = malloc(256 * 1024);
+		u32 db_size = fread(db, 1, 256 * 1024, fp);
+		fclose(fp);
+		ok = ok && !sd_save_to_file(db, db_size, DATABASE_PATH);
+		free(db);
+	}
+
+	static const char ini[] = "[emummc]\nenabled=0\nsector=0x0\npath=\nid=0x0000\nnintendo_path=\n";
+	ok = ok && !sd_save_to_file((void *)ini, sizeof(ini) - 1, "sd:/emuMMC/emummc.ini");
+	ok = ok && !sd_save_to_file(blob, sizeof(blob), "sd:/bootloader/update.bin");
+
+	return ok;
+}
+
+static void _sd_boot_sequence(u8 *fb)
+{
+	FILINFO fno;
+	FIL fp;
+	char line[128];
+
+	emummc_load_cfg();
+
+	// load_database: the binary database is missing, the text one is parsed line by line.
+	if (f_open(&fp, DATABASE_BIN_PATH, FA_READ) == FR_OK)
+		f_close(&fp);
+	if (f_open(&fp, DATABASE_PATH, FA_READ) == FR_OK)
+	{
+		while (f_gets(line, sizeof(line), &fp))
+			;
+		f_close(&fp);
+	}
+
+	f_stat("sd:/bootloader/update.bin", &fno);
+	f_stat("sd:/payload.bin", &fno);
+
+	sd_save_to_file(fb, SD_CACHE_SCREENSHOT, "sd:/switch/fusecheck.bmp");
+
+	f_stat("sd:/bootloader/update.bin", &fno);
+	f_stat("sd:/payload.bin", &fno);
+}
+
+static int _bench_sd_cache(int argc, char **argv)
+{
+	if (!_sd_scratch_format(SD_CACHE_IMAGE_MB) || !sd_mount() || !_sd_scratch_populate())
+	{
+		printf("sd-cache: failed to create SD image\n");
+		host_sdmmc_detach_all();
+		return 1;
+	}
+
+	u8 *fb = malloc(SD_CACHE_SCREENSHOT);
+	memset(fb, 0x1B, SD_CACHE_SCREENSHOT);
+
+	printf("sd-cache: %d MB FAT32, %d KB clusters, %d files in switch/, boot SD accesses after a fresh mount\n",
+		SD_CACHE_IMAGE_MB, SD_CACHE_CLUSTER_SECT / 2, SD_CACHE_SWITCH_NROS);
+	for (u32 enable = 0; enable < 2; enable++)
+	{
+		// Same starting state for both passes: no screenshot yet, freshly mounted.
+		f_unlink("sd:/switch/fusecheck.bmp");
+		sd_end();
+		disk_sd_cache_enable(enable);
+		sd_mount();
+
+		host_io_stats_t io_before = host_io_stats;
+		_sd_boot_sequence(fb);
+		u64 reads = host_io_stats.read_cmds - io_before.read_cmds;
+		u64 sectors = host_io_stats.read_sectors - io_before.read_sectors;
+
+		disk_sd_cache_stats_t stats;
+		disk_sd_cache_get_stats(&stats);
+		printf("  %-9s %5llu SD reads %6llu sectors  meta %4u hit %4u miss  data %4u hit %4u miss  bypassed %4u  modelled %6.1f ms\n",
+			enable ? "cached" : "uncached", (unsigned long long)reads, (unsigned long long)sectors,
+			stats.meta_hits, stats.meta_misses, stats.data_hits, stats.data_misses, stats.bypassed,
+			HOST_EMMC_MODEL_US(reads, sectors) / 1000.0);
+	}
+
+	// Read back through the cache after the writes.
+	u32 size = 0;
+	u8 *readback = sd_file_read("sd:/switch/fusecheck.bmp", &size);
+	bool ok = readback && size == SD_CACHE_SCREENSHOT && !memcmp(readback, fb, size);
+
+	free(readback);
+	free(fb);
+	sd_end();
+	host_sdmmc_detach_all();
+
+	if (!ok)
+	{
+		printf("  screenshot read back mismatch\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * save-seek: random substorage reads of a save file whose clusters are spread
+ * over the volume, as left by years of system updates. Every read seeks, the
+ * CLMT turns each seek into a table lookup instead of a FAT chain walk.
+ */
+#define SAVE_SEEK_FILE_MB   16
+#define SAVE_SEEK_BLOCKS    4096 // 16 KB save blocks.
+#define SAVE_SEEK_SMALL     4096 // Header, table and entry sized reads.
+
+static int _bench_save_seek(int argc, char **argv)
+{
+	static u8 buf[0x4000];
+	static char path[64];
+	const u32 clusters = (SAVE_SEEK_FILE_MB << 20) / (SD_CACHE_CLUSTER_SECT * 512);
+	FIL fp;
+	bool ok = _sd_scratch_format(SD_CACHE_IMAGE_MB) && sd_mount();
+
+	// Interleave the save with filler files, then drop the filler so each cluster is its own fragment.
+	for (u32 i = 0; ok && i < clusters; i++)
+	{
+		sprintf(path, "sd:/filler%05u", i);
+		ok = !sd_save_to_file(buf, sizeof(buf), path);
+		if (ok && !f_open(&fp, "sd:/save", FA_OPEN_APPEND | FA_WRITE))
+		{
+			// Each block starts with its index, to check the reads below.
+			for (u32 j = 0; j < SD_CACHE_CLUSTER_SECT * 512 / sizeof(buf); j++)
+			{
+				*(u32 *)buf = f_size(&fp) / sizeof(buf);
+				f_write(&fp, buf, sizeof(buf), NULL);
+			}
+			f_close(&fp);
+		}
+	}
+	for (u32 i = 0; ok && i < clusters; i++)
+	{
+		sprintf(path, "sd:/filler%05u", i);
+		f_unlink(path);
+	}
+
+	if (!ok || f_open(&fp, "sd:/save", FA_READ))
+	{
+		printf("save-seek: failed to create fragmented save\n");
+		host_sdmmc_detach_all();
+		return 1;
+	}
+
+	// Offsets are sector aligned, bit 0 marks a block read.
+	u32 *trace = malloc((SAVE_SEEK_BLOCKS + SAVE_SEEK_SMALL) * sizeof(u32));
+	for (u32 i = 0; i < SAVE_SEEK_BLOCKS + SAVE_SEEK_SMALL; i++)
+	{
+		if (i % 2 && i / 2 < SAVE_SEEK_SMALL)
+			trace[i] = (_rand() % ((SAVE_SEEK_FILE_MB << 20) - 0x200)) & ~0x1FF;
+		else
+			trace[i] = (_rand() % (SAVE_SEEK_FILE_MB << 6)) * 0x4000 | 1;
+	}
+
+	printf("save-seek: %d MB save in %u fragments, %d block and %d small reads\n",
+		SAVE_SEEK_FILE_MB, clusters, SAVE_SEEK_BLOCKS, SAVE_SEEK_SMALL);
+	for (u32 fast = 0; fast < 2; fast++)
+	{
+		save_ctx_t save_ctx = {0};
+		u32 start = get_tmr_us();
+		save_init(&save_ctx, &fp, buf, fast ? ACTION_FAST_SEEK : 0);
+		u32 map_us = get_tmr_us() - start;
+
+		disk_sd_cache_stats_t before, after;
+		disk_sd_cache_get_stats(&before);
+		host_io_stats_t io_before = host_io_stats;
+
+		start = get_tmr_us();
+		for (u32 i = 0; i < SAVE_SEEK_BLOCKS + SAVE_SEEK_SMALL; i++)
+		{
+			if (!save_file_read_wrapper(&fp, buf, trace[i] & ~1, trace[i] & 1 ? 0x4000 : 0x200) ||
+				(trace[i] & 1 && *(u32 *)buf != trace[i] / sizeof(buf)))
+				ok = false;
+		}
+		u32 elapsed = get_tmr_us() - start;
+
+		disk_sd_cache_get_stats(&after);
+		u32 fat_loads = after.meta_hits + after.meta_misses - before.meta_hits - before.meta_misses;
+		printf("  %-9s map %5u us  reads %7u us  %7u FAT sector loads  %5llu SD reads\n",
+			fast ? "CLMT" : "FAT walk", map_us, elapsed, fat_loads,
+			(unsigned long long)(host_io_stats.read_cmds - io_before.read_cmds));
+
+		save_free_contexts(&save_ctx);
+	}
+
+	free(trace);
+	f_close(&fp);
+	sd_end();
+	host_sdmmc_detach_all();
+
+	if (!ok)
+	{
+		printf("  read failed\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * save-extents: save data reads through the journal and data remap layers
+ * down to the save file, as block sized requests (the per-block split every
+ * layer used to do) and as ticket.bin sized requests that are mapped to
+ * coalesced extents. The remap entries are physically contiguous and one in
+ * eight journal blocks is redirected to the journal area.
+ */
+#define SAVE_EXTENTS_FILE_MB     16
+#define SAVE_EXTENTS_BLOCK_SIZE  0x4000
+#define SAVE_EXTENTS_REMAP_SIZE  SZ_256K
+#define SAVE_EXTENTS_DATA_BLOCKS 768
+#define SAVE_EXTENTS_READ_SIZE   SZ_256K
+
+static int _bench_save_extents(int argc, char **argv)
+{
+	const u32 file_size = SAVE_EXTENTS_FILE_MB << 20;
+	const u32 data_size = SAVE_EXTENTS_DATA_BLOCKS * SAVE_EXTENTS_BLOCK_SIZE;
+	const u32 remap_count = file_size / SAVE_EXTENTS_REMAP_SIZE;
+	u8 *buf = malloc(SAVE_EXTENTS_READ_SIZE);
+	u8 *ref = malloc(SAVE_EXTENTS_READ_SIZE);
+	FIL fp;
+
+	// Each physical block starts with its index.
+	bool ok = _sd_scratch_format(SD_CACHE_IMAGE_MB) && sd_mount() && !f_open(&fp, "sd:/save", FA_CREATE_ALWAYS | FA_WRITE);
+	for (u32 i = 0; ok && i < file_size / SAVE_EXTENTS_BLOCK_SIZE; i++)
+	{
+		memset(buf, i, SAVE_EXTENTS_BLOCK_SIZE);
+		*(u32 *)buf = i;
+		ok = !f_write(&fp, buf, SAVE_EXTENTS_BLOCK_SIZE, NULL);
+	}
+	if (ok)
+		f_close(&fp);
+	if (!ok || f_open(&fp, "sd:/save", FA_READ))
+	{
+		printf("save-extents: failed to create save\n");
+		host_sdmmc_detach_all();
+		return 1;
+	}
+
+	// Data remap storage over the whole file, a single segment.
+	remap_header_t remap_header = { .map_entry_count = remap_count, .map_segment_count = 1, .segment_bits = 1 };
+	remap_storage_ctx_t remap = { .header = &remap_header };
+	remap.map_entries = calloc(remap_count, sizeof(remap_entry_ctx_t));
+	for (u32 i = 0; i < remap_count; i++)
+	{
+		remap_entry_ctx_t *entry = &remap.map_entries[i];
+		entry->entry.virtual_offset = (u64)i * SAVE_EXTENTS_REMAP_SIZE;
+		entry->entry.physical_offset = (u64)i * SAVE_EXTENTS_REMAP_SIZE;
+		entry->entry.size = SAVE_EXTENTS_REMAP_SIZE;
+		entry->ends.virtual_offset_end = entry->entry.virtual_offset + SAVE_EXTENTS_REMAP_SIZE;
+		entry->ends.physical_offset_end = entry->entry.physical_offset + SAVE_EXTENTS_REMAP_SIZE;
+	}
+	substorage_init(&remap.base_storage, &file_storage_vt, &fp, 0, file_size);
+	remap.segments = save_remap_storage_init_segments(&remap);
+
+	// Journal storage on top, blocks past the main data are the journal area.
+	journal_header_t journal_header = {
+		.total_size = file_size, .journal_size = file_size - data_size, .block_size = SAVE_EXTENTS_BLOCK_SIZE,
+		.map_header.main_data_block_count = SAVE_EXTENTS_DATA_BLOCKS
+	};
+	u32 *physical = malloc(SAVE_EXTENTS_DATA_BLOCKS * JOURNAL_MAP_ENTRY_SIZE);
+	for (u32 i = 0; i < SAVE_EXTENTS_DATA_BLOCKS; i++)
+	{
+		u32 block = i % 8 == 7 ? SAVE_EXTENTS_DATA_BLOCKS + i / 8 : i;
+		physical[i * 2] = save_journal_map_entry_make_physical_index(block);
+		physical[i * 2 + 1] = 0;
+	}
+	journal_map_params_t map_info = { .map_storage = (u8 *)physical };
+	substorage remap_sub, journal_sub;
+	journal_storage_ctx_t journal;
+	substorage_init(&remap_sub, &remap_storage_vt, &remap, 0, file_size);
+	save_journal_storage_init(&journal, &remap_sub, &journal_header, &map_info);
+	substorage_init(&journal_sub, &journal_storage_vt, &journal, 0, data_size);
+
+	printf("save-extents: %d MB save, %d KB journal blocks, %d KB remap entries, %d KB reads\n",
+		SAVE_EXTENTS_FILE_MB, SAVE_EXTENTS_BLOCK_SIZE >> 10, SAVE_EXTENTS_REMAP_SIZE >> 10, SAVE_EXTENTS_READ_SIZE >> 10);
+	for (u32 mapped = 0; ok && mapped < 2; mapped++)
+	{
+		memset(&save_storage_stats, 0, sizeof(save_storage_stats));
+		host_io_stats_t io_before = host_io_stats;
+		u32 start = get_tmr_us();
+		for (u32 pos = 0; ok && pos < data_size; pos += SAVE_EXTENTS_READ_SIZE)
+		{
+			if (mapped)
+				ok = substorage_read(&journal_sub, buf, pos, SAVE_EXTENTS_READ_SIZE) == SAVE_EXTENTS_READ_SIZE;
+			for (u32 i = 0; ok && !mapped && i < SAVE_EXTENTS_READ_SIZE; i += SAVE_EXTENTS_BLOCK_SIZE)
+				ok = substorage_read(&journal_sub, buf + i, pos + i, SAVE_EXTENTS_BLOCK_SIZE) == SAVE_EXTENTS_BLOCK_SIZE;
+
+			for (u32 i = 0; ok && i < SAVE_EXTENTS_READ_SIZE; i += SAVE_EXTENTS_BLOCK_SIZE)
+			{
+				u32 block = save_journal_map_entry_get_physical_index(physical[(pos + i) / SAVE_EXTENTS_BLOCK_SIZE * 2]);
+				memset(ref, block, SAVE_EXTENTS_BLOCK_SIZE);
+				*(u32 *)ref = block;
+				ok = !memcmp(buf + i, ref, SAVE_EXTENTS_BLOCK_SIZE);
+			}
+		}
+		u32 elapsed = get_tmr_us() - start;
+
+		printf("  %-6s journal %5u  remap %5u  file %5u  %5llu SD reads %8u us\n",
+			mapped ? "mapped" : "block", save_storage_stats.journal_reads, save_storage_stats.remap_reads,
+			save_storage_stats.file_reads, (unsigned long long)(host_io_stats.read_cmds - io_before.read_cmds), elapsed);
+	}
+
+	free(journal.map.runs);
+	free(journal.map.entries);
+	free(physical);
+	free(remap.segments[0].entries);
+	free(remap.segments);
+	free(remap.map_entries);
+	free(ref);
+	free(buf);
+	f_close(&fp);
+	sd_end();
+	host_sdmmc_detach_all();
+
+	if (!ok)
+	{
+		printf("  read mismatch\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * remap-lookup: a meta remap table with many small entries in one segment,
+ * as left by a save that was extended many times. Times segment construction,
+ * then hash sized reads at random and sequential offsets.
+ */
+#define REMAP_LOOKUP_ENTRIES 8192
+#define REMAP_LOOKUP_SIZE    0x200
+#define REMAP_LOOKUP_READS   200000
+
+static int _bench_remap_lookup(int argc, char **argv)
+{
+	const u32 data_size = REMAP_LOOKUP_ENTRIES * REMAP_LOOKUP_SIZE;
+	u8 *data = malloc(data_size);
+	for (u32 i = 0; i < data_size; i++)
+		data[i] = _rand();
+
+	// Entries are virtually contiguous, physically reversed.
+	remap_header_t remap_header = { .map_entry_count = REMAP_LOOKUP_ENTRIES, .map_segment_count = 1, .segment_bits = 1 };
+	remap_storage_ctx_t remap = { .header = &remap_header };
+	remap.map_entries = calloc(REMAP_LOOKUP_ENTRIES, sizeof(remap_entry_ctx_t));
+	for (u32 i = 0; i < REMAP_LOOKUP_ENTRIES; i++)
+	{
+		remap_entry_ctx_t *entry = &remap.map_entries[i];
+		entry->entry.virtual_offset = (u64)i * REMAP_LOOKUP_SIZE;
+		entry->entry.physical_offset = (u64)(REMAP_LOOKUP_ENTRIES - 1 - i) * REMAP_LOOKUP_SIZE;
+		entry->entry.size = REMAP_LOOKUP_SIZE;
+		entry->ends.virtual_offset_end = entry->entry.virtual_offset + REMAP_LOOKUP_SIZE;
+		entry->ends.physical_offset_end = entry->entry.physical_offset + REMAP_LOOKUP_SIZE;
+	}
+	substorage_init(&remap.base_storage, &memory_storage_vt, data, 0, data_size);
+
+	u32 start = get_tmr_us();
+	remap.segments = save_remap_storage_init_segments(&remap);
+	u32 init_us = get_tmr_us() - start;
+
+	printf("remap-lookup: %d entries of %d bytes in one segment, %d reads of 0x20 bytes\n",
+		REMAP_LOOKUP_ENTRIES, REMAP_LOOKUP_SIZE, REMAP_LOOKUP_READS);
+	printf("  init segments %8u us\n", init_us);
+
+	bool ok = remap.segments != NULL;
+	u8 buf[0x20];
+	for (u32 sequential = 0; ok && sequential < 2; sequential++)
+	{
+		start = get_tmr_us();
+		for (u32 i = 0; ok && i < REMAP_LOOKUP_READS; i++)
+		{
+			u32 pos = sequential ? (i * sizeof(buf)) % data_size : (_rand() % data_size) & ~(sizeof(buf) - 1);
+			u32 physical = (REMAP_LOOKUP_ENTRIES - 1 - pos / REMAP_LOOKUP_SIZE) * REMAP_LOOKUP_SIZE + pos % REMAP_LOOKUP_SIZE;
+			ok = save_remap_storage_read(&remap, buf, pos, sizeof(buf)) == sizeof(buf) && !memcmp(buf, data + physical, sizeof(buf));
+		}
+		u32 elapsed = get_tmr_us() - start;
+		printf("  %-10s reads %8u us  %6.1f ns per read\n", sequential ? "sequential" : "random", elapsed, elapsed * 1000.0 / REMAP_LOOKUP_READS);
+	}
+
+	if (remap.segments)
+		free(remap.segments[0].entries);
+	free(remap.segments);
+	free(remap.map_entries);
+	free(data);
+
+	if (!ok)
+	{
+		printf("  read mismatch\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * save-fat: a save file whose blocks are all separate segments of the save
+ * allocation table, as in a ticket.bin grown one ticket at a time, read
+ * sequentially in SAVE_BLOCK_SIZE_DEFAULT chunks like _get_titlekeys_from_save.
+ */
+#define SAVE_FAT_BLOCKS     4096
+#define SAVE_FAT_BLOCK_SIZE 0x1000
+
+static int _bench_save_fat(int argc, char **argv)
+{
+	const u32 phys_blocks = SAVE_FAT_BLOCKS * 2;
+	u8 *data = malloc(phys_blocks * SAVE_FAT_BLOCK_SIZE);
+	u8 *buf = malloc(SAVE_BLOCK_SIZE_DEFAULT);
+	allocation_table_entry_t *table = calloc(allocation_table_block_to_entry_index(phys_blocks), sizeof(allocation_table_entry_t));
+
+	// File block i lives in physical block 2 * i, each block is a single block segment.
+	for (u32 i = 0; i < SAVE_FAT_BLOCKS; i++)
+	{
+		allocation_table_entry_t *entry = &table[allocation_table_block_to_entry_index(i * 2)];
+		entry->prev = i ? allocation_table_block_to_entry_index((i - 1) * 2) : 0x80000000;
+		entry->next = i < SAVE_FAT_BLOCKS - 1 ? allocation_table_block_to_entry_index((i + 1) * 2) : 0;
+		memset(data + i * 2 * SAVE_FAT_BLOCK_SIZE, i, SAVE_FAT_BLOCK_SIZE);
+	}
+
+	allocation_table_header_t header = { .block_size = SAVE_FAT_BLOCK_SIZE, .fat_storage_info.count = phys_blocks };
+	allocation_table_ctx_t fat;
+	allocation_table_storage_ctx_t storage;
+	substorage data_sub;
+	save_allocation_table_init(&fat, table, &header);
+	substorage_init(&data_sub, &memory_storage_vt, data, 0, phys_blocks * SAVE_FAT_BLOCK_SIZE);
+	bool ok = save_allocation_table_storage_init(&storage, &data_sub, &fat, SAVE_FAT_BLOCK_SIZE, 0);
+
+	memset(&save_storage_stats, 0, sizeof(save_storage_stats));
+	u32 start = get_tmr_us();
+	for (u32 pos = 0; ok && pos < SAVE_FAT_BLOCKS * SAVE_FAT_BLOCK_SIZE; pos += SAVE_BLOCK_SIZE_DEFAULT)
+	{
+		ok = save_allocation_table_storage_read(&storage, buf, pos, SAVE_BLOCK_SIZE_DEFAULT) == SAVE_BLOCK_SIZE_DEFAULT;
+		for (u32 i = 0; ok && i < SAVE_BLOCK_SIZE_DEFAULT; i += SAVE_FAT_BLOCK_SIZE)
+			ok = buf[i] == (u8)((pos + i) / SAVE_FAT_BLOCK_SIZE) && buf[i + SAVE_FAT_BLOCK_SIZE - 1] == buf[i];
+	}
+	u32 elapsed = get_tmr_us() - start;
+
+	printf("save-fat: %d single block segments of %d KB, sequential %d KB reads\n",
+		SAVE_FAT_BLOCKS, SAVE_FAT_BLOCK_SIZE >> 10, SAVE_BLOCK_SIZE_DEFAULT >> 10);
+	printf("  reads %5u  data reads %6u  %8u us\n", save_storage_stats.allocation_table_reads, save_storage_stats.memory_reads, elapsed);
+
+	free(table);
+	free(buf);
+	free(data);
+
+	if (!ok)
+	{
+		printf("  read mismatch\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * duplex-read: the duplex data layer of a save, with the bitmap choosing
+ * layer A or B in runs of 1 to 64 blocks, read in 256 KB chunks.
+ */
+#define DUPLEX_BENCH_DATA_MB    16
+#define DUPLEX_BENCH_BLOCK_BITS 9
+#define DUPLEX_BENCH_READ_SIZE  SZ_256K
+#define DUPLEX_BENCH_PASSES     8
+
+static int _bench_duplex_read(int argc, char **argv)
+{
+	const u32 data_size = DUPLEX_BENCH_DATA_MB << 20;
+	const u32 blocks = data_size >> DUPLEX_BENCH_BLOCK_BITS;
+	u8 *data_a = malloc(data_size);
+	u8 *data_b = malloc(data_size);
+	u32 *bitmap = calloc(blocks / 32, sizeof(u32));
+	u8 *layer = malloc(blocks);
+	u8 *buf = malloc(DUPLEX_BENCH_READ_SIZE);
+	memset(data_a, 0x0A, data_size);
+	memset(data_b, 0x0B, data_size);
+
+	// Bitmap words are stored MSB first.
+	u32 runs = 0;
+	for (u32 i = 0; i < blocks; runs++)
+	{
+		u32 run = 1 + _rand() % 64;
+		for (u32 j = 0; j < run && i < blocks; j++, i++)
+		{
+			layer[i] = runs & 1;
+			if (layer[i])
+				bitmap[i / 32] |= 0x80000000 >> (i % 32);
+		}
+	}
+
+	duplex_storage_ctx_t duplex = { ._length = data_size };
+	u32 start = get_tmr_us();
+	save_duplex_storage_init(&duplex, data_a, data_b, DUPLEX_BENCH_BLOCK_BITS, bitmap, blocks);
+	u32 init_us = get_tmr_us() - start;
+
+	bool ok = true;
+	memset(&save_storage_stats, 0, sizeof(save_storage_stats));
+	start = get_tmr_us();
+	for (u32 pass = 0; pass < DUPLEX_BENCH_PASSES; pass++)
+	{
+		for (u32 pos = 0; ok && pos < data_size; pos += DUPLEX_BENCH_READ_SIZE)
+		{
+			ok = save_duplex_storage_read(&duplex, buf, pos, DUPLEX_BENCH_READ_SIZE) == DUPLEX_BENCH_READ_SIZE;
+			for (u32 i = 0; ok && i < DUPLEX_BENCH_READ_SIZE; i += 1 << DUPLEX_BENCH_BLOCK_BITS)
+				ok = buf[i] == (layer[(pos + i) >> DUPLEX_BENCH_BLOCK_BITS] ? 0x0B : 0x0A);
+		}
+	}
+	u32 elapsed = get_tmr_us() - start;
+
+	printf("duplex-read: %d MB, %d byte blocks in %u runs, %d KB reads, %d passes\n",
+		DUPLEX_BENCH_DATA_MB, 1 << DUPLEX_BENCH_BLOCK_BITS, runs, DUPLEX_BENCH_READ_SIZE >> 10, DUPLEX_BENCH_PASSES);
+	printf("  init %6u us  reads %6u  layer reads %7u  %8u us\n",
+		init_us, save_storage_stats.duplex_reads, save_storage_stats.memory_reads, elapsed);
+
+	free(duplex.bitmap.bitmap);
+	free(buf);
+	free(layer);
+	free(bitmap);
+	free(data_b);
+	free(data_a);
+
+	if (!ok)
+	{
+		printf("  read mismatch\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * save-journal: journal storage reads against a map of contiguous runs with
+ * scattered journaled blocks, as after a few commits. Every read is checked
+ * against a per block translation of the same map.
+ */
+#define SAVE_JOURNAL_BLOCK_SIZE 0x4000
+#define SAVE_JOURNAL_BLOCKS     2048
+#define SAVE_JOURNAL_AREA       512
+#define SAVE_JOURNAL_READS      20000
+
+static int _bench_save_journal(int argc, char **argv)
+{
+	const u32 phys_blocks = SAVE_JOURNAL_BLOCKS + SAVE_JOURNAL_AREA;
+	const u32 data_size = SAVE_JOURNAL_BLOCKS * SAVE_JOURNAL_BLOCK_SIZE;
+	u8 *phys = malloc((u64)phys_blocks * SAVE_JOURNAL_BLOCK_SIZE);
+	u8 *buf = malloc(SZ_256K);
+	u8 *ref = malloc(SZ_256K);
+	u32 *map_table = malloc(SAVE_JOURNAL_BLOCKS * JOURNAL_MAP_ENTRY_SIZE);
+
+	for (u64 i = 0; i < (u64)phys_blocks * SAVE_JOURNAL_BLOCK_SIZE; i++)
+		phys[i] = _rand();
+
+	// Identity map with one in sixteen blocks moved to the journal area.
+	u32 journaled = 0;
+	for (u32 i = 0; i < SAVE_JOURNAL_BLOCKS; i++)
+	{
+		u32 block = i;
+		if (!(_rand() % 16) && journaled < SAVE_JOURNAL_AREA)
+			block = SAVE_JOURNAL_BLOCKS + journaled++;
+		map_table[i * 2] = save_journal_map_entry_make_physical_index(block);
+		map_table[i * 2 + 1] = 0;
+	}
+
+	journal_header_t journal_header = {
+		.total_size = (u64)phys_blocks * SAVE_JOURNAL_BLOCK_SIZE, .journal_size = SAVE_JOURNAL_AREA * SAVE_JOURNAL_BLOCK_SIZE,
+		.block_size = SAVE_JOURNAL_BLOCK_SIZE, .map_header.main_data_block_count = SAVE_JOURNAL_BLOCKS
+	};
+	journal_map_params_t map_info = { .map_storage = (u8 *)map_table };
+	substorage phys_sub, journal_sub;
+	journal_storage_ctx_t journal;
+	substorage_init(&phys_sub, &memory_storage_vt, phys, 0, journal_header.total_size);
+	save_journal_storage_init(&journal, &phys_sub, &journal_header, &map_info);
+	substorage_init(&journal_sub, &journal_storage_vt, &journal, 0, data_size);
+
+	bool ok = true;
+	u32 translated = 0;
+	memset(&save_storage_stats, 0, sizeof(save_storage_stats));
+	u32 start = get_tmr_us();
+	for (u32 i = 0; ok && i < SAVE_JOURNAL_READS; i++)
+	{
+		// Mix of sequential block reads and random unaligned ones up to 256 KB.
+		u32 size = i % 2 ? 1 + _rand() % SZ_256K : SAVE_JOURNAL_BLOCK_SIZE;
+		u32 pos = i % 2 ? _rand() % (data_size - size) : (i / 2 * SAVE_JOURNAL_BLOCK_SIZE) % data_size;
+		ok = substorage_read(&journal_sub, buf, pos, size) == size;
+
+		for (u32 done = 0; ok && done < size; translated++)
+		{
+			u32 block = (pos + done) / SAVE_JOURNAL_BLOCK_SIZE;
+			u32 block_pos = (pos + done) % SAVE_JOURNAL_BLOCK_SIZE;
+			u32 chunk = MIN(SAVE_JOURNAL_BLOCK_SIZE - block_pos, size - done);
+			u64 physical = (u64)save_journal_map_entry_get_physical_index(map_table[block * 2]) * SAVE_JOURNAL_BLOCK_SIZE + block_pos;
+			memcpy(ref + done, phys + physical, chunk);
+			done += chunk;
+		}
+		ok = ok && !memcmp(buf, ref, size);
+	}
+	u32 elapsed = get_tmr_us() - start;
+
+	printf("save-journal: %d blocks of %d KB, %u journaled in %u runs, %d reads\n",
+		SAVE_JOURNAL_BLOCKS, SAVE_JOURNAL_BLOCK_SIZE >> 10, journaled, journal.map.run_count, SAVE_JOURNAL_READS);
+	printf("  base reads %6u  per block translation %6u  %8u us\n", save_storage_stats.memory_reads, translated, elapsed);
+
+	free(journal.map.runs);
+	free(journal.map.entries);
+	free(map_table);
+	free(ref);
+	free(buf);
+	free(phys);
+
+	if (!ok)
+	{
+		printf("  mismatch against per block translation\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * save-fs-list: file table lookups in a save with many entries, such as a
+ * system save holding thousands of files. The list walk over the on-disk
+ * chain (still used when the caller needs the previous entry) is compared
+ * with the in-memory key index.
+ */
+#define FS_LIST_BENCH_ENTRIES 2000
+#define FS_LIST_BENCH_DIRS    8
+#define FS_LIST_BENCH_LOOKUPS 2000
+
+static int _bench_save_fs_list(int argc, char **argv)
+{
+	const u32 list_size = FS_LIST_BENCH_ENTRIES * SAVE_FS_LIST_ENTRY_SIZE;
+	const u32 blocks = DIV_ROUND_UP(list_size, SAVE_BLOCK_SIZE_DEFAULT);
+	u8 *data = calloc(blocks, SAVE_BLOCK_SIZE_DEFAULT);
+	allocation_table_entry_t *table = calloc(allocation_table_block_to_entry_index(blocks) + 1, sizeof(allocation_table_entry_t));
+
+	// The list lives in one multi block segment.
+	table[1].prev = 0x80000000;
+	table[1].next = 0x80000000;
+	table[2].prev = 0x80000001;
+	table[2].next = blocks;
+
+	// Entry 0 is the list header and free list head, entry 1 the used list head.
+	save_fs_list_entry_t *entries = (save_fs_list_entry_t *)data;
+	save_fs_list_entry_meta_t *meta = (save_fs_list_entry_meta_t *)data;
+	meta->list_size = FS_LIST_BENCH_ENTRIES;
+	meta->list_capacity = blocks * SAVE_BLOCK_SIZE_DEFAULT / SAVE_FS_LIST_ENTRY_SIZE;
+	entries[1].next = 2;
+	for (u32 i = 2; i < FS_LIST_BENCH_ENTRIES; i++)
+	{
+		entries[i].parent = 1 + i % FS_LIST_BENCH_DIRS;
+		sprintf(entries[i].name, "%016llx.tik", (unsigned long long)i * 0x9E3779B97F4A7C15ull);
+		entries[i].value.save_file_info.start_block = i;
+		entries[i].next = i + 1 < FS_LIST_BENCH_ENTRIES ? i + 1 : 0;
+	}
+
+	allocation_table_header_t header = { .block_size = SAVE_BLOCK_SIZE_DEFAULT, .fat_storage_info.count = blocks };
+	allocation_table_ctx_t fat;
+	substorage data_sub;
+	save_filesystem_list_ctx_t list;
+	save_allocation_table_init(&fat, table, &header);
+	substorage_init(&data_sub, &memory_storage_vt, data, 0, blocks * SAVE_BLOCK_SIZE_DEFAULT);
+	bool ok = save_allocation_table_storage_init(&list.storage, &data_sub, &fat, SAVE_BLOCK_SIZE_DEFAULT, 0);
+	save_fs_list_init(&list);
+
+	u32 *keys = malloc(FS_LIST_BENCH_LOOKUPS * sizeof(u32));
+	for (u32 i = 0; i < FS_LIST_BENCH_LOOKUPS; i++)
+		keys[i] = 2 + _rand() % (FS_LIST_BENCH_ENTRIES - 1); // Last one is a miss.
+
+	printf("save-fs-list: %d entries in %d directories, %d lookups\n",
+		FS_LIST_BENCH_ENTRIES, FS_LIST_BENCH_DIRS, FS_LIST_BENCH_LOOKUPS);
+	for (u32 indexed = 0; ok && indexed < 2; indexed++)
+	{
+		memset(&save_storage_stats, 0, sizeof(save_storage_stats));
+		u32 start = get_tmr_us();
+		for (u32 i = 0; ok && i < FS_LIST_BENCH_LOOKUPS; i++)
+		{
+			save_entry_key_t key = { .parent = 1 + keys[i] % FS_LIST_BENCH_DIRS };
+			sprintf(key.name, "%016llx.tik", (unsigned long long)keys[i] * 0x9E3779B97F4A7C15ull);
+
+			u32 prev;
+			u32 index = save_fs_list_get_index_from_key(&list, &key, indexed ? NULL : &prev);
+			ok = index == (keys[i] < FS_LIST_BENCH_ENTRIES ? keys[i] : 0xFFFFFFFF);
+		}
+		u32 elapsed = get_tmr_us() - start;
+		printf("  %-7s list reads %7u  %8u us\n", indexed ? "index" : "walk", save_storage_stats.allocation_table_reads, elapsed);
+	}
+
+	save_fs_list_finalize(&list);
+	free(keys);
+	free(table);
+	free(data);
+
+	if (!ok)
+	{
+		printf("  lookup mismatch\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * ivfc-read: a save file data level behind the 5 level journal IVFC layout
+ * (master hash, 3 hash levels, data), all in memory. The data is written once
+ * through the IVFC to produce the hashes, then read back and fully verified
+ * with ticket.bin sized requests, counting heap allocations per read. A fresh
+ * storage then validates the whole data level up front, and a corrupted data
+ * block must fail the reads that touch it and only those.
+ */
+#define IVFC_BENCH_LEVELS     5
+#define IVFC_BENCH_BLOCK_SIZE 0x4000
+#define IVFC_BENCH_DATA_MB    8
+#define IVFC_BENCH_READ_SIZE  SZ_256K
+
+static u8 *_ivfc_level_bufs[IVFC_BENCH_LEVELS];
+static integrity_verification_info_ctx_t _ivfc_info[IVFC_BENCH_LEVELS];
+
+static void _ivfc_bench_layout()
+{
+	ivfc_storage_control_input_param_t param;
+	ivfc_size_set_t sizes;
+	u64 level_sizes[IVFC_BENCH_LEVELS];
+
+	for (u32 i = 0; i < IVFC_MAX_LEVEL; i++)
+		param.level_block_size[i] = IVFC_BENCH_BLOCK_SIZE;
+	save_hierarchical_integrity_verification_storage_control_area_query_size(&sizes, &param, IVFC_BENCH_LEVELS, (u64)IVFC_BENCH_DATA_MB << 20);
+
+	level_sizes[0] = sizes.master_hash_size;
+	for (u32 i = 1; i < IVFC_BENCH_LEVELS - 1; i++)
+		level_sizes[i] = sizes.layered_hash_sizes[i - 1];
+	level_sizes[IVFC_BENCH_LEVELS - 1] = (u64)IVFC_BENCH_DATA_MB << 20;
+
+	for (u32 i = 0; i < IVFC_BENCH_LEVELS; i++)
+	{
+		_ivfc_level_bufs[i] = calloc(1, level_sizes[i]);
+		substorage_init(&_ivfc_info[i].data, &memory_storage_vt, _ivfc_level_bufs[i], 0, level_sizes[i]);
+		_ivfc_info[i].block_size = i ? IVFC_BENCH_BLOCK_SIZE : 0;
+		for (u32 j = 0; j < sizeof(_ivfc_info[i].salt); j++)
+			_ivfc_info[i].salt[j] = _rand();
+	}
+}
+
+static void _ivfc_bench_close(hierarchical_integrity_verification_storage_ctx_t *ivfc)
+{
+	for (u32 i = 0; i < IVFC_BENCH_LEVELS - 1; i++)
+	{
+		save_ivfc_storage_finalize(&ivfc->integrity_storages[i]);
+		save_cached_storage_finalize(&ivfc->levels[i + 1]);
+	}
+	free(ivfc->level_validities);
+	free(ivfc);
+}
+
+static int _bench_ivfc_read(int argc, char **argv)
+{
+	const u64 data_size = (u64)IVFC_BENCH_DATA_MB << 20;
+	u8 *buf = malloc(IVFC_BENCH_READ_SIZE);
+	u8 *data = malloc(data_size);
+	for (u64 i = 0; i < data_size; i++)
+		data[i] = _rand();
+
+	_ivfc_bench_layout();
+
+	// Populate, then flush from the data level up so every hash level is written.
+	hierarchical_integrity_verification_storage_ctx_t *ivfc = calloc(1, sizeof(*ivfc));
+	save_hierarchical_integrity_verification_storage_init(ivfc, _ivfc_info, IVFC_BENCH_LEVELS, 0);
+	substorage_write(&ivfc->base_storage, data, 0, data_size);
+	for (u32 i = IVFC_BENCH_LEVELS - 1; i > 0; i--)
+		save_cached_storage_flush(&ivfc->levels[i]);
+	_ivfc_bench_close(ivfc);
+
+	ivfc = calloc(1, sizeof(*ivfc));
+	save_hierarchical_integrity_verification_storage_init(ivfc, _ivfc_info, IVFC_BENCH_LEVELS, 1);
+
+	u32 reads = 0;
+	bool ok = true;
+	memset(&save_storage_stats, 0, sizeof(save_storage_stats));
+	u32 allocs = heap_alloc_count();
+	u32 start = get_tmr_us();
+	for (u64 pos = 0; pos < data_size && ok; pos += IVFC_BENCH_READ_SIZE)
+	{
+		ok = substorage_read(&ivfc->base_storage, buf, pos, IVFC_BENCH_READ_SIZE) == IVFC_BENCH_READ_SIZE &&
+			!memcmp(buf, data + pos, IVFC_BENCH_READ_SIZE);
+		reads++;
+	}
+	u32 elapsed = get_tmr_us() - start;
+	allocs = heap_alloc_count() - allocs;
+
+	u32 data_blocks = ivfc->integrity_storages[IVFC_BENCH_LEVELS - 2].base_storage.sector_count;
+	u32 verified = 0;
+	for (u32 i = 0; i < data_blocks; i++)
+		if (ivfc->level_validities[IVFC_BENCH_LEVELS - 2][i] == VALIDITY_VALID)
+			verified++;
+
+	printf("ivfc-read: %d MB through %d IVFC levels, %d KB blocks, %d KB reads\n",
+		IVFC_BENCH_DATA_MB, IVFC_BENCH_LEVELS, IVFC_BENCH_BLOCK_SIZE >> 10, IVFC_BENCH_READ_SIZE >> 10);
+	printf("  reads %5u  heap allocations %6u (%.1f per read)  verified blocks %u/%u  %8u us\n",
+		reads, allocs, (double)allocs / reads, verified, data_blocks, elapsed);
+	printf("    ivfc layer reads %6u  level reads %6u\n", save_storage_stats.ivfc_reads, save_storage_stats.memory_reads);
+	_ivfc_bench_close(ivfc);
+
+	ivfc = calloc(1, sizeof(*ivfc));
+	save_hierarchical_integrity_verification_storage_init(ivfc, _ivfc_info, IVFC_BENCH_LEVELS, 1);
+	memset(&save_storage_stats, 0, sizeof(save_storage_stats));
+	start = get_tmr_us();
+	validity_t validity = save_hierarchical_integrity_verification_storage_validate(ivfc);
+	elapsed = get_tmr_us() - start;
+	printf("  validate %s  ivfc layer reads %6u  level reads %6u  %8u us\n", validity == VALIDITY_VALID ? "valid" : "invalid",
+		save_storage_stats.ivfc_reads, save_storage_stats.memory_reads, elapsed);
+	ok &= validity == VALIDITY_VALID;
+	_ivfc_bench_close(ivfc);
+
+	// Corrupt one block, then read around it with a lazily checking storage.
+	const u32 bad_block = data_blocks / 2 + 1;
+	_ivfc_level_bufs[IVFC_BENCH_LEVELS - 1][(u64)bad_block * IVFC_BENCH_BLOCK_SIZE + 5] ^= 1;
+	ivfc = calloc(1, sizeof(*ivfc));
+	save_hierarchical_integrity_verification_storage_init(ivfc, _ivfc_info, IVFC_BENCH_LEVELS, 1);
+	u32 failed = 0;
+	for (u64 pos = 0; pos < data_size; pos += IVFC_BENCH_READ_SIZE)
+	{
+		bool hit = pos / IVFC_BENCH_BLOCK_SIZE <= bad_block && bad_block < (pos + IVFC_BENCH_READ_SIZE) / IVFC_BENCH_BLOCK_SIZE;
+		bool read_ok = substorage_read(&ivfc->base_storage, buf, pos, IVFC_BENCH_READ_SIZE) == IVFC_BENCH_READ_SIZE;
+		failed += !read_ok;
+		ok &= read_ok == !hit;
+	}
+	printf("  corrupt block %u  failed reads %u\n", bad_block, failed);
+	ok &= ivfc->level_validities[IVFC_BENCH_LEVELS - 2][bad_block] == VALIDITY_INVALID &&
+		ivfc->level_validities[IVFC_BENCH_LEVELS - 2][bad_block - 1] == VALIDITY_VALID;
+	_ivfc_bench_close(ivfc);
+	for (u32 i = 0; i < IVFC_BENCH_LEVELS; i++)
+		free(_ivfc_level_bufs[i]);
+	free(data);
+	free(buf);
+
+	if (!ok || verified != data_blocks)
+	{
+		printf("  verification failed\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * titlekey-cache: personalized titlekeys decoded the way keys.c reads the e2
+ * save, with the cache on the SD. Titlekeys are OAEP wrapped to a generated
+ * eTicket key so each decoded one can be checked. The runs: no cache, the
+ * same ticket list, new tickets appended, one cached titlekey altered on the
+ * SD, and another console's device key.
+ */
+#define TITLEKEY_CACHE_TICKETS 500
+#define TITLEKEY_CACHE_ADDED   20
+
+static titlekey_buffer_t _titlekey_buffer;
+
+static bool _titlekey_cache_keypair(eticket_rsa_keypair_t *keypair, EVP_PKEY **pkey)
+{
+	BIGNUM *n = NULL, *d = NULL;
+
+	*pkey = EVP_RSA_gen(SE_RSA2048_DIGEST_SIZE * 8);
+	bool ok = *pkey && EVP_PKEY_get_bn_param(*pkey, OSSL_PKEY_PARAM_RSA_N, &n) && EVP_PKEY_get_bn_param(*pkey, OSSL_PKEY_PARAM_RSA_D, &d) &&
+		BN_bn2binpad(n, keypair->modulus, sizeof(keypair->modulus)) > 0 &&
+		BN_bn2binpad(d, keypair->private_exponent, sizeof(keypair->private_exponent)) > 0;
+
+	BN_free(n);
+	BN_free(d);
+
+	return ok;
+}
+
+// Tickets and their ticket_list.bin records, each titlekey encrypted with RSA-OAEP SHA-256 as ES does.
+static bool _titlekey_cache_tickets(EVP_PKEY *pkey, ticket_t *tickets, ticket_record_t *records, u8 (*titlekeys)[0x10], u32 count)
+{
+	EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new(pkey, NULL);
+	bool ok = ctx && EVP_PKEY_encrypt_init(ctx) > 0 && EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_OAEP_PADDING) > 0 &&
+		EVP_PKEY_CTX_set_rsa_oaep_md(ctx, EVP_sha256()) > 0 && EVP_PKEY_CTX_set_rsa_mgf1_md(ctx, EVP_sha256()) > 0;
+
+	for (u32 i = 0; ok && i < count; i++)
+	{
+		ticket_t *ticket = &tickets[i];
+		memset(ticket, 0, sizeof(*ticket));
+		ticket->signature_type = TICKET_SIG_TYPE_RSA2048_SHA256;
+		ticket->ticket_id = (u64)_rand() << 32 | _rand();
+		for (u32 j = 0; j < 0x10; j++)
+		{
+			ticket->rights_id[j] = _rand();
+			titlekeys[i][j] = _rand();
+		}
+		ticket->rights_id[0] %= 0xFF; // 0xFF ends ticket_list.bin.
+
+		size_t size = sizeof(ticket->titlekey_block);
+		ok = EVP_PKEY_encrypt(ctx, ticket->titlekey_block, &size, titlekeys[i], 0x10) > 0 && size == sizeof(ticket->titlekey_block);
+
+		memset(&records[i], 0, sizeof(records[i]));
+		memcpy(records[i].rights_id, ticket->rights_id, sizeof(records[i].rights_id));
+		records[i].ticket_id = ticket->ticket_id;
+	}
+
+	EVP_PKEY_CTX_free(ctx);
+
+	return ok;
+}
+
+// The personalized pass of _get_titlekeys_from_save(), ticket_list.bin and ticket.bin being arrays.
+static u32 _titlekey_cache_pass(key_storage_t *keys, titlekey_cache_t *cache, const ticket_t *tickets, const ticket_record_t *records, u32 count)
+{
+	const u32 buf_size = SAVE_BLOCK_SIZE_DEFAULT;
+	const u32 list_size = ALIGN(count * sizeof(ticket_record_t) + 1, buf_size);
+	u8 *buf = _titlekey_buffer.read_buffer;
+	u32 titlekey_count = 0;
+
+	for (u32 offset = 0; offset < list_size; offset += buf_size)
+	{
+		memset(buf, 0xFF, buf_size);
+		if (offset < count * sizeof(ticket_record_t))
+			memcpy(buf, (const u8 *)records + offset, MIN(buf_size, count * sizeof(ticket_record_t) - offset));
+		es_titlekey_cache_hash_list(cache, buf, buf_size);
+	}
+	es_titlekey_cache_load(cache, count);
+
+	if (cache->list_match)
+	{
+		for (u32 i = 0; i < cache->entry_count; i++)
+		{
+			memcpy(_titlekey_buffer.rights_ids[titlekey_count], cache->entries[i].rights_id, 0x10);
+			memcpy(_titlekey_buffer.titlekeys[titlekey_count], cache->entries[i].titlekey, 0x10);
+			titlekey_count++;
+		}
+		cache->rsa_skipped = cache->entry_count;
+
+		return titlekey_count;
+	}
+
+	se_rsa_key_set(0, keys->eticket_rsa_keypair.modulus, SE_RSA2048_DIGEST_SIZE, keys->eticket_rsa_keypair.private_exponent, SE_RSA2048_DIGEST_SIZE);
+
+	u32 pct = 0, last_pct = 0, remaining = count;
+	for (u32 offset = 0; remaining; offset += buf_size)
+	{
+		memset(buf, 0, buf_size);
+		memcpy(buf, (const u8 *)tickets + offset, MIN(buf_size, count * sizeof(ticket_t) - offset));
+		es_decode_tickets(buf_size, &_titlekey_buffer, remaining, count, &titlekey_count, 0, 0, &pct, &last_pct, true, cache);
+		remaining -= MIN(buf_size / sizeof(ticket_t), remaining);
+	}
+
+	if (!es_titlekey_cache_save(cache))
+		printf("  failed to save the titlekey cache\n");
+
+	return titlekey_count;
+}
+
+static int _bench_titlekey_cache(int argc, char **argv)
+{
+	static key_storage_t keys, foreign_keys;
+	const u32 total = TITLEKEY_CACHE_TICKETS + TITLEKEY_CACHE_ADDED;
+	ticket_t *tickets = malloc(total * sizeof(ticket_t));
+	ticket_record_t *records = malloc(total * sizeof(ticket_record_t));
+	u8 (*titlekeys)[0x10] = malloc(total * 0x10);
+	EVP_PKEY *pkey = NULL;
+
+	for (u32 i = 0; i < sizeof(keys.device_key); i++)
+		keys.device_key[i] = _rand();
+	bool ok = _titlekey_cache_keypair(&keys.eticket_rsa_keypair, &pkey) && _titlekey_cache_tickets(pkey, tickets, records, titlekeys, total) &&
+		_sd_scratch_format(SD_CACHE_IMAGE_MB) && sd_mount();
+	foreign_keys = keys;
+	foreign_keys.device_key[0] ^= 1;
+
+	if (!ok)
+	{
+		printf("titlekey-cache: failed to create tickets or SD image\n");
+		EVP_PKEY_free(pkey);
+		free(titlekeys);
+		free(records);
+		free(tickets);
+		host_sdmmc_detach_all();
+		return 1;
+	}
+
+	// Expected RSA decrypts and cache hits of each run.
+	static const struct
+	{
+		const char *name;
+		bool tamper;
+		bool foreign;
+		u32 count;
+		u32 rsa;
+		u32 skipped;
+	} runs[] = {
+		{ "cold",     false, false, TITLEKEY_CACHE_TICKETS, TITLEKEY_CACHE_TICKETS, 0 },
+		{ "same",     false, false, TITLEKEY_CACHE_TICKETS, 0, TITLEKEY_CACHE_TICKETS },
+		{ "added",    false, false, TITLEKEY_CACHE_TICKETS + TITLEKEY_CACHE_ADDED, TITLEKEY_CACHE_ADDED, TITLEKEY_CACHE_TICKETS },
+		{ "tampered", true,  false, TITLEKEY_CACHE_TICKETS + TITLEKEY_CACHE_ADDED, TITLEKEY_CACHE_TICKETS + TITLEKEY_CACHE_ADDED, 0 },
+		{ "foreign",  false, true,  TITLEKEY_CACHE_TICKETS + TITLEKEY_CACHE_ADDED, TITLEKEY_CACHE_TICKETS + TITLEKEY_CACHE_ADDED, 0 },
+	};
+
+	printf("titlekey-cache: %d personalized tickets, then %d added\n", TITLEKEY_CACHE_TICKETS, TITLEKEY_CACHE_ADDED);
+	for (u32 r = 0; r < ARRAY_SIZE(runs); r++)
+	{
+		if (runs[r].tamper)
+		{
+			// Flip a bit of the last entry's titlekey, only the CMAC tells.
+			u32 size = 0;
+			u8 *file = sd_file_read(TITLEKEY_CACHE_PATH, &size);
+			ok &= file && size > sizeof(titlekey_cache_entry_t);
+			if (file)
+			{
+				file[size - sizeof(titlekey_cache_entry_t) + offsetof(titlekey_cache_entry_t, titlekey)] ^= 1;
+				ok &= !sd_save_to_file(file, size, TITLEKEY_CACHE_PATH);
+				free(file);
+			}
+		}
+
+		titlekey_cache_t cache;
+		ok &= es_titlekey_cache_init(&cache, runs[r].foreign ? &foreign_keys : &keys);
+
+		u32 rsa_before = host_rsa_exp_mods;
+		u32 start = get_tmr_us();
+		u32 found = _titlekey_cache_pass(runs[r].foreign ? &foreign_keys : &keys, &cache, tickets, records, runs[r].count);
+		u32 elapsed = get_tmr_us() - start;
+		u32 rsa = host_rsa_exp_mods - rsa_before;
+
+		u32 matched = 0;
+		for (u32 i = 0; i < found && i < runs[r].count; i++)
+			matched += !memcmp(_titlekey_buffer.rights_ids[i], tickets[i].rights_id, 0x10) && !memcmp(_titlekey_buffer.titlekeys[i], titlekeys[i], 0x10);
+
+		printf("  %-9s titlekeys %4u/%-4u  RSA decrypts %4u  cache hits %4u  list %-9s %8u us\n", runs[r].name, matched, runs[r].count,
+			rsa, cache.rsa_skipped, cache.list_match ? "unchanged" : "changed", elapsed);
+		ok &= found == runs[r].count && matched == runs[r].count && rsa == runs[r].rsa && cache.rsa_skipped == runs[r].skipped;
+
+		es_titlekey_cache_free(&cache);
+	}
+
+	EVP_PKEY_free(pkey);
+	free(titlekeys);
+	free(records);
+	free(tickets);
+	sd_end();
+	host_sdmmc_detach_all();
+
+	if (!ok)
+	{
+		printf("  titlekey or RSA count mismatch\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+static const bench_t _benches[] = {
+	{ "nca-lookup", "NCA database lookup, linear vs content id index", _bench_nca_lookup },
+	{ "bis-cache",  "BIS cluster cache replacement policies on a replayed trace", _bench_bis_cache },
+	{ "bis-read",   "Sequential BIS reads for several read-ahead windows", _bench_bis_read },
+	{ "bis-pipeline", "Sequential BIS reads overlapping eMMC transfers with decryption", _bench_bis_pipeline },
+	{ "bis-zero-copy", "BIS reads copied through read_buffer vs decrypted in place", _bench_bis_zero_copy },
+	{ "bis-volumes",   "SAFE and SYSTEM remounted in turn, shared vs per volume caches", _bench_bis_volumes },
+	{ "bis-mount",     "BIS mount cost and cache hit latency per partition geometry", _bench_bis_mount },
+	{ "sd-cache",      "SD accesses of a boot with and without the sector cache", _bench_sd_cache },
+	{ "save-seek",     "Random save file reads on a fragmented volume, FAT walk vs CLMT", _bench_save_seek },
+	{ "save-extents",  "Save data reads through journal and remap, block split vs extents", _bench_save_extents },
+	{ "remap-lookup",  "Remap segment construction and entry lookups on a large table", _bench_remap_lookup },
+	{ "save-fat",      "Sequential save file reads over a heavily segmented allocation table", _bench_save_fat },
+	{ "duplex-read",   "Duplex layer reads with the bitmap alternating between A and B", _bench_duplex_read },
+	{ "save-journal",  "Journal storage reads over map runs, checked per block", _bench_save_journal },
+	{ "save-fs-list",  "Save file table lookups, on-disk list walk vs key index", _bench_save_fs_list },
+	{ "ivfc-read",  "Verified save data reads through the IVFC hash levels", _bench_ivfc_read },
+	{ "titlekey-cache", "Personalized titlekeys with the SD titlekey cache, RSA decrypts per run", _bench_titlekey_cache },
+};
+
+int main(int argc, char **argv)
+{
+	bool run_all = argc < 2 || !strcmp(argv[1], "all");
+	int res = 0;
+	bool found = false;
+
+	for (u32 i = 0; i < ARRAY_SIZE(_benches); i++)
+	{
+		if (run_all || !strcmp(argv[1], _benches[i].name))
+		{
+			found = true;
+			res |= _benches[i].run(argc - 1, argv + 1);
+		}
+	}
+
+	if (!found)
+	{
+		fprintf(stderr, "Usage: %s [all", argv[0]);
+		for (u32 i = 0; i < ARRAY_SIZE(_benches); i++)
+			fprintf(stderr, "|%s", _benches[i].name);
+		fprintf(stderr, "]\n");
+		for (u32 i = 0; i < ARRAY_SIZE(_benches); i++)
+			fprintf(stderr, "  %-12s %s\n", _benches[i].name, _benches[i].desc);
+		return 1;
+	}
+
+	return res;
+}
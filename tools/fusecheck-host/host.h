@@ -0,0 +1,49 @@
+/*
+ * FuseCheck host build glue.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+#ifndef _HOST_H_
+#define _HOST_H_
+
+#include <storage/sdmmc.h>
+#include <utils/types.h>
+
+// eMMC timing model used to estimate device time from the I/O counters,
+// since reads from a host file are nearly free. Roughly HS400 sequential reads.
+#define HOST_EMMC_CMD_US     100 // Per command setup and access latency.
+#define HOST_EMMC_SECTORS_MS 500 // 256 KB/ms.
+#define HOST_EMMC_INIT_US    30000 // Power up, identification and HS400 tuning.
+#define HOST_EMMC_SWITCH_US  1000 // EXT_CSD partition switch and status check.
+
+#define HOST_EMMC_MODEL_US(cmds, sectors) ((u64)(cmds) * HOST_EMMC_CMD_US + (u64)(sectors) * 1000 / HOST_EMMC_SECTORS_MS)
+
+// Bulk SE AES throughput, used together with the eMMC model by host_set_latency().
+#define HOST_SE_AES_BYTES_US 128 // 128 KB/ms.
+
+typedef struct _host_io_stats_t
+{
+	u64 read_cmds;
+	u64 read_sectors;
+	u64 write_cmds;
+	u64 write_sectors;
+	u32 inits;
+	u32 partition_switches;
+} host_io_stats_t;
+
+extern host_io_stats_t host_io_stats;
+extern u32 host_rsa_exp_mods; // se_rsa_exp_mod() calls, for the titlekey cache.
+extern bool host_verbose;
+extern bool host_model_latency;
+
+int  host_sdmmc_attach(sdmmc_storage_t *storage, u32 partition, const char *path, bool writable);
+int  host_sdmmc_attach_scratch(sdmmc_storage_t *storage, u64 size);
+void host_sdmmc_detach_all();
+
+// Make eMMC init, partition switches, reads and bulk SE AES take their modelled time.
+void host_set_latency(bool enable);
+
+#endif
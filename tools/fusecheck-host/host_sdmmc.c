@@ -0,0 +1,301 @@
+/*
+ * File-backed stand-in for bdk/storage/sdmmc.c
+ *
+ * Each sdmmc_storage_t used by the shared sources (emmc_storage, sd_storage)
+ * can be attached to an image file. eMMC hardware partitions other than GPP
+ * are only available when a separate BOOT0/BOOT1 image is attached.
+ *
+ * Asynchronous reads run on a worker thread. With host_set_latency() every
+ * read also takes the HOST_EMMC_MODEL_US time, so overlap with the caller's
+ * work shows up in wall clock time. Init and partition switches are modelled
+ * the same way.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <storage/nx_sd.h>
+#include <storage/sdmmc.h>
+#include <utils/types.h>
+
+#include "host.h"
+
+#define HOST_MAX_DEVICES 4
+
+typedef struct _host_dev_t
+{
+	sdmmc_storage_t *storage;
+	int fd[EMMC_BOOT1 + 1];
+	u32 sec_cnt[EMMC_BOOT1 + 1];
+	pthread_t async_thread;
+} host_dev_t;
+
+static host_dev_t _devs[HOST_MAX_DEVICES];
+
+host_io_stats_t host_io_stats;
+
+static host_dev_t *_host_dev_get(sdmmc_storage_t *storage, bool create)
+{
+	for (u32 i = 0; i < HOST_MAX_DEVICES; i++)
+		if (_devs[i].storage == storage)
+			return &_devs[i];
+
+	if (!create)
+		return NULL;
+
+	for (u32 i = 0; i < HOST_MAX_DEVICES; i++)
+	{
+		if (!_devs[i].storage)
+		{
+			_devs[i].storage = storage;
+			for (u32 j = 0; j <= EMMC_BOOT1; j++)
+				_devs[i].fd[j] = -1;
+			return &_devs[i];
+		}
+	}
+
+	return NULL;
+}
+
+int host_sdmmc_attach(sdmmc_storage_t *storage, u32 partition, const char *path, bool writable)
+{
+	host_dev_t *dev = _host_dev_get(storage, true);
+	if (!dev || partition > EMMC_BOOT1)
+		return 0;
+
+	int fd = open(path, writable ? O_RDWR : O_RDONLY);
+	if (fd < 0)
+		return 0;
+
+	struct stat st;
+	if (fstat(fd, &st))
+	{
+		close(fd);
+		return 0;
+	}
+
+	if (dev->fd[partition] >= 0)
+		close(dev->fd[partition]);
+	dev->fd[partition] = fd;
+	dev->sec_cnt[partition] = st.st_size >> 9;
+
+	return 1;
+}
+
+// Attaches an unlinked sparse file of size bytes as the GPP partition.
+int host_sdmmc_attach_scratch(sdmmc_storage_t *storage, u64 size)
+{
+	host_dev_t *dev = _host_dev_get(storage, true);
+	if (!dev)
+		return 0;
+
+	char path[] = "/tmp/fusecheck-host-XXXXXX";
+	int fd = mkstemp(path);
+	if (fd < 0)
+		return 0;
+	unlink(path);
+
+	if (ftruncate(fd, size))
+	{
+		close(fd);
+		return 0;
+	}
+
+	if (dev->fd[EMMC_GPP] >= 0)
+		close(dev->fd[EMMC_GPP]);
+	dev->fd[EMMC_GPP] = fd;
+	dev->sec_cnt[EMMC_GPP] = size >> 9;
+
+	return 1;
+}
+
+void host_sdmmc_detach_all()
+{
+	for (u32 i = 0; i < HOST_MAX_DEVICES; i++)
+	{
+		for (u32 j = 0; j <= EMMC_BOOT1; j++)
+			if (_devs[i].storage && _devs[i].fd[j] >= 0)
+				close(_devs[i].fd[j]);
+		memset(&_devs[i], 0, sizeof(host_dev_t));
+	}
+}
+
+static int _host_dev_init(sdmmc_storage_t *storage)
+{
+	host_dev_t *dev = _host_dev_get(storage, false);
+	if (!dev || dev->fd[EMMC_GPP] < 0)
+		return 0;
+
+	storage->partition = EMMC_GPP;
+	storage->sec_cnt = dev->sec_cnt[EMMC_GPP];
+	storage->initialized = 1;
+
+	return 1;
+}
+
+int sdmmc_storage_end(sdmmc_storage_t *storage)
+{
+	storage->initialized = 0;
+
+	return 1;
+}
+
+static int _host_dev_read(host_dev_t *dev, u32 partition, u32 sector, u32 num_sectors, void *buf)
+{
+	int fd = dev->fd[partition];
+	if (fd < 0 || sector + num_sectors > dev->sec_cnt[partition])
+		return 0;
+
+	u64 size = (u64)num_sectors << 9;
+	if (pread(fd, buf, size, (off_t)sector << 9) != (ssize_t)size)
+		return 0;
+
+	if (host_model_latency)
+		usleep(HOST_EMMC_MODEL_US(1, num_sectors));
+
+	return 1;
+}
+
+int sdmmc_storage_read(sdmmc_storage_t *storage, u32 sector, u32 num_sectors, void *buf)
+{
+	host_dev_t *dev = _host_dev_get(storage, false);
+	if (!dev || !storage->initialized || storage->partition > EMMC_BOOT1)
+		return 0;
+
+	if (!_host_dev_read(dev, storage->partition, sector, num_sectors, buf))
+		return 0;
+
+	host_io_stats.read_cmds++;
+	host_io_stats.read_sectors += num_sectors;
+
+	return 1;
+}
+
+static void *_host_async_read(void *arg)
+{
+	sdmmc_storage_t *storage = arg;
+	sdmmc_async_read_t *rd = &storage->async_read;
+
+	rd->result = _host_dev_read(_host_dev_get(storage, false), storage->partition, rd->sector, rd->num_sectors, rd->buf);
+
+	return NULL;
+}
+
+int sdmmc_storage_read_start(sdmmc_storage_t *storage, u32 sector, u32 num_sectors, void *buf)
+{
+	sdmmc_async_read_t *rd = &storage->async_read;
+	host_dev_t *dev = _host_dev_get(storage, false);
+
+	rd->sector = sector;
+	rd->num_sectors = num_sectors;
+	rd->buf = buf;
+	rd->result = 0;
+	rd->pending = 2;
+
+	if (!dev || !storage->initialized || storage->partition > EMMC_BOOT1)
+		return 0;
+
+	host_io_stats.read_cmds++;
+	host_io_stats.read_sectors += num_sectors;
+
+	if (pthread_create(&dev->async_thread, NULL, _host_async_read, storage))
+	{
+		rd->result = _host_dev_read(dev, storage->partition, sector, num_sectors, buf);
+		return rd->result;
+	}
+	rd->pending = 1;
+
+	return 1;
+}
+
+int sdmmc_storage_read_finish(sdmmc_storage_t *storage)
+{
+	sdmmc_async_read_t *rd = &storage->async_read;
+	int pending = rd->pending;
+	rd->pending = 0;
+
+	if (pending == 1)
+		pthread_join(_host_dev_get(storage, false)->async_thread, NULL);
+
+	return pending ? rd->result : 0;
+}
+
+int sdmmc_storage_write(sdmmc_storage_t *storage, u32 sector, u32 num_sectors, void *buf)
+{
+	host_dev_t *dev = _host_dev_get(storage, false);
+	if (!dev || !storage->initialized || storage->partition > EMMC_BOOT1)
+		return 0;
+
+	int fd = dev->fd[storage->partition];
+	if (fd < 0 || sector + num_sectors > dev->sec_cnt[storage->partition])
+		return 0;
+
+	u64 size = (u64)num_sectors << 9;
+	if (pwrite(fd, buf, size, (off_t)sector << 9) != (ssize_t)size)
+		return 0;
+
+	host_io_stats.write_cmds++;
+	host_io_stats.write_sectors += num_sectors;
+
+	return 1;
+}
+
+int sdmmc_storage_init_mmc(sdmmc_storage_t *storage, sdmmc_t *sdmmc, u32 bus_width, u32 type)
+{
+	storage->sdmmc = sdmmc;
+	host_io_stats.inits++;
+
+	if (host_model_latency)
+		usleep(HOST_EMMC_INIT_US);
+
+	return _host_dev_init(storage);
+}
+
+int sdmmc_storage_set_mmc_partition(sdmmc_storage_t *storage, u32 partition)
+{
+	host_dev_t *dev = _host_dev_get(storage, false);
+	if (!dev || partition > EMMC_BOOT1)
+		return 0;
+
+	host_io_stats.partition_switches++;
+	if (host_model_latency)
+		usleep(HOST_EMMC_SWITCH_US);
+
+	storage->partition = partition;
+	storage->sec_cnt = dev->sec_cnt[partition];
+
+	return 1;
+}
+
+void sdmmc_storage_init_wait_sd() { }
+
+int sdmmc_storage_init_sd(sdmmc_storage_t *storage, sdmmc_t *sdmmc, u32 bus_width, u32 type)
+{
+	storage->sdmmc = sdmmc;
+
+	return _host_dev_init(storage);
+}
+
+u32 sd_storage_get_ssr_au(sdmmc_storage_t *storage)
+{
+	return 0;
+}
+
+int sdmmc_storage_init_gc(sdmmc_storage_t *storage, sdmmc_t *sdmmc)
+{
+	return 0;
+}
+
+bool sdmmc_get_sd_inserted()
+{
+	return _host_dev_get(&sd_storage, false) != NULL;
+}
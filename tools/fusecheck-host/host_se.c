@@ -0,0 +1,464 @@
+/*
+ * Software stand-in for bdk/sec/se.c
+ *
+ * Implements the Security Engine API used by the shared FuseCheck sources on
+ * top of OpenSSL's libcrypto. Keyslots are plain arrays; operations run
+ * synchronously on the CPU.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include <openssl/aes.h>
+#include <openssl/bn.h>
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+
+#include <sec/se.h>
+#include <sec/se_t210.h>
+#include <utils/types.h>
+
+#include "host.h"
+
+typedef struct _host_aes_slot_t
+{
+	u8  key[SE_AES_MAX_KEY_SIZE];
+	u32 key_size;
+	u8  iv[SE_AES_IV_SIZE];
+	AES_KEY enc;
+	AES_KEY dec;
+	EVP_CIPHER_CTX *ecb_enc; // EVP for bulk ECB, so AES-NI is used when available.
+	EVP_CIPHER_CTX *ecb_dec;
+} host_aes_slot_t;
+
+typedef struct _host_rsa_slot_t
+{
+	u8  mod[SE_RSA2048_DIGEST_SIZE];
+	u32 mod_size;
+	u8  exp[SE_RSA2048_DIGEST_SIZE];
+	u32 exp_size;
+} host_rsa_slot_t;
+
+static host_aes_slot_t _aes_slots[SE_AES_KEYSLOT_COUNT];
+static host_rsa_slot_t _rsa_slots[SE_RSA_KEYSLOT_COUNT];
+static SHA256_CTX _sha_ctx;
+
+u32 host_rsa_exp_mods;
+
+static void _gf256_mul_x(void *block)
+{
+	u8 *pdata = (u8 *)block;
+	u32 carry = 0;
+
+	for (int i = 0xF; i >= 0; i--)
+	{
+		u8 b = pdata[i];
+		pdata[i] = (b << 1) | carry;
+		carry = b >> 7;
+	}
+
+	if (carry)
+		pdata[0xF] ^= 0x87;
+}
+
+static void _gf256_mul_x_le(void *block)
+{
+	u32 *pdata = (u32 *)block;
+	u32 carry = 0;
+
+	for (u32 i = 0; i < 4; i++)
+	{
+		u32 b = pdata[i];
+		pdata[i] = (b << 1) | carry;
+		carry = b >> 31;
+	}
+
+	if (carry)
+		pdata[0x0] ^= 0x87;
+}
+
+static void _aes_slot_expand(u32 ks)
+{
+	host_aes_slot_t *slot = &_aes_slots[ks];
+	u32 bits = (slot->key_size ? slot->key_size : SE_KEY_128_SIZE) * 8;
+
+	AES_set_encrypt_key(slot->key, bits, &slot->enc);
+	AES_set_decrypt_key(slot->key, bits, &slot->dec);
+
+	const EVP_CIPHER *cipher = bits == 256 ? EVP_aes_256_ecb() : (bits == 192 ? EVP_aes_192_ecb() : EVP_aes_128_ecb());
+	if (!slot->ecb_enc)
+	{
+		slot->ecb_enc = EVP_CIPHER_CTX_new();
+		slot->ecb_dec = EVP_CIPHER_CTX_new();
+	}
+	EVP_EncryptInit_ex(slot->ecb_enc, cipher, NULL, slot->key, NULL);
+	EVP_CIPHER_CTX_set_padding(slot->ecb_enc, 0);
+	EVP_DecryptInit_ex(slot->ecb_dec, cipher, NULL, slot->key, NULL);
+	EVP_CIPHER_CTX_set_padding(slot->ecb_dec, 0);
+}
+
+void se_rsa_acc_ctrl(u32 rs, u32 flags) { }
+
+void se_rsa_key_set(u32 ks, const void *mod, u32 mod_size, const void *exp, u32 exp_size)
+{
+	if (ks >= SE_RSA_KEYSLOT_COUNT)
+		return;
+
+	memcpy(_rsa_slots[ks].mod, mod, MIN(mod_size, SE_RSA2048_DIGEST_SIZE));
+	memcpy(_rsa_slots[ks].exp, exp, MIN(exp_size, SE_RSA2048_DIGEST_SIZE));
+	_rsa_slots[ks].mod_size = MIN(mod_size, SE_RSA2048_DIGEST_SIZE);
+	_rsa_slots[ks].exp_size = MIN(exp_size, SE_RSA2048_DIGEST_SIZE);
+}
+
+void se_rsa_key_clear(u32 ks)
+{
+	if (ks < SE_RSA_KEYSLOT_COUNT)
+		memset(&_rsa_slots[ks], 0, sizeof(host_rsa_slot_t));
+}
+
+int se_rsa_exp_mod(u32 ks, void *dst, u32 dst_size, const void *src, u32 src_size)
+{
+	if (ks >= SE_RSA_KEYSLOT_COUNT)
+		return 0;
+
+	host_rsa_exp_mods++;
+
+	int res = 0;
+	BN_CTX *ctx = BN_CTX_new();
+	BIGNUM *m = BN_bin2bn(_rsa_slots[ks].mod, _rsa_slots[ks].mod_size, NULL);
+	BIGNUM *e = BN_bin2bn(_rsa_slots[ks].exp, _rsa_slots[ks].exp_size, NULL);
+	BIGNUM *x = BN_bin2bn(src, src_size, NULL);
+	BIGNUM *r = BN_new();
+
+	if (ctx && m && e && x && r && BN_mod_exp(r, x, e, m, ctx))
+		res = BN_bn2binpad(r, dst, dst_size) >= 0;
+
+	BN_free(r);
+	BN_free(x);
+	BN_free(e);
+	BN_free(m);
+	BN_CTX_free(ctx);
+
+	return res;
+}
+
+void se_key_acc_ctrl(u32 ks, u32 flags) { }
+
+u32 se_key_acc_ctrl_get(u32 ks)
+{
+	return 0;
+}
+
+void se_aes_key_set(u32 ks, const void *key, u32 size)
+{
+	if (ks >= SE_AES_KEYSLOT_COUNT)
+		return;
+
+	size = MIN(size, SE_AES_MAX_KEY_SIZE);
+	memcpy(_aes_slots[ks].key, key, size);
+	_aes_slots[ks].key_size = size;
+	_aes_slot_expand(ks);
+}
+
+void se_aes_key_partial_set(u32 ks, u32 index, u32 data)
+{
+	if (ks >= SE_AES_KEYSLOT_COUNT || index >= SE_AES_MAX_KEY_SIZE / 4)
+		return;
+
+	memcpy(_aes_slots[ks].key + index * 4, &data, 4);
+	_aes_slot_expand(ks);
+}
+
+void se_aes_iv_set(u32 ks, const void *iv)
+{
+	if (ks < SE_AES_KEYSLOT_COUNT)
+		memcpy(_aes_slots[ks].iv, iv, SE_AES_IV_SIZE);
+}
+
+void se_aes_key_get(u32 ks, void *key, u32 size)
+{
+	if (ks < SE_AES_KEYSLOT_COUNT)
+		memcpy(key, _aes_slots[ks].key, MIN(size, SE_AES_MAX_KEY_SIZE));
+}
+
+void se_aes_key_clear(u32 ks)
+{
+	if (ks >= SE_AES_KEYSLOT_COUNT)
+		return;
+
+	memset(_aes_slots[ks].key, 0, SE_AES_MAX_KEY_SIZE);
+	_aes_slots[ks].key_size = 0;
+	_aes_slot_expand(ks);
+}
+
+void se_aes_iv_clear(u32 ks)
+{
+	if (ks < SE_AES_KEYSLOT_COUNT)
+		memset(_aes_slots[ks].iv, 0, SE_AES_IV_SIZE);
+}
+
+int se_aes_unwrap_key(u32 ks_dst, u32 ks_src, const void *input)
+{
+	u8 key[SE_KEY_128_SIZE];
+
+	if (!se_aes_crypt_block_ecb(ks_src, DECRYPT, key, input))
+		return 0;
+	se_aes_key_set(ks_dst, key, SE_KEY_128_SIZE);
+
+	return 1;
+}
+
+int se_aes_crypt_ecb(u32 ks, u32 enc, void *dst, u32 dst_size, const void *src, u32 src_size)
+{
+	if (ks >= SE_AES_KEYSLOT_COUNT)
+		return 0;
+
+	host_aes_slot_t *slot = &_aes_slots[ks];
+	int size = MIN(src_size, dst_size) & ~(SE_AES_BLOCK_SIZE - 1);
+	int out = 0;
+
+	if (!slot->ecb_enc)
+		_aes_slot_expand(ks);
+
+	if (host_model_latency && size >= HOST_SE_AES_BYTES_US)
+		usleep(size / HOST_SE_AES_BYTES_US);
+
+	if (enc)
+		return EVP_EncryptUpdate(slot->ecb_enc, dst, &out, src, size) == 1;
+
+	return EVP_DecryptUpdate(slot->ecb_dec, dst, &out, src, size) == 1;
+}
+
+int se_aes_crypt_cbc(u32 ks, u32 enc, void *dst, u32 dst_size, const void *src, u32 src_size)
+{
+	if (ks >= SE_AES_KEYSLOT_COUNT)
+		return 0;
+
+	u8 iv[SE_AES_IV_SIZE];
+	memcpy(iv, _aes_slots[ks].iv, SE_AES_IV_SIZE);
+	AES_cbc_encrypt(src, dst, MIN(src_size, dst_size) & ~(SE_AES_BLOCK_SIZE - 1),
+		enc ? &_aes_slots[ks].enc : &_aes_slots[ks].dec, iv, enc ? AES_ENCRYPT : AES_DECRYPT);
+
+	return 1;
+}
+
+int se_aes_crypt_block_ecb(u32 ks, u32 enc, void *dst, const void *src)
+{
+	return se_aes_crypt_ecb(ks, enc, dst, SE_AES_BLOCK_SIZE, src, SE_AES_BLOCK_SIZE);
+}
+
+int se_aes_crypt_ctr(u32 ks, void *dst, u32 dst_size, const void *src, u32 src_size, const void *ctr)
+{
+	if (ks >= SE_AES_KEYSLOT_COUNT)
+		return 0;
+
+	u8 counter[SE_AES_BLOCK_SIZE];
+	u8 stream[SE_AES_BLOCK_SIZE];
+	const u8 *psrc = (const u8 *)src;
+	u8 *pdst = (u8 *)dst;
+	u32 size = MIN(src_size, dst_size);
+
+	memcpy(counter, ctr, SE_AES_BLOCK_SIZE);
+	for (u32 i = 0; i < size; i += SE_AES_BLOCK_SIZE)
+	{
+		AES_encrypt(counter, stream, &_aes_slots[ks].enc);
+		for (u32 j = 0; j < MIN(SE_AES_BLOCK_SIZE, size - i); j++)
+			pdst[i + j] = psrc[i + j] ^ stream[j];
+
+		// Big endian 128-bit counter increment.
+		for (int j = SE_AES_BLOCK_SIZE - 1; j >= 0; j--)
+			if (++counter[j])
+				break;
+	}
+
+	return 1;
+}
+
+int se_initialize_rng()
+{
+	return 1;
+}
+
+int se_generate_random(void *dst, u32 size)
+{
+	u8 *pdst = (u8 *)dst;
+	for (u32 i = 0; i < size; i++)
+		pdst[i] = (u8)(i * 0x9D + 0x3B);
+
+	return 1;
+}
+
+int se_generate_random_key(u32 ks_dst, u32 ks_src)
+{
+	u8 key[SE_KEY_128_SIZE];
+	se_generate_random(key, sizeof(key));
+	se_aes_key_set(ks_dst, key, sizeof(key));
+
+	return 1;
+}
+
+int se_aes_xts_crypt_sec(u32 tweak_ks, u32 crypt_ks, u32 enc, u64 sec, void *dst, const void *src, u32 sec_size)
+{
+	u8 tweak[0x10] __attribute__((aligned(4)));
+	u8 orig_tweak[0x10] __attribute__((aligned(4)));
+	u32 *pdst = (u32 *)dst;
+	u32 *psrc = (u32 *)src;
+
+	//Generate tweak.
+	for (int i = 0xF; i >= 0; i--)
+	{
+		tweak[i] = sec & 0xFF;
+		sec >>= 8;
+	}
+	if (!se_aes_crypt_block_ecb(tweak_ks, ENCRYPT, tweak, tweak))
+		return 0;
+
+	memcpy(orig_tweak, tweak, 0x10);
+
+	// Both whitening passes step the tweak as they XOR, so no tweak stream is stored.
+	// We are assuming a 0x10-aligned sector size in this implementation.
+	u32 *ptweak = (u32 *)tweak;
+	for (u32 i = 0; i < sec_size / 4; i += 4)
+	{
+		for (u32 j = 0; j < 4; j++)
+			pdst[i + j] = psrc[i + j] ^ ptweak[j];
+		_gf256_mul_x_le(tweak);
+	}
+
+	if (!se_aes_crypt_ecb(crypt_ks, enc, dst, sec_size, dst, sec_size))
+		return 0;
+
+	ptweak = (u32 *)orig_tweak;
+	for (u32 i = 0; i < sec_size / 4; i += 4)
+	{
+		for (u32 j = 0; j < 4; j++)
+			pdst[i + j] ^= ptweak[j];
+		_gf256_mul_x_le(orig_tweak);
+	}
+
+	return 1;
+}
+
+int se_aes_xts_crypt(u32 tweak_ks, u32 crypt_ks, u32 enc, u64 sec, void *dst, const void *src, u32 sec_size, u32 num_secs)
+{
+	u8 *pdst = (u8 *)dst;
+	u8 *psrc = (u8 *)src;
+
+	for (u32 i = 0; i < num_secs; i++)
+		if (!se_aes_xts_crypt_sec(tweak_ks, crypt_ks, enc, sec + i, pdst + sec_size * i, psrc + sec_size * i, sec_size))
+			return 0;
+
+	return 1;
+}
+
+int se_aes_cmac(u32 ks, void *dst, u32 dst_size, const void *src, u32 src_size)
+{
+	u8 key[0x10] = {0};
+	u8 mac[0x10] = {0};
+	u8 last_block[0x10] = {0};
+	const u8 *psrc = (const u8 *)src;
+
+	// Generate derived key.
+	if (!se_aes_crypt_block_ecb(ks, ENCRYPT, key, key))
+		return 0;
+	_gf256_mul_x(key);
+	if (src_size & 0xF)
+		_gf256_mul_x(key);
+
+	u32 num_blocks = (src_size + 0xF) >> 4;
+	for (u32 i = 0; i + 1 < num_blocks; i++)
+	{
+		for (u32 j = 0; j < 0x10; j++)
+			mac[j] ^= psrc[i * 0x10 + j];
+		AES_encrypt(mac, mac, &_aes_slots[ks].enc);
+	}
+
+	if (src_size & 0xF)
+	{
+		memcpy(last_block, psrc + (src_size & ~0xF), src_size & 0xF);
+		last_block[src_size & 0xF] = 0x80;
+	}
+	else if (src_size >= 0x10)
+		memcpy(last_block, psrc + src_size - 0x10, 0x10);
+
+	for (u32 i = 0; i < 0x10; i++)
+		mac[i] ^= last_block[i] ^ key[i];
+	AES_encrypt(mac, mac, &_aes_slots[ks].enc);
+
+	memcpy(dst, mac, MIN(dst_size, 0x10));
+
+	return 1;
+}
+
+int se_calc_sha256(void *hash, u32 *msg_left, const void *src, u32 src_size, u64 total_size, u32 sha_cfg, bool is_oneshot)
+{
+	if (src_size > 0xFFFFFF || !hash)
+		return 0;
+
+	if (sha_cfg == SHA_INIT_HASH)
+		SHA256_Init(&_sha_ctx);
+
+	SHA256_Update(&_sha_ctx, src, src_size);
+
+	if (is_oneshot)
+		SHA256_Final(hash, &_sha_ctx);
+
+	if (msg_left)
+		msg_left[0] = msg_left[1] = 0;
+
+	return 1;
+}
+
+int se_calc_sha256_oneshot(void *hash, const void *src, u32 src_size)
+{
+	return se_calc_sha256(hash, NULL, src, src_size, 0, SHA_INIT_HASH, true);
+}
+
+int se_calc_sha256_finalize(void *hash, u32 *msg_left)
+{
+	SHA256_Final(hash, &_sha_ctx);
+
+	if (msg_left)
+		msg_left[0] = msg_left[1] = 0;
+
+	return 1;
+}
+
+int se_calc_hmac_sha256(void *dst, const void *src, u32 src_size, const void *key, u32 key_size)
+{
+	u8 secret[0x40] = {0};
+	u8 pad[0x40];
+	u8 inner[SE_SHA_256_SIZE];
+	SHA256_CTX ctx;
+
+	if (key_size > 0x40)
+		SHA256(key, key_size, secret);
+	else
+		memcpy(secret, key, key_size);
+
+	for (u32 i = 0; i < 0x40; i++)
+		pad[i] = secret[i] ^ 0x36;
+	SHA256_Init(&ctx);
+	SHA256_Update(&ctx, pad, sizeof(pad));
+	SHA256_Update(&ctx, src, src_size);
+	SHA256_Final(inner, &ctx);
+
+	for (u32 i = 0; i < 0x40; i++)
+		pad[i] = secret[i] ^ 0x5C;
+	SHA256_Init(&ctx);
+	SHA256_Update(&ctx, pad, sizeof(pad));
+	SHA256_Update(&ctx, inner, sizeof(inner));
+	SHA256_Final(dst, &ctx);
+
+	return 1;
+}
+
+void se_get_aes_keys(u8 *buf, u8 *keys, u32 keysize)
+{
+	for (u32 i = 0; i < SE_AES_KEYSLOT_COUNT; i++)
+		memcpy(keys + i * keysize, _aes_slots[i].key, MIN(keysize, SE_AES_MAX_KEY_SIZE));
+}
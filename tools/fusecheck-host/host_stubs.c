@@ -0,0 +1,240 @@
+/*
+ * Stand-ins for the hardware facing bdk/source symbols referenced by the
+ * shared sources in the host build.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <memory_map.h>
+
+#include "../../source/config.h"
+#include "../../source/gfx/gfx.h"
+#include "../../source/gfx/tui.h"
+#include <mem/heap.h>
+#include <sec/tsec.h>
+#include <soc/fuse.h>
+#include <utils/types.h>
+#include <utils/util.h>
+
+#include "host.h"
+
+// DRAM carveout used by the BIS driver.
+u8 host_nx_bis_cache[NX_BIS_CACHE_SZ] __attribute__((aligned(0x1000)));
+
+hekate_config h_cfg = { .emummc_force_disable = true };
+gfx_ctxt_t gfx_ctxt;
+gfx_con_t gfx_con;
+bool host_verbose = false;
+bool host_model_latency = false;
+
+void host_set_latency(bool enable)
+{
+	host_model_latency = enable;
+}
+
+static u32 _heap_allocs = 0;
+
+// Linked with --wrap=malloc,--wrap=calloc so the shared sources are counted like on the bdk heap.
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t num, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+	_heap_allocs++;
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t num, size_t size)
+{
+	_heap_allocs++;
+	return __real_calloc(num, size);
+}
+
+u32 heap_alloc_count()
+{
+	return _heap_allocs;
+}
+
+void heap_init(u32 base) { }
+
+void heap_monitor(heap_monitor_t *mon, bool print_node_stats)
+{
+	memset(mon, 0, sizeof(heap_monitor_t));
+}
+
+u32 get_tmr_us()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (u32)((u64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+u32 get_tmr_ms()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (u32)((u64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+u32 get_tmr_s()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (u32)ts.tv_sec;
+}
+
+void usleep(u32 us)
+{
+	struct timespec ts = { .tv_sec = us / 1000000, .tv_nsec = (us % 1000000) * 1000 };
+	nanosleep(&ts, NULL);
+}
+
+void msleep(u32 ms)
+{
+	usleep(ms * 1000);
+}
+
+u16 crc16_calc(const u8 *buf, u32 len)
+{
+	const u8 *p, *q;
+	u16 crc = 0x55aa;
+
+	static u16 table[16] = {
+		0x0000, 0xCC01, 0xD801, 0x1400, 0xF001, 0x3C00, 0x2800, 0xE401,
+		0xA001, 0x6C00, 0x7800, 0xB401, 0x5000, 0x9C01, 0x8801, 0x4400
+	};
+
+	q = buf + len;
+	for (p = buf; p < q; p++)
+	{
+		u8 oct = *p;
+		crc = (crc >> 4) ^ table[crc & 0xf] ^ table[(oct >> 0) & 0xf];
+		crc = (crc >> 4) ^ table[crc & 0xf] ^ table[(oct >> 4) & 0xf];
+	}
+
+	return crc;
+}
+
+u32 crc32_calc(u32 crc, const u8 *buf, u32 len)
+{
+	static u32 table[256];
+
+	if (!table[1])
+	{
+		for (u32 i = 0; i < 256; i++)
+		{
+			u32 rem = i;
+			for (u32 j = 0; j < 8; j++)
+				rem = (rem & 1) ? (rem >> 1) ^ 0xedb88320 : rem >> 1;
+			table[i] = rem;
+		}
+	}
+
+	crc = ~crc;
+	for (u32 i = 0; i < len; i++)
+		crc = (crc >> 8) ^ table[(crc & 0xff) ^ buf[i]];
+
+	return ~crc;
+}
+
+char *itoa(int value, char *str, int base)
+{
+	if (base == 16)
+		sprintf(str, "%x", value);
+	else
+		sprintf(str, "%d", value);
+
+	return str;
+}
+
+u32 fuse_read_hw_state()
+{
+	return FUSE_NX_HW_STATE_PROD;
+}
+
+u32 fuse_read_bootrom_rev()
+{
+	return 0;
+}
+
+// There is no TSEC to run the keygen firmware on.
+int tsec_query(void *tsec_keys, tsec_ctxt_t *tsec_ctxt)
+{
+	return -1;
+}
+
+void minerva_periodic_training() { }
+
+void tui_pbar(int x, int y, u32 val, u32 fgcol, u32 bgcol) { }
+
+// gfx_printf with bdk semantics (%k sets the color), written to stderr.
+void gfx_printf(const char *fmt, ...)
+{
+	if (gfx_con.mute || !host_verbose)
+		return;
+
+	va_list ap;
+	va_start(ap, fmt);
+
+	while (*fmt)
+	{
+		if (*fmt != '%')
+		{
+			fputc(*fmt++, stderr);
+			continue;
+		}
+
+		// Collect a single conversion spec.
+		char spec[16] = "%";
+		u32 len = 1;
+		fmt++;
+		while (*fmt && strchr("0123456789-.l", *fmt) && len < sizeof(spec) - 2)
+			spec[len++] = *fmt++;
+		char conv = *fmt ? *fmt++ : '\0';
+		spec[len++] = conv;
+		spec[len] = '\0';
+
+		switch (conv)
+		{
+		case 'k':
+			(void)va_arg(ap, u32);
+			break;
+		case 's':
+			fprintf(stderr, spec, va_arg(ap, const char *));
+			break;
+		case 'c':
+		case 'd':
+			fprintf(stderr, spec, va_arg(ap, int));
+			break;
+		case 'u':
+		case 'x':
+		case 'X':
+			fprintf(stderr, spec, va_arg(ap, unsigned int));
+			break;
+		case 'p':
+			fprintf(stderr, spec, va_arg(ap, void *));
+			break;
+		case '%':
+			fputc('%', stderr);
+			break;
+		}
+	}
+
+	va_end(ap);
+}
+
+void gfx_puts(const char *s)
+{
+	if (!gfx_con.mute && host_verbose)
+		fputs(s, stderr);
+}
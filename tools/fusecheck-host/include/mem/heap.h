@@ -0,0 +1,29 @@
+/*
+ * Host stand-in for the bdk heap.
+ *
+ * The bdk heap hands out memory from a fixed DRAM carveout. On the host the
+ * shared sources are linked against the C library allocator instead, so this
+ * header shadows bdk/mem/heap.h and only keeps the bdk specific API.
+ */
+
+#ifndef _HEAP_H_
+#define _HEAP_H_
+
+#include <stdlib.h>
+
+#include <utils/types.h>
+
+typedef struct
+{
+    u32 total;
+    u32 used;
+} heap_monitor_t;
+
+void heap_init(u32 base);
+void heap_monitor(heap_monitor_t *mon, bool print_node_stats);
+u32  heap_alloc_count(); // malloc/calloc calls made by the linked objects.
+
+// newlib provides itoa in stdlib.h, glibc does not.
+char *itoa(int value, char *str, int base);
+
+#endif
@@ -0,0 +1,20 @@
+/*
+ * Host stand-in for bdk/memory_map.h.
+ *
+ * The fixed DRAM carveout used by the shared sources is redirected to a host
+ * buffer of the same size (see host_stubs.c). Everything else is inherited.
+ */
+
+#ifndef _HOST_MEMORY_MAP_H_
+#define _HOST_MEMORY_MAP_H_
+
+#include_next <memory_map.h>
+
+#include <utils/types.h>
+
+extern u8 host_nx_bis_cache[];
+
+#undef  NX_BIS_CACHE_ADDR
+#define NX_BIS_CACHE_ADDR  ((uptr)host_nx_bis_cache)
+
+#endif
@@ -0,0 +1,346 @@
+/*
+ * FuseCheck host build
+ *
+ * Runs the firmware detection pipeline of the payload against a raw NAND
+ * dump, with the Security Engine and SDMMC controller replaced by OpenSSL
+ * and file backed stand-ins. Key derivation needs the TSEC and the fuses,
+ * so BIS keys are instead read from a prod.keys style file.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../source/fusecheck/fuse_db.h"
+#include "../../source/fusecheck/fw_detect.h"
+#include "../../source/fusecheck/profile.h"
+#include "../../source/keys/cal0_read.h"
+#include "../../source/storage/emummc.h"
+#include "../../source/storage/nx_emmc.h"
+#include <sec/se.h>
+#include <sec/se_t210.h>
+#include <storage/nx_sd.h>
+#include <utils/util.h>
+
+#include "host.h"
+
+#define MAX_STAGES 16
+
+typedef struct _stage_t
+{
+	const char *name;
+	u32 us;
+} stage_t;
+
+static stage_t _stages[MAX_STAGES];
+static u32 _stage_cnt;
+
+static void _stage_add(const char *name, u32 us)
+{
+	for (u32 i = 0; i < _stage_cnt; i++)
+	{
+		if (!strcmp(_stages[i].name, name))
+		{
+			_stages[i].us += us;
+			return;
+		}
+	}
+
+	if (_stage_cnt < MAX_STAGES)
+	{
+		_stages[_stage_cnt].name = name;
+		_stages[_stage_cnt].us = us;
+		_stage_cnt++;
+	}
+}
+
+void debug_log(const char *msg)
+{
+	if (host_verbose)
+		fprintf(stderr, "%s\n", msg);
+}
+
+// Stages inside detect_firmware_from_nca are timed through linker wrapping.
+void __real_nx_emmc_gpt_parse(link_t *gpt, sdmmc_storage_t *storage);
+void __wrap_nx_emmc_gpt_parse(link_t *gpt, sdmmc_storage_t *storage)
+{
+	u32 start = get_tmr_us();
+	__real_nx_emmc_gpt_parse(gpt, storage);
+	_stage_add("gpt", get_tmr_us() - start);
+}
+
+FRESULT __real_f_mount(FATFS *fs, const TCHAR *path, BYTE opt);
+FRESULT __wrap_f_mount(FATFS *fs, const TCHAR *path, BYTE opt)
+{
+	u32 start = get_tmr_us();
+	FRESULT res = __real_f_mount(fs, path, opt);
+	_stage_add(fs ? "mount" : "unmount", get_tmr_us() - start);
+
+	return res;
+}
+
+static int _hex_nibble(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+
+	return -1;
+}
+
+static bool _parse_hex(const char *s, u8 *out, u32 size)
+{
+	for (u32 i = 0; i < size; i++)
+	{
+		int hi = _hex_nibble(s[i * 2]);
+		int lo = hi < 0 ? -1 : _hex_nibble(s[i * 2 + 1]);
+		if (lo < 0)
+			return false;
+		out[i] = (hi << 4) | lo;
+	}
+
+	return true;
+}
+
+// Reads bis_key_00..02 from a prod.keys style file ("name = hex").
+static int _load_bis_keys(const char *path, key_storage_t *keys)
+{
+	FILE *fp = fopen(path, "r");
+	if (!fp)
+		return -1;
+
+	int found = 0;
+	char line[512];
+	while (fgets(line, sizeof(line), fp))
+	{
+		u32 idx;
+		char hex[129];
+		if (sscanf(line, " bis_key_%02u = %128s", &idx, hex) != 2 || idx > 2)
+			continue;
+		if (strlen(hex) != SE_KEY_128_SIZE * 4 || !_parse_hex(hex, keys->bis_key[idx], SE_KEY_128_SIZE * 2))
+			continue;
+		found |= BIT(idx);
+	}
+	fclose(fp);
+
+	return found;
+}
+
+static char *_read_file(const char *path, u32 *size)
+{
+	FILE *fp = fopen(path, "rb");
+	if (!fp)
+		return NULL;
+
+	fseek(fp, 0, SEEK_END);
+	long len = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	char *buf = malloc(len + 1);
+	if (buf && fread(buf, 1, len, fp) != (size_t)len)
+	{
+		free(buf);
+		buf = NULL;
+	}
+	fclose(fp);
+
+	if (buf)
+	{
+		buf[len] = '\0';
+		*size = len;
+	}
+
+	return buf;
+}
+
+static void _usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [-d fusecheck_db.txt] [-s sd.img] [-e] [-l] [-v] rawnand.bin prod.keys\n"
+		"  -d  Database file, text or binary (default: ../../fusecheck_db.txt)\n"
+		"  -s  SD card image, database is then read from " DATABASE_PATH "\n"
+		"  -e  Enumerate Contents/registered instead of probing known NCAs\n"
+		"  -l  Make eMMC and SE operations take their modelled time\n"
+		"  -v  Print payload debug output\n", argv0);
+}
+
+int main(int argc, char **argv)
+{
+	const char *db_path = NULL;
+	const char *sd_path = NULL;
+	int arg = 1;
+
+	profile_init();
+
+	for (; arg < argc && argv[arg][0] == '-'; arg++)
+	{
+		if (!strcmp(argv[arg], "-v"))
+			host_verbose = true;
+		else if (!strcmp(argv[arg], "-l"))
+			host_set_latency(true);
+		else if (!strcmp(argv[arg], "-e"))
+			fw_detect_set_strategy(FW_DETECT_ENUMERATE);
+		else if (!strcmp(argv[arg], "-d") && arg + 1 < argc)
+			db_path = argv[++arg];
+		else if (!strcmp(argv[arg], "-s") && arg + 1 < argc)
+			sd_path = argv[++arg];
+		else
+		{
+			_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (argc - arg != 2)
+	{
+		_usage(argv[0]);
+		return 1;
+	}
+
+	const char *nand_path = argv[arg];
+	const char *keys_path = argv[arg + 1];
+
+	u32 start_total = get_tmr_us();
+	u32 start;
+
+	if (!host_sdmmc_attach(&emmc_storage, EMMC_GPP, nand_path, false))
+	{
+		fprintf(stderr, "Failed to open %s\n", nand_path);
+		return 1;
+	}
+
+	// Stands in for derive_bis_keys_silently, which opens the eMMC session on BOOT0.
+	start = get_tmr_us();
+	if (emummc_storage_init_mmc())
+	{
+		fprintf(stderr, "eMMC init failed\n");
+		return 1;
+	}
+	emummc_storage_set_mmc_partition(EMMC_BOOT0);
+	key_storage_t keys = {0};
+	int found = _load_bis_keys(keys_path, &keys);
+	if (found < 0)
+	{
+		fprintf(stderr, "Failed to open %s\n", keys_path);
+		return 1;
+	}
+	if (!(found & BIT(2)))
+	{
+		fprintf(stderr, "bis_key_02 missing from %s\n", keys_path);
+		return 1;
+	}
+	for (u32 i = 0; i < 3; i++)
+	{
+		se_aes_key_set(KS_BIS_00_CRYPT + i * 2, keys.bis_key[i] + 0x00, SE_KEY_128_SIZE);
+		se_aes_key_set(KS_BIS_00_TWEAK + i * 2, keys.bis_key[i] + 0x10, SE_KEY_128_SIZE);
+	}
+	_stage_add("keys", get_tmr_us() - start);
+
+	// Database.
+	start = get_tmr_us();
+	if (sd_path)
+	{
+		if (!host_sdmmc_attach(&sd_storage, EMMC_GPP, sd_path, false) || !sd_mount())
+		{
+			fprintf(stderr, "Failed to mount %s\n", sd_path);
+			return 1;
+		}
+		load_database();
+	}
+	else
+	{
+		u32 db_size = 0;
+		char *db = _read_file(db_path ? db_path : "../../fusecheck_db.txt", &db_size);
+		if (db)
+		{
+			if (db_size >= sizeof(u32) && *(u32 *)db == FUSE_DB_BIN_MAGIC)
+			{
+				if (!load_database_from_bin(db, db_size))
+					fprintf(stderr, "Invalid binary database\n");
+			}
+			else
+				load_database_from_buffer(db, db_size);
+			free(db);
+		}
+		else
+			fprintf(stderr, "Database not found, continuing without it\n");
+	}
+	_stage_add("database", get_tmr_us() - start);
+
+	start = get_tmr_us();
+	if (emummc_storage_init_mmc())
+	{
+		fprintf(stderr, "eMMC init failed\n");
+		return 1;
+	}
+	_stage_add("emmc_init", get_tmr_us() - start);
+
+	char serial_number[0x19] = {0};
+	if (found & BIT(0))
+	{
+		start = get_tmr_us();
+		nx_emmc_cal0_t *cal0 = (nx_emmc_cal0_t *)calloc(1, NX_EMMC_CALIBRATION_SIZE);
+		if (cal0_read(KS_BIS_00_TWEAK, KS_BIS_00_CRYPT, cal0))
+			strncpy(serial_number, cal0->serial_number, 0x18);
+		free(cal0);
+		_stage_add("cal0", get_tmr_us() - start);
+	}
+
+	u8 fw_major = 0, fw_minor = 0, fw_patch = 0;
+	host_io_stats_t io_before = host_io_stats;
+	start = get_tmr_us();
+	bool fw_detected = detect_firmware_from_nca(&fw_major, &fw_minor, &fw_patch, &keys);
+	_stage_add("detect", get_tmr_us() - start);
+
+	u32 total = get_tmr_us() - start_total;
+
+	printf("Firmware:       ");
+	if (fw_detected)
+		printf("%d.%d.%d\n", fw_major, fw_minor, fw_patch);
+	else
+		printf("not detected\n");
+	printf("Required fuses: ");
+	if (fw_detected)
+		printf("%d\n", get_required_fuses(fw_major, fw_minor, fw_patch));
+	else
+		printf("unknown\n");
+	printf("Serial:         %s\n", serial_number[0] ? serial_number : "N/A");
+	printf("Database:       %d NCA, %d fuse entries\n", (int)nca_db_count, (int)fuse_db_count);
+
+	printf("\nStage timings (us):\n");
+	for (u32 i = 0; i < _stage_cnt; i++)
+		printf("  %-12s %10u\n", _stages[i].name, _stages[i].us);
+	printf("  %-12s %10u\n", "total", total);
+
+	fw_detect_stats_t detect_stats;
+	fw_detect_get_stats(&detect_stats);
+	printf("\nDetection: %s, %u probes, %u files scanned, %u clusters decrypted\n",
+		detect_stats.strategy == FW_DETECT_PROBE ? "probe" : "enumerate",
+		detect_stats.probes, detect_stats.files_scanned, detect_stats.clusters_decrypted);
+	printf("eMMC I/O during detect: %llu reads, %llu sectors\n",
+		(unsigned long long)(host_io_stats.read_cmds - io_before.read_cmds),
+		(unsigned long long)(host_io_stats.read_sectors - io_before.read_sectors));
+	printf("eMMC session: %u inits, %u partition switches\n",
+		host_io_stats.inits, host_io_stats.partition_switches);
+
+#ifdef FUSECHECK_PROFILE
+	profile_span_t spans[PROFILE_MAX_SPANS];
+	u32 span_cnt = profile_get_spans(spans, PROFILE_MAX_SPANS);
+	printf("\nProfile spans (us):\n");
+	for (u32 i = 0; i < span_cnt; i++)
+		printf("  %*s%-*s %10u %10u\n", spans[i].depth * 2, "", 24 - spans[i].depth * 2, spans[i].name,
+			spans[i].start_us, spans[i].end_us - spans[i].start_us);
+#endif
+
+	emummc_storage_end();
+	host_sdmmc_detach_all();
+
+	return fw_detected ? 0 : 2;
+}